@@ -0,0 +1,118 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace
+{
+    double timeCall(const BenchmarkSuite::Body& body, uint64_t iterations)
+    {
+        auto start = std::chrono::steady_clock::now();
+        body(iterations);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    //Name and ns_per_op of every benchmark in a report written by writeJSON
+    std::map<std::string, double> readReport(const std::string& filename)
+    {
+        std::map<std::string, double> report;
+        std::ifstream file(filename);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        std::string text = contents.str();
+
+        const std::string nameKey = "\"name\": \"";
+        const std::string timeKey = "\"ns_per_op\": ";
+        for (size_t position = text.find(nameKey); position != std::string::npos; position = text.find(nameKey, position))
+        {
+            position += nameKey.size();
+            auto nameEnd = text.find('"', position);
+            auto time = text.find(timeKey, nameEnd);
+            if (nameEnd == std::string::npos || time == std::string::npos) break;
+            report[text.substr(position, nameEnd - position)] = std::stod(text.substr(time + timeKey.size()));
+        }
+        return report;
+    }
+}
+
+void BenchmarkSuite::run(const std::string& name, const Body& body)
+{
+    if (!selected(name)) return;
+
+    //Grow the count until a call takes minTime, aiming a little past it from the last measurement
+    uint64_t iterations = 1;
+    double seconds = timeCall(body, iterations);
+    while (seconds < minTime && iterations < (uint64_t(1) << 40))
+    {
+        double scale = seconds > 0.0 ? 1.2 * minTime / seconds : 100.0;
+        iterations = std::max(iterations + 1, static_cast<uint64_t>(static_cast<double>(iterations) * std::min(scale, 100.0)));
+        seconds = timeCall(body, iterations);
+    }
+
+    std::vector<double> times{seconds};
+    for (int r = 1; r < repetitions; ++r) times.push_back(timeCall(body, iterations));
+    for (auto& t : times) t *= 1e9 / static_cast<double>(iterations);
+    std::sort(times.begin(), times.end());
+
+    BenchmarkResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.median = times[times.size() / 2];
+    result.min = times.front();
+    result.max = times.back();
+    benchmarkResults.push_back(result);
+
+    std::cout << std::left << std::setw(40) << name << std::right << std::setw(14) << result.median << " ns/op  (min " << result.min << ", max "
+              << result.max << ", " << iterations << " iterations)" << std::endl;
+}
+
+bool BenchmarkSuite::writeJSON(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file) return false;
+
+    file << std::setprecision(9);
+    file << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < benchmarkResults.size(); ++i)
+    {
+        auto& result = benchmarkResults[i];
+        file << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations << ", \"ns_per_op\": " << result.median
+             << ", \"min_ns\": " << result.min << ", \"max_ns\": " << result.max << "}" << (i + 1 < benchmarkResults.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+int BenchmarkSuite::compare(const std::string& baselineFilename, double threshold, std::ostream& out) const
+{
+    auto baseline = readReport(baselineFilename);
+    if (baseline.empty())
+    {
+        out << "No benchmarks read from " << baselineFilename << std::endl;
+        return 0;
+    }
+
+    int regressions = 0;
+    out << "Compared with " << baselineFilename << ":" << std::endl;
+    for (auto& result : benchmarkResults)
+    {
+        auto itr = baseline.find(result.name);
+        if (itr == baseline.end() || itr->second <= 0.0)
+        {
+            out << "  " << std::left << std::setw(40) << result.name << std::right << "  not in baseline" << std::endl;
+            continue;
+        }
+
+        double change = result.median / itr->second - 1.0;
+        bool regression = change > threshold;
+        if (regression) ++regressions;
+        out << "  " << std::left << std::setw(40) << result.name << std::right << std::setw(14) << itr->second << " -> " << std::setw(14) << result.median
+            << " ns/op  " << std::showpos << std::fixed << std::setprecision(1) << change * 100.0 << "%" << std::noshowpos << std::defaultfloat
+            << std::setprecision(6) << (regression ? "  REGRESSION" : "") << std::endl;
+    }
+    return regressions;
+}
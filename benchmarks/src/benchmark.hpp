@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Nanoseconds per operation of one benchmark over its repetitions
+struct BenchmarkResult
+{
+    std::string name;
+    uint64_t iterations = 0;
+    double median = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+};
+
+//Runs timed loops and keeps their results for a JSON report and a comparison with an earlier one
+//Each benchmark body runs its operation the number of times it is given, that count is grown until one call takes
+//minTime, then the call is repeated and the median time per operation reported, so quick and slow operations both
+//get stable numbers without a per operation clock read
+class BenchmarkSuite
+{
+public:
+    using Body = std::function<void(uint64_t iterations)>;
+
+    //Seconds each repetition should take and how many are run
+    double minTime = 0.25;
+    int repetitions = 5;
+
+    //Only run benchmarks whose name contains this
+    std::string filter;
+
+    bool selected(const std::string& name) const { return filter.empty() || name.find(filter) != std::string::npos; }
+
+    //Time body if it is selected and print its result
+    void run(const std::string& name, const Body& body);
+
+    const std::vector<BenchmarkResult>& results() const { return benchmarkResults; }
+
+    bool writeJSON(const std::string& filename) const;
+
+    //Print each benchmark's change from a report written by writeJSON, returns how many are slower by more than threshold
+    int compare(const std::string& baselineFilename, double threshold, std::ostream& out) const;
+
+private:
+    std::vector<BenchmarkResult> benchmarkResults;
+};
+
+//Stops the compiler removing work whose result is otherwise unused
+template <typename T>
+inline void keep(const T& value)
+{
+    static volatile char sink;
+    sink = *reinterpret_cast<const volatile char*>(&value);
+}
@@ -0,0 +1,310 @@
+#include <vsg/all.h>
+#include <vsgXchange/all.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "assetRegistry.hpp"
+#include "benchmark.hpp"
+#include "latch.hpp"
+#include "onDemandReaderWriter.hpp"
+#include "pMath.hpp"
+#include "shipScene.hpp"
+
+namespace
+{
+    bool fileExists(const std::string& filename)
+    {
+        return static_cast<bool>(std::ifstream(filename));
+    }
+
+    // Pendulum integrators, a fixed step of the RK4 path and the adaptive Dormand-Prince step
+    void pendulumBenchmarks(BenchmarkSuite& suite)
+    {
+        suite.run("pMath/step", [](uint64_t iterations) {
+            pMath model(2.0, 2.5);
+            for (uint64_t i = 0; i < iterations; ++i) keep(model.step(1e-3).t);
+        });
+
+        suite.run("pMath/simulate", [](uint64_t iterations) {
+            pMath model(2.0, 2.5);
+            for (uint64_t i = 0; i < iterations; ++i) keep(model.simulate().t);
+        });
+
+        suite.run("pMath/adaptiveStep", [](uint64_t iterations) {
+            pMath model(2.0, 2.5);
+            for (uint64_t i = 0; i < iterations; ++i) keep(model.adaptiveStep().h);
+        });
+    }
+
+    // Pauses and resumes an adaptive run, its clock should stand still while paused and carry on from there afterwards
+    bool pauseCheck(std::ostream& out)
+    {
+        using namespace std::chrono_literals;
+        const double tolerance = 0.005;
+
+        pMath model(2.0, 2.5);
+        model.adaptiveStep();
+        std::this_thread::sleep_for(20ms);
+
+        double beforePause = model.clockTime();
+        for (int i = 0; i < 50; ++i)
+        {
+            model.holdTime();
+            std::this_thread::sleep_for(1ms);
+        }
+        double paused = model.clockTime();
+
+        model.adaptiveStep();
+        double resumed = model.clockTime();
+        std::this_thread::sleep_for(20ms);
+        double running = model.clockTime();
+
+        bool frozen = paused >= beforePause && paused - beforePause < tolerance;
+        bool continuous = resumed >= paused && resumed - paused < tolerance;
+        bool advancing = running - resumed > 0.015;
+        bool ok = frozen && continuous && advancing;
+
+        out << "check pMath/pause " << (ok ? "ok" : "failed") << ": clock " << beforePause << " s before the pause, " << paused << " s paused, "
+            << resumed << " s on resuming, " << running << " s 20 ms later" << std::endl;
+        return ok;
+    }
+
+    // Reading each model the scenes load, skipped when the model is missing; the asset registry is cleared each time
+    // so every iteration reads the file instead of finding it in the shared objects
+    void loadBenchmarks(BenchmarkSuite& suite, const std::string& models)
+    {
+        for (auto name : {"12219_boat_v2_L2.obj", "ww 1 for ele.obj", "skybox.vsgt"})
+        {
+            std::string benchmark = std::string("loadObject/") + name;
+            std::string filename = models + "/" + name;
+            if (!suite.selected(benchmark)) continue;
+            if (!fileExists(filename))
+            {
+                std::cout << benchmark << " skipped, " << filename << " not found" << std::endl;
+                continue;
+            }
+
+            suite.run(benchmark, [filename](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; ++i)
+                {
+                    assetRegistry().clear();
+                    keep(loadObject(filename));
+                }
+            });
+        }
+    }
+
+    // Setting up the readers as the apps used to, all of vsgXchange, against creating them on demand, and a first read of
+    // each model with fresh options so the readers it needs are created inside the timing
+    void readerBenchmarks(BenchmarkSuite& suite, const std::string& models)
+    {
+        auto createAll = []() -> vsg::ref_ptr<vsg::ReaderWriter> { return vsgXchange::all::create(); };
+        auto createOnDemand = []() -> vsg::ref_ptr<vsg::ReaderWriter> { return OnDemandReaderWriter::create(); };
+
+        suite.run("readers/all", [createAll](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) keep(createAll());
+        });
+
+        suite.run("readers/onDemand", [createOnDemand](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) keep(createOnDemand());
+        });
+
+        auto firstLoad = [&](const std::string& kind, std::function<vsg::ref_ptr<vsg::ReaderWriter>()> create) {
+            for (auto name : {"12219_boat_v2_L2.obj", "skybox.vsgt"})
+            {
+                std::string benchmark = "firstLoad/" + kind + "/" + name;
+                std::string filename = models + "/" + name;
+                if (!suite.selected(benchmark)) continue;
+                if (!fileExists(filename))
+                {
+                    std::cout << benchmark << " skipped, " << filename << " not found" << std::endl;
+                    continue;
+                }
+
+                suite.run(benchmark, [filename, create](uint64_t iterations) {
+                    for (uint64_t i = 0; i < iterations; ++i)
+                    {
+                        auto options = vsg::Options::create();
+                        options->add(create());
+                        keep(vsg::read(filename, options));
+                    }
+                });
+            }
+        };
+        firstLoad("all", createAll);
+        firstLoad("onDemand", createOnDemand);
+    }
+
+    // makeStovePipe with a new Builder each time, and with one Builder that can reuse the geometry it has made
+    void builderBenchmarks(BenchmarkSuite& suite)
+    {
+        vsg::vec4 colour(1.0f, 0.0f, 0.0f, 1.0f);
+
+        suite.run("makeStovePipe/newBuilder", [colour](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) keep(makeStovePipe(vsg::Builder::create(), colour));
+        });
+
+        auto builder = vsg::Builder::create();
+        suite.run("makeStovePipe/sharedBuilder", [builder, colour](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) keep(makeStovePipe(builder, colour));
+        });
+
+        suite.run("makeAxes", [builder](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) keep(makeAxes(builder));
+        });
+    }
+
+    // Bounds of the boat and the per frame transform update of the boat and plane
+    void sceneBenchmarks(BenchmarkSuite& suite, const std::string& models)
+    {
+        std::string boatFile = models + "/12219_boat_v2_L2.obj";
+        std::string planeFile = models + "/ww 1 for ele.obj";
+        bool haveBoat = fileExists(boatFile);
+
+        auto scene = vsg::Group::create();
+        auto builder = vsg::Builder::create();
+
+        if (suite.selected("ComputeBounds/boat"))
+        {
+            if (haveBoat)
+            {
+                auto ship = std::make_shared<ShipObj>(scene, builder, boatFile);
+                suite.run("ComputeBounds/boat", [ship](uint64_t iterations) {
+                    for (uint64_t i = 0; i < iterations; ++i) keep(ship->fetchObjBounds());
+                });
+            }
+            else
+            {
+                std::cout << "ComputeBounds/boat skipped, " << boatFile << " not found" << std::endl;
+            }
+        }
+
+        // rotateFromTranslate logs every call, its output goes to a sink that is emptied as it runs so only the
+        // formatting is timed, not the terminal
+        std::ostringstream sink;
+        auto coutBuffer = std::cout.rdbuf();
+
+        // The transforms only need a node to hang from, so a missing model does not stop these
+        if (suite.selected("ShipObj/updateTransform"))
+        {
+            auto ship = std::make_shared<ShipObj>(scene, builder, haveBoat ? boatFile : std::string());
+            suite.run("ShipObj/updateTransform", [&sink, coutBuffer, ship](uint64_t iterations) {
+                std::cout.rdbuf(sink.rdbuf());
+                double time = ship->lastTime;
+                for (uint64_t i = 0; i < iterations; ++i)
+                {
+                    ship->updateTransform(time += 1.0 / 60.0);
+                    if ((i & 255) == 0) sink.str(std::string());
+                }
+                std::cout.rdbuf(coutBuffer);
+                keep(ship->objTransform->matrix);
+            });
+        }
+
+        if (suite.selected("PlaneObj/updateTransform"))
+        {
+            auto plane = std::make_shared<PlaneObj>(scene, fileExists(planeFile) ? planeFile : std::string());
+            suite.run("PlaneObj/updateTransform", [&sink, coutBuffer, plane](uint64_t iterations) {
+                std::cout.rdbuf(sink.rdbuf());
+                double time = plane->lastTime;
+                for (uint64_t i = 0; i < iterations; ++i)
+                {
+                    plane->updateTransform(time += 1.0 / 60.0);
+                    if ((i & 255) == 0) sink.str(std::string());
+                }
+                std::cout.rdbuf(coutBuffer);
+                keep(plane->objTransform->matrix);
+            });
+        }
+    }
+
+    // Render side loads while a second thread keeps storing new states, as the simulation thread does
+    void handoffBenchmarks(BenchmarkSuite& suite)
+    {
+        auto contended = [&suite](const std::string& name, auto writer, auto reader) {
+            if (!suite.selected(name)) return;
+
+            std::atomic<bool> running{true};
+            std::thread producer([&]() {
+                while (running.load(std::memory_order_relaxed)) writer();
+            });
+            suite.run(name, [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; ++i) reader();
+            });
+            running = false;
+            producer.join();
+        };
+
+        SafeSharedPtr<TimedState> safeSharedPtr;
+        safeSharedPtr.store(std::make_shared<TimedState>());
+        contended(
+            "SafeSharedPtr/load", [&]() { safeSharedPtr.store(std::make_shared<TimedState>()); },
+            [&]() { keep(safeSharedPtr.load()->time); });
+
+        contended(
+            "SafeSharedPtr/store", [&]() { keep(safeSharedPtr.load()->time); },
+            [&]() { safeSharedPtr.store(std::make_shared<TimedState>()); });
+
+        auto tripleBuffer = std::make_unique<TripleBuffer<TimedState>>();
+        TimedState produced, consumed;
+        contended(
+            "TripleBuffer/load", [&]() { tripleBuffer->store(produced); produced.time += 1.0; },
+            [&]() { tripleBuffer->load(consumed); keep(consumed.time); });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    vsg::CommandLine arguments(&argc, argv);
+
+    BenchmarkSuite suite;
+    arguments.read("--filter", suite.filter);
+    arguments.read("--min-time", suite.minTime);
+    arguments.read("--repetitions", suite.repetitions);
+    auto models = arguments.value(std::string("../../camera/models"), "--models");
+    auto jsonFile = arguments.value(std::string("benchmarks.json"), "--json");
+    auto baselineFile = arguments.value(std::string(), "--baseline");
+    auto threshold = arguments.value(0.1, "--threshold");
+
+    if (arguments.errors()) return arguments.writeErrorMessages(std::cerr);
+    if (argc > 1)
+    {
+        std::cerr << "usage: benchmarks [--filter name] [--min-time s] [--repetitions n] [--models dir] [--json file] [--baseline file] [--threshold fraction]" << std::endl;
+        return 1;
+    }
+
+    if (!pauseCheck(std::cout)) return 3;
+
+    pendulumBenchmarks(suite);
+    loadBenchmarks(suite, models);
+    readerBenchmarks(suite, models);
+    builderBenchmarks(suite);
+    sceneBenchmarks(suite, models);
+    handoffBenchmarks(suite);
+
+    if (!suite.writeJSON(jsonFile))
+    {
+        std::cerr << "Unable to write " << jsonFile << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << suite.results().size() << " results to " << jsonFile << std::endl;
+
+    if (!baselineFile.empty())
+    {
+        int regressions = suite.compare(baselineFile, threshold, std::cout);
+        if (regressions > 0)
+        {
+            std::cout << regressions << " benchmarks slower than the baseline by more than " << threshold * 100.0 << "%" << std::endl;
+            return 2;
+        }
+    }
+
+    return 0;
+}
@@ -1,5 +1,4 @@
 #include <vsg/all.h>
-#include <vsgXchange/all.h>
 
 #include <iostream>
 #include <cxxabi.h>
@@ -9,6 +8,19 @@
 #include <tuple>
 #include <cmath>
 
+#include "onDemandRendering.hpp"
+#include "shipScene.hpp"
+#include "frameStats.hpp"
+#include "appProfiler.hpp"
+#include "metricsPublisher.hpp"
+#include "renderStats.hpp"
+#include "stateRecording.hpp"
+#include "framePacer.hpp"
+#include "sceneBenchmark.hpp"
+#include "flattenStatic.hpp"
+#include "assetRegistry.hpp"
+#include "releaseHostData.hpp"
+
 template <typename T>
 std::string demangle(T&&) {
     auto name = typeid(T).name();
@@ -56,267 +68,6 @@ private:
     bool b;
 };
 
-vsg::ref_ptr<vsg::Node> createTextureQuad(vsg::ref_ptr<vsg::Data> sourceData, vsg::ref_ptr<vsg::Options> options)
-{
-    auto builder = vsg::Builder::create();
-    builder->options = options;
-
-    vsg::StateInfo state;
-    state.image = sourceData;
-    state.lighting = false;
-
-    vsg::GeometryInfo geom;
-    geom.dy.set(0.0f, 0.0f, 1.0f);
-    geom.dz.set(0.0f, -1.0f, 0.0f);
-
-    return builder->createQuad(geom, state);
-}
-
-vsg::ref_ptr<vsg::MatrixTransform> makeStovePipe(vsg::ref_ptr<vsg::Builder> builder, const vsg::vec4& clr)
-{
-    vsg::GeometryInfo geomInfo;
-    vsg::StateInfo stateInfo;
-
-    float thickness = 0.05f;
-    geomInfo.dx = {thickness, 0.0f, 0.0f};
-    geomInfo.dy = {0.0f, thickness, 0.0f};
-    geomInfo.dz = {0.0f, 0.0f, 1.0f};
-    geomInfo.color = clr;
-    auto z_cylinder = builder->createCylinder(geomInfo, stateInfo);
-    geomInfo.dx = {.25f, 0.0f, 0.0f};
-    geomInfo.dy = {0.0f, .25f, 0.0f};
-    geomInfo.dz = {0.0f, 0.0f, .25f};
-    geomInfo.transform = vsg::translate(0.0f, 0.0f, 0.5f);
-    auto z_cone = builder->createCone(geomInfo, stateInfo);
-    auto stove_pipe = vsg::MatrixTransform::create();
-    stove_pipe->addChild(z_cylinder);
-    stove_pipe->addChild(z_cone);
-    return stove_pipe;
-}
-
-vsg::ref_ptr<vsg::MatrixTransform> makeAxes(vsg::ref_ptr<vsg::Builder> builder)
-{
-    float scale = 200.0f;
-    auto zStovePipe = makeStovePipe(builder, vsg::vec4{0.0f, 0.0f, 1.0f, 1.0f});
-    zStovePipe->matrix = vsg::scale(scale, scale, scale);
-
-    auto xStovePipe = makeStovePipe(builder, vsg::vec4{1.0f, 0.0f, 0.0f, 1.0f});
-    xStovePipe->matrix = vsg::rotate(vsg::radians(90.0f), 0.0f, 1.0f, 0.0f)
-        * vsg::scale(scale, scale, scale);
-
-    auto yStovePipe = makeStovePipe(builder, vsg::vec4{0.0f, 1.0f, 0.0f, 1.0f});
-    yStovePipe->matrix = vsg::rotate(vsg::radians(90.0f), -1.0f, 0.0f, 0.0f)
-        * vsg::scale(scale, scale, scale);
-
-    auto axes = vsg::MatrixTransform::create();
-    axes->addChild(zStovePipe);
-    axes->addChild(xStovePipe);
-    axes->addChild(yStovePipe);
-    return axes;
-}
-
-vsg::ref_ptr<vsg::Node> loadObject(string filepath)
-{
-    vsg::Path vsgFilePath = filepath;
-    vsg::ref_ptr<vsg::Object> object;
-    auto options = vsg::Options::create();
-    
-    // add vsgXchange's support for reading and writing 3rd party file formats
-    options->add(vsgXchange::all::create());
-
-    if(vsgFilePath.find(".vsg") != std::string::npos)
-    {
-        object = vsg::read(vsgFilePath, options);
-        std::cout << "vsg" << std::endl;
-    }
-    else
-    {
-        object = vsg::read_cast<vsg::Node>(vsgFilePath, options);
-        std::cout << "novsg" << std::endl;
-    }
-
-    if (vsg::ref_ptr<vsg::Node> node = object.cast<vsg::Node>())
-    {
-        return node;
-    }
-    else if (auto data = object.cast<vsg::Data>())
-    {
-        if (vsg::ref_ptr<vsg::Node> textureGeometry = createTextureQuad(data, options))
-        {
-            return node;
-        }
-    }
-    else if (object)
-    {
-        std::cout << "Unable to view object of type " << object->className() << std::endl;
-    }
-    else
-    {
-        std::cout << "Unable to load file " << vsgFilePath << std::endl;
-    }
-    vsg::ref_ptr<vsg::Node> node;
-    return node;
-}
-
-class ShipObj
-{
-    public:
-    vsg::ref_ptr<vsg::Node> objNode;
-    vsg::vec3 objPosition;
-    vsg::ref_ptr<vsg::MatrixTransform> objAlignWithX;
-    vsg::ref_ptr<vsg::MatrixTransform> objTransform;
-    vsg::vec3 thisTranslation;
-    vsg::vec3 lastTranslation;
-    double thisTime;
-    double lastTime;
-    std::function<vsg::vec3(double)> pathFunc = [](double t){return vsg::vec3((float)(sin(t/10)*2000), (float)(cos(t/10)*2000), 33.0f);};
-
-    ShipObj(class vsg::ref_ptr<vsg::Group> scene, vsg::ref_ptr<vsg::Builder> builder)
-    {
-        objNode = loadObject("../models/12219_boat_v2_L2.obj");
-        // objNode = loadObject("../models/ww 1 for ele.obj");
-        // objNode = makeAxes(builder);
-        objAlignWithX = vsg::MatrixTransform::create();
-        objAlignWithX->addChild(objNode);
-        objTransform = vsg::MatrixTransform::create();
-        objTransform->addChild(objAlignWithX);
-        lastTime = 0;
-        lastTranslation = pathFunc(0);
-        objAlignWithX->matrix = vsg::rotate(vsg::radians(270.0f), 1.0f, 0.0f, 0.0f)
-            * vsg::rotate(vsg::radians(180.0f), 0.0f, 1.0f, 0.0f);
-        objTransform->matrix = vsg::translate(lastTranslation)
-            * vsg::scale(vsg::vec3(.2f, .2f, .2f));
-        scene->addChild(objTransform);
-    }
-
-    vsg::dbox fetchObjBounds()
-    {
-        return vsg::visit<vsg::ComputeBounds>(objTransform).bounds;
-    }
-
-    vsg::vec3 fetchObjPosition()
-    {
-        auto bounds = fetchObjBounds();
-        objPosition = (bounds.min + bounds.max) * 0.5;
-        return objPosition;
-    }
-
-    void updateTransform(double _thisTime)
-    {
-        thisTime = _thisTime;
-        thisTranslation = pathFunc(thisTime);
-        objTransform->matrix = vsg::translate(thisTranslation)
-            * rotateFromTranslate()
-            * vsg::scale(vsg::vec3(0.2f, 0.2f, 0.2f));
-    }
-
-    private:
-    vsg::mat4 rotateFromTranslate()
-    {
-        cout << "#############SHIP OBJECT#############" << endl;
-        vsg::vec3 dx = thisTranslation - lastTranslation;
-        cout << "transx: " << thisTranslation.x;
-        cout << " transy: " << thisTranslation.y;
-        cout << " transz: " << thisTranslation.z << endl;
-
-        double dt = thisTime - lastTime;
-        dx *= 1/(dt); 
-        float theta = acos(dx.x/vsg::length(dx));
-        dx = vsg::normalize(dx);
-
-        lastTranslation = thisTranslation;
-        lastTime = thisTime;
-
-        auto cross = vsg::cross(vsg::vec3(1.0f, 0.0f, 0.0f), dx);
-        cross = vsg::normalize(cross);
-        cout << "dx: " << dx.x;
-        cout << " dy: " << dx.y;
-        cout << " dz: " << dx.z << endl;
-        cout << "Cross x: " << cross.x;
-        cout << " Cross y: " << cross.y;
-        cout << " Cross z: " << cross.z << endl;
-        cout << "Ship theta: " << vsg::degrees(theta) << endl;
-        return vsg::rotate(theta, cross);
-    }
-};
-
-class PlaneObj
-{
-    public:
-    vsg::ref_ptr<vsg::Node> objNode;
-    vsg::vec3 objPosition;
-    vsg::ref_ptr<vsg::MatrixTransform> objAlignWithX;
-    vsg::ref_ptr<vsg::MatrixTransform> objTransform;
-    vsg::vec3 thisTranslation;
-    vsg::vec3 lastTranslation;
-    double thisTime;
-    double lastTime;
-    std::function<vsg::vec3(double)> pathFunc = [](double t){return vsg::vec3((float)(-sin(t/10)*5000), (float)(cos(t/10)*5000), 2000.0f);};
-
-    PlaneObj(class vsg::ref_ptr<vsg::Group> scene)
-    {
-        objNode = loadObject("../models/ww 1 for ele.obj");
-        objAlignWithX = vsg::MatrixTransform::create();
-        objAlignWithX->addChild(objNode);
-        objTransform = vsg::MatrixTransform::create();
-        objTransform->addChild(objAlignWithX);
-        lastTime = 0;
-        lastTranslation = pathFunc(0);
-        objAlignWithX->matrix = vsg::rotate(vsg::radians(90.0f), 0.0f, 0.0f, 1.0f);
-        objTransform->matrix = vsg::translate(lastTranslation);
-        scene->addChild(objTransform);
-    }
-
-    vsg::dbox fetchObjBounds()
-    {
-        return vsg::visit<vsg::ComputeBounds>(objTransform).bounds;
-    }
-
-    vsg::vec3 fetchObjPosition()
-    {
-        auto bounds = fetchObjBounds();
-        objPosition = (bounds.min + bounds.max) * 0.5;
-        return objPosition;
-    }
-
-    void updateTransform(double _thisTime)
-    {
-        thisTime = _thisTime;
-        thisTranslation = pathFunc(thisTime);
-        objTransform->matrix = vsg::translate(thisTranslation)
-            * rotateFromTranslate();
-    }
-
-    private:
-    vsg::mat4 rotateFromTranslate()
-    {
-        cout << "#############PLANE OBJECT#############" << endl;
-        vsg::vec3 dx = thisTranslation - lastTranslation;
-        cout << "transx: " << thisTranslation.x;
-        cout << " transy: " << thisTranslation.y;
-        cout << " transz: " << thisTranslation.z << endl;
-
-        double dt = thisTime - lastTime;
-        dx *= 1/(dt); 
-        float theta = acos(dx.x/vsg::length(dx));
-        dx = vsg::normalize(dx);
-        lastTranslation = thisTranslation;
-        lastTime = thisTime;
-
-        auto cross = vsg::cross(vsg::vec3(1.0f, 0.0f, 0.0f), dx);
-        cross = vsg::normalize(cross);
-        cout << "dx: " << dx.x;
-        cout << " dy: " << dx.y;
-        cout << " dz: " << dx.z << endl;
-        cout << "Cross x: " << cross.x;
-        cout << " Cross y: " << cross.y;
-        cout << " Cross z: " << cross.z << endl;
-        cout << "Plane theta: " << vsg::degrees(theta) << endl;
-
-        return vsg::rotate(theta, cross);
-    }
-};
-
 std::tuple<vsg::ref_ptr<vsg::Node>, ShipObj, PlaneObj> createShipScene(vsg::ref_ptr<vsg::Options> options)
 {
     auto builder = vsg::Builder::create();
@@ -359,11 +110,6 @@ int main(int argc, char** argv)
     options->paths = vsg::getEnvPaths("VSG_FILE_PATH");
     options->sharedObjects = vsg::SharedObjects::create();
 
-#ifdef vsgXchange_all
-    // add vsgXchange's support for reading and writing 3rd party file formats
-    options->add(vsgXchange::all::create());
-#endif
-
     // set up defaults and read command line arguments to override them
     vsg::CommandLine arguments(&argc, argv);
 
@@ -384,6 +130,34 @@ int main(int argc, char** argv)
     if (arguments.errors()) return arguments.writeErrorMessages(std::cerr);
 
     bool multiThreading = arguments.read("--mt");
+    bool onDemand = arguments.read("--on-demand");
+    // --flatten bakes the static transforms into the vertex data and merges draws that share state
+    bool flatten = arguments.read("--flatten");
+    // --atlas packs each model's small diffuse textures into one atlas so its materials can share a descriptor set
+    assetRegistry().read(arguments);
+    // the app's own reads use whichever readers the registry ended up with, created on demand or --all-readers
+    for (auto& readerWriter : assetRegistry().options->readerWriters) options->add(readerWriter);
+    // --release-host-data boat,plane,scene or all drops the host copies of static data once it is on the GPU
+    HostDataRelease hostDataRelease;
+    hostDataRelease.read(arguments);
+    FrameStatsOptions frameStatsOptions;
+    frameStatsOptions.read(arguments);
+    // --record file saves the ship and plane transforms each frame, --play file moves them from a recording instead
+    RecordingOptions recordingOptions;
+    recordingOptions.read(arguments);
+    ProfilerOptions profilerOptions;
+    profilerOptions.read(arguments);
+    // --benchmark N draws N frames on a fixed simulated timeline and writes a JSON report
+    SceneBenchmark benchmark;
+    benchmark.read(arguments);
+
+    // create the profiler up front so loading shows up in it
+    auto instrumentation = profilerOptions.createInstrumentation();
+    MetricsPublisher metrics(readMetricsName(arguments), "camera");
+    RenderStatsMonitor renderStats(arguments.read("--render-stats"));
+    benchmark.configure(renderStats);
+    FramePacer framePacer(arguments.read("--pacing"));
+    arguments.read("--pacing-margin", framePacer.safetyMargin);
     bool separateDevices = arguments.read({"--no-shared-window", "-n"});
     // bool useStagingBuffer = arguments.read({"--staging-buffer", "-s"});
 
@@ -400,6 +174,30 @@ int main(int argc, char** argv)
     auto ship = std::get<1>(tup);
     auto plane = std::get<2>(tup);
 
+    if (assetRegistry().atlasTextures || renderStats.enabled) assetRegistry().report(std::cout);
+
+    if (flatten)
+    {
+        // the ship and plane transforms move every frame, everything else in the scene stays put
+        auto flattener = FlattenStaticTransforms::create();
+        flattener->keep(ship.objTransform);
+        flattener->keep(plane.objTransform);
+        scene->accept(*flattener);
+        flattener->report(std::cout);
+    }
+
+    std::vector<vsg::ref_ptr<vsg::MatrixTransform>> entities{ship.objTransform, plane.objTransform};
+    auto entitiesSize = static_cast<uint32_t>(entities.size() * sizeof(vsg::dmat4));
+    StateRecorder recorder(recordingOptions.recordFilename, RecordingKind::Entities, entitiesSize);
+    StatePlayer player(recordingOptions.playFilename, RecordingKind::Entities, entitiesSize);
+    recordingOptions.configure(player);
+
+    if (renderStats.enabled)
+    {
+        reportModelComplexity("boat", ship.objNode, std::cout);
+        reportModelComplexity("plane", plane.objNode, std::cout);
+    }
+
     auto group = vsg::Group::create();
     group->addChild(scene);
 
@@ -489,6 +287,10 @@ int main(int argc, char** argv)
     // Add close handler to respond to the close window button and to pressing escape
     viewer->addEventHandler(vsg::CloseHandler::create(viewer));
 
+    // Only render when something changes if --on-demand is set
+    auto onDemandRendering = OnDemandRendering::create(onDemand && !benchmark.enabled());
+    viewer->addEventHandler(onDemandRendering);
+
     // Add trackball for controllable window
     auto main_trackball = vsg::Trackball::create(camera);
     main_trackball->addWindow(window);
@@ -498,6 +300,9 @@ int main(int argc, char** argv)
     auto planeCamera = InputHandler::create();
     viewer->addEventHandler(planeCamera);
 
+    // camera script played by --benchmark, or recorded into when not benchmarking
+    benchmark.assign(viewer, camera, options);
+
     auto renderGraph = vsg::RenderGraph::create(window, view);
     // auto pRenderGraph = vsg::RenderGraph::create(pWindow, pView);
 
@@ -508,6 +313,8 @@ int main(int argc, char** argv)
     // pCommandGraph->addChild(pRenderGraph);
 
     viewer->assignRecordAndSubmitTaskAndPresentation({commandGraph});
+
+    if (instrumentation) viewer->assignInstrumentation(instrumentation);
     // viewer->assignRecordAndSubmitTaskAndPresentation({commandGraph, pCommandGraph});
 
     if (multiThreading)
@@ -515,46 +322,97 @@ int main(int argc, char** argv)
         viewer->setupThreading();
     }
 
+    // time every frame, plus the GPU work of the main window using timestamp queries
+    FrameStats frameStats(benchmark.historySize());
+    frameStats.budget = frameStatsOptions.budget;
+    if (frameStatsOptions.gpuTime)
+    {
+        frameStats.gpuTimer = GpuFrameTimer::create();
+        frameStats.gpuTimer->assign(commandGraph);
+    }
+
+    renderStats.assign(commandGraph, window, options);
+    metrics.scene = scene;
     viewer->compile();
+    hostDataRelease.release({{"boat", ship.objTransform}, {"plane", plane.objTransform}, {"scene", scene}}, std::cout);
 
     auto startTime = vsg::clock::now();
     double numFramesCompleted = 0.0;
 
     
     // rendering main loop
-    while (viewer->advanceToNextFrame())
+    while (benchmark.running() && onDemandRendering->advanceToNextFrame(viewer, benchmark.simulationTime()))
     {
-        auto t = std::chrono::duration<double, std::chrono::seconds::period>(vsg::clock::now() - startTime).count();
-        ship.updateTransform(t);
-        plane.updateTransform(t);
-        
-        sBounds = vsg::visit<vsg::ComputeBounds>(ship.objTransform).bounds;
-        sCentre = (sBounds.min + sBounds.max) * 0.5;
+        // sleep until as late as possible before vsync, then pick up the latest input
+        framePacer.beginFrame(viewer);
+        frameStats.beginFrame();
 
-        pBounds = vsg::visit<vsg::ComputeBounds>(plane.objTransform).bounds;
-        pCentre = (pBounds.min + pBounds.max) * 0.5;
+        // pass any events into EventHandlers assigned to the Viewer before the scene and camera are updated
+        // so trackball input shows up in this frame rather than the next one
+        viewer->handleEvents();
 
-        lookAt->center = pCentre;
-        lookAt->up = vsg::dvec3(0.0, 0.0, 1.0);
+        auto t = benchmark.enabled() ? benchmark.simulationTime() : std::chrono::duration<double, std::chrono::seconds::period>(vsg::clock::now() - startTime).count();
+        {
+            APP_ZONE("entity update", APP_COLOR_UPDATE);
+            if (player.enabled())
+            {
+                playTransforms(player, player.playbackTime(t), entities);
+            }
+            else
+            {
+                ship.updateTransform(t);
+                plane.updateTransform(t);
+            }
+            recordTransforms(recorder, t, entities);
+        }
 
-        pLookAt->eye =  pCentre;
-        pLookAt->center =  sCentre;
-        pLookAt->up = vsg::dvec3(0.0, 0.0, 1.0);
+        // the ship and plane are always moving so keep the on demand loop running
+        onDemandRendering->requestFrame();
 
-        if(*planeCamera == false)
         {
-            camera->viewMatrix = lookAt;
+            APP_ZONE("bounds", APP_COLOR_BOUNDS);
+            sBounds = vsg::visit<vsg::ComputeBounds>(ship.objTransform).bounds;
+            sCentre = (sBounds.min + sBounds.max) * 0.5;
+
+            pBounds = vsg::visit<vsg::ComputeBounds>(plane.objTransform).bounds;
+            pCentre = (pBounds.min + pBounds.max) * 0.5;
         }
-        else
+
+        viewer->update();
+
+        // latch the camera right before record and submit, unless a benchmark script is moving it
+        if (!benchmark.scripted())
         {
-            camera->viewMatrix = pLookAt;
+            APP_ZONE("camera", APP_COLOR_CAMERA);
+            lookAt->center = pCentre;
+            lookAt->up = vsg::dvec3(0.0, 0.0, 1.0);
+
+            pLookAt->eye =  pCentre;
+            pLookAt->center =  sCentre;
+            pLookAt->up = vsg::dvec3(0.0, 0.0, 1.0);
+
+            if(*planeCamera == false)
+            {
+                camera->viewMatrix = lookAt;
+            }
+            else
+            {
+                camera->viewMatrix = pLookAt;
+            }
         }
-        
-        // pass any events into EventHandlers assigned to the Viewer
-        viewer->handleEvents();
-        viewer->update();
+
+        frameStats.mark(FrameStats::UPDATE);
+        // the stats walk is left out of the timings, it is not part of drawing the frame
+        renderStats.collect();
+        frameStats.exclude();
         viewer->recordAndSubmit();
+        frameStats.mark(FrameStats::RECORD);
         viewer->present();
+        frameStats.mark(FrameStats::PRESENT);
+        frameStats.endFrame();
+        metrics.endFrame();
+        framePacer.endFrame();
+        benchmark.endFrame();
 
         numFramesCompleted += 1.0;
     }
@@ -564,6 +422,19 @@ int main(int argc, char** argv)
     {
         std::cout << "Average frame rate = " << (numFramesCompleted / duration) << std::endl;
     }
+    onDemandRendering->report(std::cout);
+    frameStats.report(std::cout);
+    renderStats.report(std::cout);
+    benchmark.writeReport("camera", frameStats, renderStats, std::cout);
+    recorder.flush();
+    recorder.report(std::cout);
+    player.report(std::cout);
+    if (!frameStatsOptions.csvFilename.empty() && !frameStats.writeCSV(frameStatsOptions.csvFilename))
+    {
+        std::cout << "Unable to write " << frameStatsOptions.csvFilename << std::endl;
+    }
+    reportProfiler(instrumentation, profilerOptions.traceFilename, std::cout);
+    framePacer.report(std::cout);
 
     return 0;
 }
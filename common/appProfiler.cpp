@@ -0,0 +1,169 @@
+#include "appProfiler.hpp"
+
+#include <fstream>
+#include <map>
+#include <vector>
+
+vsg::ref_ptr<vsg::Instrumentation>& appInstrumentation()
+{
+    static vsg::ref_ptr<vsg::Instrumentation> s_instrumentation;
+    return s_instrumentation;
+}
+
+void ProfilerOptions::read(vsg::CommandLine& arguments)
+{
+    settings = vsg::Profiler::Settings::create();
+    arguments.read("--cpu", settings->cpu_instrumentation_level);
+    arguments.read("--gpu", settings->gpu_instrumentation_level);
+    arguments.read("--log-size", settings->log_size);
+    arguments.read("--gpu-size", settings->gpu_timestamp_size);
+    arguments.read("--trace", traceFilename);
+
+    //Asking for a trace implies profiling
+    enabled = arguments.read({"--profiler", "--pr"}) || !traceFilename.empty();
+}
+
+vsg::ref_ptr<vsg::Instrumentation> ProfilerOptions::createInstrumentation()
+{
+    if (!enabled) return {};
+
+    vsg::ref_ptr<vsg::Instrumentation> instrumentation = vsg::Profiler::create(settings);
+    appInstrumentation() = instrumentation;
+    return instrumentation;
+}
+
+namespace
+{
+    void writeEscaped(std::ostream& out, const char* str)
+    {
+        for (; *str; ++str)
+        {
+            char c = *str;
+            if (c == '"' || c == '\\') out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+            else out << c;
+        }
+    }
+
+    const char* entryName(const vsg::ProfileLog::Entry& entry)
+    {
+        if (entry.sourceLocation)
+        {
+            if (entry.sourceLocation->name) return entry.sourceLocation->name;
+            if (entry.sourceLocation->function) return entry.sourceLocation->function;
+        }
+        if (entry.object) return entry.object->className();
+        if (entry.type == vsg::ProfileLog::FRAME) return "Frame";
+        if (entry.type == vsg::ProfileLog::COMMAND_BUFFER) return "CommandBuffer";
+        return "unknown";
+    }
+}
+
+bool writeChromeTrace(const vsg::ProfileLog& log, const std::string& filename)
+{
+    std::ofstream fout(filename);
+    if (!fout) return false;
+
+    uint64_t end = log.index.load();
+    uint64_t size = log.entries.size();
+    uint64_t begin = end > size ? end - size : 0;
+    if (begin == end)
+    {
+        fout << "{\"traceEvents\":[]}\n";
+        return static_cast<bool>(fout);
+    }
+
+    auto entryAt = [&](uint64_t i) -> const vsg::ProfileLog::Entry& { return log.entries[i % size]; };
+
+    //Split the log into frames and find a CPU time to anchor each frame's GPU timestamps to
+    struct FrameAnchor
+    {
+        uint64_t first;
+        vsg::time_point cpuTime;
+        uint64_t gpuTime;
+        bool valid;
+    };
+    std::vector<FrameAnchor> anchors;
+    for (uint64_t i = begin; i < end; ++i)
+    {
+        auto& entry = entryAt(i);
+        if ((entry.type == vsg::ProfileLog::FRAME && entry.enter) || anchors.empty())
+        {
+            anchors.push_back(FrameAnchor{i, entry.cpuTime, 0, false});
+        }
+
+        auto& anchor = anchors.back();
+        if (entry.type == vsg::ProfileLog::COMMAND_BUFFER && !entry.enter)
+        {
+            anchor.cpuTime = entry.cpuTime;
+        }
+        else if (entry.type == vsg::ProfileLog::GPU && entry.gpuTime != 0 && (!anchor.valid || entry.gpuTime < anchor.gpuTime))
+        {
+            anchor.gpuTime = entry.gpuTime;
+            anchor.valid = true;
+        }
+    }
+
+    auto startTime = entryAt(begin).cpuTime;
+    auto microseconds = [&](vsg::time_point t) { return std::chrono::duration<double, std::chrono::microseconds::period>(t - startTime).count(); };
+
+    //Small stable ids for each CPU thread
+    std::map<std::thread::id, int> threadIds;
+
+    fout << "{\"traceEvents\":[\n";
+    fout << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    fout << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+    size_t frame = 0;
+    for (uint64_t i = begin; i < end; ++i)
+    {
+        while (frame + 1 < anchors.size() && anchors[frame + 1].first <= i) ++frame;
+
+        auto& entry = entryAt(i);
+        if (entry.type == vsg::ProfileLog::NO_TYPE) continue;
+
+        int pid = 1;
+        int tid = 0;
+        double ts = 0.0;
+        if (entry.type == vsg::ProfileLog::GPU)
+        {
+            auto& anchor = anchors[frame];
+            if (entry.gpuTime == 0 || !anchor.valid) continue;
+
+            double milliseconds = static_cast<double>(entry.gpuTime - anchor.gpuTime) * log.timestampScaleToMilliseconds;
+            pid = 2;
+            ts = microseconds(anchor.cpuTime) + milliseconds * 1000.0;
+        }
+        else
+        {
+            auto itr = threadIds.find(entry.thread);
+            if (itr == threadIds.end()) itr = threadIds.emplace(entry.thread, static_cast<int>(threadIds.size())).first;
+            tid = itr->second;
+            ts = microseconds(entry.cpuTime);
+        }
+
+        fout << ",\n{\"name\":\"";
+        writeEscaped(fout, entryName(entry));
+        fout << "\",\"ph\":\"" << (entry.enter ? 'B' : 'E') << "\",\"pid\":" << pid << ",\"tid\":" << tid << ",\"ts\":" << std::fixed << ts << "}";
+    }
+    fout << "\n]}\n";
+
+    return static_cast<bool>(fout);
+}
+
+void reportProfiler(vsg::ref_ptr<vsg::Instrumentation> instrumentation, const std::string& traceFilename, std::ostream& out)
+{
+    auto profiler = instrumentation.cast<vsg::Profiler>();
+    if (!profiler) return;
+
+    instrumentation->finish();
+    profiler->log->report(out);
+
+    if (!traceFilename.empty())
+    {
+        if (writeChromeTrace(*(profiler->log), traceFilename))
+            out << "Chrome trace written to " << traceFilename << std::endl;
+        else
+            out << "Unable to write " << traceFilename << std::endl;
+    }
+}
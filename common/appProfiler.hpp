@@ -0,0 +1,65 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <iostream>
+#include <string>
+
+//Instrumentation shared by the app level zones, assigned once at startup before any threads are created
+vsg::ref_ptr<vsg::Instrumentation>& appInstrumentation();
+
+//Colours of the app level zones in the profiler report and trace viewers
+const vsg::ubvec4 APP_COLOR_LOAD(255, 160, 0, 255);
+const vsg::ubvec4 APP_COLOR_UPDATE(0, 200, 80, 255);
+const vsg::ubvec4 APP_COLOR_BOUNDS(200, 200, 0, 255);
+const vsg::ubvec4 APP_COLOR_SIMULATION(220, 60, 220, 255);
+const vsg::ubvec4 APP_COLOR_CAMERA(60, 140, 255, 255);
+
+//Scoped CPU zone reported to appInstrumentation(), does nothing when profiling is off
+class AppZone
+{
+public:
+    AppZone(const vsg::SourceLocation* _sourceLocation) : instrumentation(appInstrumentation().get()), sourceLocation(_sourceLocation), reference(0)
+    {
+        if (instrumentation) instrumentation->enter(sourceLocation, reference);
+    }
+
+    ~AppZone()
+    {
+        if (instrumentation) instrumentation->leave(sourceLocation, reference);
+    }
+
+private:
+    const vsg::Instrumentation* instrumentation;
+    const vsg::SourceLocation* sourceLocation;
+    uint64_t reference;
+};
+
+#define APP_ZONE_CONCAT_(a, b) a##b
+#define APP_ZONE_CONCAT(a, b) APP_ZONE_CONCAT_(a, b)
+#define APP_ZONE_LEVEL(name, color, level) \
+    static const vsg::SourceLocation APP_ZONE_CONCAT(s_app_zone_location_, __LINE__){name, __func__, __FILE__, __LINE__, color, level}; \
+    AppZone APP_ZONE_CONCAT(app_zone_, __LINE__)(&APP_ZONE_CONCAT(s_app_zone_location_, __LINE__))
+
+//Level 1 zones are recorded with the default --cpu 1, level 2 zones need --cpu 2
+#define APP_ZONE(name, color) APP_ZONE_LEVEL(name, color, 1)
+#define APP_ZONE_L2(name, color) APP_ZONE_LEVEL(name, color, 2)
+
+//Read --profiler/--pr, --cpu, --gpu, --log-size, --gpu-size and --trace
+struct ProfilerOptions
+{
+    bool enabled = false;
+    std::string traceFilename;
+    vsg::ref_ptr<vsg::Profiler::Settings> settings;
+
+    void read(vsg::CommandLine& arguments);
+
+    //Returns a vsg::Profiler when enabled and makes it the appInstrumentation()
+    vsg::ref_ptr<vsg::Instrumentation> createInstrumentation();
+};
+
+//Write the CPU and GPU entries of a profile log as Chrome trace JSON, loadable in Perfetto or chrome://tracing
+//GPU timestamps are aligned to the CPU clock at the end of each frame's command buffer recording
+bool writeChromeTrace(const vsg::ProfileLog& log, const std::string& filename);
+
+//Finish the profiler, print its report and write the trace if a filename was given
+void reportProfiler(vsg::ref_ptr<vsg::Instrumentation> instrumentation, const std::string& traceFilename, std::ostream& out);
@@ -0,0 +1,459 @@
+#include "assetRegistry.hpp"
+
+#include <vsgXchange/all.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <typeinfo>
+#include <utility>
+
+namespace
+{
+    double millisecondsSince(vsg::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(vsg::clock::now() - start).count();
+    }
+
+    //Edge texels repeated around each texture so filtering at its border does not pick up its neighbours
+    const uint32_t padding = 2;
+
+    //Texture coordinates this far outside [0, 1] are taken as rounding, further out the model relies on wrapping
+    const float texcoordTolerance = 1e-3f;
+
+    //Every StateGroup in a model, once however many parents it has
+    class CollectStateGroups : public vsg::Inherit<vsg::Visitor, CollectStateGroups>
+    {
+    public:
+        std::vector<vsg::StateGroup*> stateGroups;
+
+        void apply(vsg::Node& node) override
+        {
+            if (visited.insert(&node).second) node.traverse(*this);
+        }
+
+        void apply(vsg::StateGroup& stateGroup) override
+        {
+            if (!visited.insert(&stateGroup).second) return;
+            stateGroups.push_back(&stateGroup);
+            stateGroup.traverse(*this);
+        }
+
+    private:
+        std::set<const vsg::Node*> visited;
+    };
+
+    std::vector<vsg::StateGroup*> collectStateGroups(vsg::Node& model)
+    {
+        auto collect = CollectStateGroups::create();
+        model.accept(*collect);
+        return collect->stateGroups;
+    }
+
+    //Distinct descriptor set binds in a model, what recording it costs in material changes
+    size_t countDescriptorBinds(vsg::Node& model)
+    {
+        std::set<const vsg::StateCommand*> binds;
+        for (auto stateGroup : collectStateGroups(model))
+        {
+            for (auto& stateCommand : stateGroup->stateCommands)
+            {
+                if (stateCommand->is_compatible(typeid(vsg::BindDescriptorSet)) || stateCommand->is_compatible(typeid(vsg::BindDescriptorSets)))
+                {
+                    binds.insert(stateCommand.get());
+                }
+            }
+        }
+        return binds.size();
+    }
+
+    uint32_t nextPowerOfTwo(uint32_t value)
+    {
+        uint32_t power = 1;
+        while (power < value) power *= 2;
+        return power;
+    }
+
+    //The one per vertex vec2 array of a draw, the texture coordinates as vsgXchange lays them out
+    int findTexcoords(const vsg::VertexIndexDraw& draw)
+    {
+        if (draw.arrays.empty() || !draw.arrays[0]->data || !draw.indices) return -1;
+
+        int found = -1;
+        for (size_t i = 1; i < draw.arrays.size(); ++i)
+        {
+            auto texcoords = draw.arrays[i]->data.cast<vsg::vec2Array>();
+            if (!texcoords || texcoords->size() != draw.arrays[0]->data->valueCount()) continue;
+            if (found >= 0) return -1;
+            found = static_cast<int>(i);
+        }
+        return found;
+    }
+
+    bool texcoordsInRange(const vsg::vec2Array& texcoords)
+    {
+        return std::all_of(texcoords.begin(), texcoords.end(), [](const vsg::vec2& uv) {
+            return uv.x >= -texcoordTolerance && uv.x <= 1.0f + texcoordTolerance && uv.y >= -texcoordTolerance && uv.y <= 1.0f + texcoordTolerance;
+        });
+    }
+
+    struct AtlasTexture
+    {
+        vsg::ref_ptr<vsg::ubvec4Array2D> image;
+        uint32_t x = 0;
+        uint32_t y = 0;
+        bool placed = false;
+    };
+
+    //A StateGroup whose diffuse texture could move into an atlas
+    struct Candidate
+    {
+        vsg::StateGroup* stateGroup;
+        size_t command;
+        size_t descriptor;
+        AtlasTexture* texture;
+    };
+
+    //Candidates whose textures can share an atlas, they need the same sampler, format and row order
+    struct AtlasGroup
+    {
+        vsg::ref_ptr<vsg::Sampler> sampler;
+        vsg::Data::Properties properties;
+        VkDescriptorType descriptorType;
+        std::vector<Candidate> candidates;
+        std::map<const vsg::Data*, std::unique_ptr<AtlasTexture>> textures;
+    };
+
+    //Rows of textures tallest first, returns the height used; textures that do not fit in width by limit are left unplaced
+    uint32_t shelfPack(const std::vector<AtlasTexture*>& textures, uint32_t width, uint32_t limit)
+    {
+        uint32_t x = 0, y = 0, shelfHeight = 0, used = 0;
+        for (auto texture : textures)
+        {
+            uint32_t w = texture->image->width() + 2 * padding;
+            uint32_t h = texture->image->height() + 2 * padding;
+            if (x + w > width)
+            {
+                y += shelfHeight;
+                x = 0;
+                shelfHeight = 0;
+            }
+
+            texture->placed = w <= width && y + h <= limit;
+            if (!texture->placed) continue;
+
+            texture->x = x + padding;
+            texture->y = y + padding;
+            x += w;
+            shelfHeight = std::max(shelfHeight, h);
+            used = std::max(used, y + h);
+        }
+        return used;
+    }
+
+    vsg::ref_ptr<vsg::ubvec4Array2D> buildAtlas(AtlasGroup& group, uint32_t atlasSize)
+    {
+        std::vector<AtlasTexture*> textures;
+        uint64_t area = 0;
+        uint32_t widest = 0;
+        for (auto& [data, texture] : group.textures)
+        {
+            textures.push_back(texture.get());
+            area += static_cast<uint64_t>(texture->image->width() + 2 * padding) * (texture->image->height() + 2 * padding);
+            widest = std::max(widest, texture->image->width() + 2 * padding);
+        }
+        std::sort(textures.begin(), textures.end(), [](AtlasTexture* lhs, AtlasTexture* rhs) { return lhs->image->height() > rhs->image->height(); });
+
+        //Start from a square that could hold them all and widen until they fit, or the atlas is as big as allowed
+        uint32_t width = std::min(atlasSize, nextPowerOfTwo(std::max(widest, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(area)))))));
+        uint32_t used = 0;
+        for (;;)
+        {
+            used = shelfPack(textures, width, width);
+            bool all = std::all_of(textures.begin(), textures.end(), [](AtlasTexture* texture) { return texture->placed; });
+            if (all || width >= atlasSize) break;
+            width *= 2;
+        }
+
+        auto placed = std::count_if(textures.begin(), textures.end(), [](AtlasTexture* texture) { return texture->placed; });
+        if (placed < 2) return {};
+
+        auto atlas = vsg::ubvec4Array2D::create(width, nextPowerOfTwo(used), group.properties);
+        for (auto texture : textures)
+        {
+            if (!texture->placed) continue;
+
+            auto& image = *texture->image;
+            int w = static_cast<int>(image.width()), h = static_cast<int>(image.height()), p = static_cast<int>(padding);
+            for (int j = -p; j < h + p; ++j)
+            {
+                for (int i = -p; i < w + p; ++i)
+                {
+                    auto source = image.at(static_cast<uint32_t>(std::clamp(i, 0, w - 1)), static_cast<uint32_t>(std::clamp(j, 0, h - 1)));
+                    atlas->set(static_cast<uint32_t>(static_cast<int>(texture->x) + i), static_cast<uint32_t>(static_cast<int>(texture->y) + j), source);
+                }
+            }
+        }
+        return atlas;
+    }
+
+    //Copy of draw with its texture coordinates moved into texture's place in an atlas of width by height
+    vsg::ref_ptr<vsg::VertexIndexDraw> remapDraw(const vsg::VertexIndexDraw& draw, const AtlasTexture& texture, uint32_t width, uint32_t height)
+    {
+        auto index = static_cast<size_t>(findTexcoords(draw));
+        auto texcoords = draw.arrays[index]->data.cast<vsg::vec2Array>();
+
+        float x = static_cast<float>(texture.x), y = static_cast<float>(texture.y);
+        float w = static_cast<float>(texture.image->width()), h = static_cast<float>(texture.image->height());
+        auto remapped = vsg::vec2Array::create(static_cast<uint32_t>(texcoords->size()));
+        for (size_t i = 0; i < texcoords->size(); ++i)
+        {
+            auto& uv = texcoords->at(i);
+            (*remapped)[i] = vsg::vec2((x + std::clamp(uv.x, 0.0f, 1.0f) * w) / static_cast<float>(width),
+                                       (y + std::clamp(uv.y, 0.0f, 1.0f) * h) / static_cast<float>(height));
+        }
+
+        vsg::DataList arrays;
+        for (size_t i = 0; i < draw.arrays.size(); ++i)
+        {
+            arrays.push_back(i == index ? vsg::ref_ptr<vsg::Data>(remapped) : draw.arrays[i]->data);
+        }
+
+        auto copy = vsg::VertexIndexDraw::create();
+        copy->assignArrays(arrays);
+        copy->assignIndices(draw.indices->data);
+        copy->firstBinding = draw.firstBinding;
+        copy->indexCount = draw.indexCount;
+        copy->instanceCount = draw.instanceCount;
+        copy->firstIndex = draw.firstIndex;
+        copy->vertexOffset = draw.vertexOffset;
+        copy->firstInstance = draw.firstInstance;
+        return copy;
+    }
+}
+
+AssetRegistry::AssetRegistry() :
+    options(vsg::Options::create())
+{
+    auto start = vsg::clock::now();
+
+    options->sharedObjects = vsg::SharedObjects::create();
+
+    //Only the readers the scenes' files need, each made when a file first asks for it
+    readers = OnDemandReaderWriter::create();
+    options->add(readers);
+
+    setupTime = millisecondsSince(start);
+}
+
+void AssetRegistry::read(vsg::CommandLine& arguments)
+{
+    atlasTextures = arguments.read("--atlas");
+    arguments.read("--atlas-max-texture", atlasMaxTextureSize);
+    arguments.read("--atlas-size", atlasSize);
+
+    if (arguments.read("--all-readers"))
+    {
+        auto start = vsg::clock::now();
+
+        // add vsgXchange's support for reading and writing 3rd party file formats
+        options->readerWriters.clear();
+        options->add(vsgXchange::all::create());
+        readers = {};
+
+        setupTime = millisecondsSince(start);
+    }
+}
+
+vsg::ref_ptr<vsg::Object> AssetRegistry::read(const vsg::Path& filename)
+{
+    auto start = vsg::clock::now();
+    auto object = vsg::read(filename, options);
+    double time = millisecondsSince(start);
+
+    std::scoped_lock<std::mutex> lock(mutex);
+    if (loads == 0) firstLoadTime = time;
+    loadTime += time;
+    ++loads;
+    return object;
+}
+
+void AssetRegistry::prepare(const std::string& name, vsg::ref_ptr<vsg::Node> model)
+{
+    if (!model) return;
+
+    std::scoped_lock<std::mutex> lock(mutex);
+
+    //A file read again comes back from the shared objects already prepared
+    if (!prepared.insert(model).second) return;
+
+    ModelBinds binds;
+    binds.name = name;
+    binds.before = countDescriptorBinds(*model);
+
+    //Atlasing first, so materials it leaves identical are shared with each other
+    if (atlasTextures) atlas(*model);
+    shareState(*model);
+
+    binds.after = countDescriptorBinds(*model);
+    models.push_back(binds);
+}
+
+void AssetRegistry::clear()
+{
+    std::scoped_lock<std::mutex> lock(mutex);
+
+    options->sharedObjects->clear();
+    prepared.clear();
+    models.clear();
+}
+
+void AssetRegistry::shareState(vsg::Node& model)
+{
+    for (auto stateGroup : collectStateGroups(model))
+    {
+        for (auto& stateCommand : stateGroup->stateCommands)
+        {
+            auto original = stateCommand.get();
+            options->sharedObjects->share(stateCommand);
+            if (stateCommand.get() != original) ++stateShared;
+        }
+    }
+}
+
+void AssetRegistry::atlas(vsg::Node& model)
+{
+    std::vector<AtlasGroup> groups;
+
+    for (auto stateGroup : collectStateGroups(model))
+    {
+        //Every child has to be a draw whose texture coordinates stay inside the texture, nothing may rely on wrapping
+        if (stateGroup->children.empty()) continue;
+        bool drawsFit = std::all_of(stateGroup->children.begin(), stateGroup->children.end(), [](const vsg::ref_ptr<vsg::Node>& child) {
+            auto draw = child.cast<vsg::VertexIndexDraw>();
+            if (!draw) return false;
+            int index = findTexcoords(*draw);
+            return index >= 0 && texcoordsInRange(*draw->arrays[static_cast<size_t>(index)]->data.cast<vsg::vec2Array>());
+        });
+        if (!drawsFit) continue;
+
+        //The diffuse map is binding 0 of the material descriptor set in vsg's phong and pbr shader sets
+        bool found = false;
+        for (size_t c = 0; c < stateGroup->stateCommands.size() && !found; ++c)
+        {
+            auto bind = stateGroup->stateCommands[c].cast<vsg::BindDescriptorSet>();
+            if (!bind || !bind->descriptorSet) continue;
+
+            auto& descriptors = bind->descriptorSet->descriptors;
+            for (size_t d = 0; d < descriptors.size() && !found; ++d)
+            {
+                auto descriptorImage = descriptors[d].cast<vsg::DescriptorImage>();
+                if (!descriptorImage || descriptorImage->dstBinding != 0 || descriptorImage->imageInfoList.size() != 1) continue;
+
+                auto& imageInfo = descriptorImage->imageInfoList.front();
+                if (!imageInfo->imageView || !imageInfo->imageView->image) continue;
+
+                auto image = imageInfo->imageView->image->data.cast<vsg::ubvec4Array2D>();
+                if (!image || image->properties.maxNumMipmaps > 1) continue;
+                if (image->properties.format != VK_FORMAT_R8G8B8A8_UNORM && image->properties.format != VK_FORMAT_R8G8B8A8_SRGB) continue;
+                if (image->width() == 0 || image->height() == 0) continue;
+                if (image->width() > atlasMaxTextureSize || image->height() > atlasMaxTextureSize) continue;
+
+                auto group = std::find_if(groups.begin(), groups.end(), [&](const AtlasGroup& existing) {
+                    return existing.properties.format == image->properties.format && existing.properties.origin == image->properties.origin &&
+                           existing.descriptorType == descriptorImage->descriptorType && vsg::compare_pointer(existing.sampler, imageInfo->sampler) == 0;
+                });
+                if (group == groups.end())
+                {
+                    groups.emplace_back();
+                    group = std::prev(groups.end());
+                    group->sampler = imageInfo->sampler;
+                    group->properties = image->properties;
+                    group->descriptorType = descriptorImage->descriptorType;
+                }
+
+                auto& texture = group->textures[image.get()];
+                if (!texture)
+                {
+                    texture.reset(new AtlasTexture);
+                    texture->image = image;
+                }
+                group->candidates.push_back(Candidate{stateGroup, c, d, texture.get()});
+                found = true;
+            }
+        }
+    }
+
+    for (auto& group : groups)
+    {
+        if (group.textures.size() < 2) continue;
+
+        auto atlasImage = buildAtlas(group, atlasSize);
+        if (!atlasImage) continue;
+
+        ++atlasesBuilt;
+        for (auto& [data, texture] : group.textures)
+        {
+            if (texture->placed) ++texturesAtlased;
+        }
+
+        //One descriptor for the whole atlas, each material gets a copy of its descriptor set pointing at it
+        auto atlasDescriptor = vsg::DescriptorImage::create(group.sampler, atlasImage, 0, 0, group.descriptorType);
+        std::map<const vsg::BindDescriptorSet*, vsg::ref_ptr<vsg::BindDescriptorSet>> binds;
+        std::map<std::pair<const vsg::Node*, const AtlasTexture*>, vsg::ref_ptr<vsg::VertexIndexDraw>> draws;
+
+        for (auto& candidate : group.candidates)
+        {
+            if (!candidate.texture->placed) continue;
+
+            auto& stateCommand = candidate.stateGroup->stateCommands[candidate.command];
+            auto bind = stateCommand.cast<vsg::BindDescriptorSet>();
+            auto& replacement = binds[bind.get()];
+            if (!replacement)
+            {
+                auto descriptors = bind->descriptorSet->descriptors;
+                descriptors[candidate.descriptor] = atlasDescriptor;
+                auto descriptorSet = vsg::DescriptorSet::create(bind->descriptorSet->setLayout, descriptors);
+                replacement = vsg::BindDescriptorSet::create(bind->pipelineBindPoint, bind->layout, bind->firstSet, descriptorSet);
+            }
+            stateCommand = replacement;
+
+            for (auto& child : candidate.stateGroup->children)
+            {
+                auto& remapped = draws[{child.get(), candidate.texture}];
+                if (!remapped)
+                {
+                    remapped = remapDraw(*child.cast<vsg::VertexIndexDraw>(), *candidate.texture, atlasImage->width(), atlasImage->height());
+                    ++drawsRemapped;
+                }
+                child = remapped;
+            }
+        }
+    }
+}
+
+void AssetRegistry::report(std::ostream& out) const
+{
+    out << "Asset loading: readers set up in " << setupTime << " ms, first load " << firstLoadTime << " ms, " << loads << " loads in " << loadTime << " ms"
+        << std::endl;
+    if (readers)
+    {
+        out << "    readers created:";
+        for (auto& [name, time] : readers->created()) out << " " << name << " (" << time << " ms)";
+        out << std::endl;
+    }
+    out << "Asset registry: " << stateShared << " state commands shared, " << texturesAtlased << " textures packed into " << atlasesBuilt
+        << " atlases, " << drawsRemapped << " draws remapped" << std::endl;
+    for (auto& model : models)
+    {
+        out << "    " << model.name << ": " << model.before << " descriptor set binds as loaded, " << model.after << " after" << std::endl;
+    }
+}
+
+AssetRegistry& assetRegistry()
+{
+    static AssetRegistry s_assetRegistry;
+    return s_assetRegistry;
+}
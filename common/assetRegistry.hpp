@@ -0,0 +1,76 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "onDemandReaderWriter.hpp"
+
+//One place every model is loaded through, so state is shared across models instead of per read
+//All reads use the same vsg::Options and vsg::SharedObjects, so pipelines, samplers and descriptor sets that compare equal
+//become one object, and vsg binds a shared state command once however many models use it
+//With atlasTextures a model's small diffuse textures are packed into one 2D atlas and its texture coordinates remapped,
+//so materials that only differed by texture share one descriptor set
+//Readers are created on demand by file extension rather than all of vsgXchange at start up, --all-readers goes back to
+//vsgXchange::all so the two can be compared
+class AssetRegistry
+{
+public:
+    AssetRegistry();
+
+    //Options for every read, with the readers and the shared objects
+    vsg::ref_ptr<vsg::Options> options;
+    vsg::ref_ptr<OnDemandReaderWriter> readers;
+
+    //Reads --atlas, --atlas-max-texture pixels, --atlas-size pixels and --all-readers
+    void read(vsg::CommandLine& arguments);
+
+    //Reads a file with options, timing it
+    vsg::ref_ptr<vsg::Object> read(const vsg::Path& filename);
+
+    //Milliseconds spent setting up the readers, on the first read and on all reads
+    double setupTime = 0.0;
+    double firstLoadTime = -1.0;
+    double loadTime = 0.0;
+    uint64_t loads = 0;
+
+    bool atlasTextures = false;
+
+    //Textures wider or taller than this stay on their own, an atlas is at most atlasSize on a side
+    uint32_t atlasMaxTextureSize = 1024;
+    uint32_t atlasSize = 4096;
+
+    //Share the state of a model that has just been read, and atlas its textures if asked to
+    void prepare(const std::string& name, vsg::ref_ptr<vsg::Node> model);
+
+    //State commands replaced by an equal one already shared, textures packed and the atlases they went into
+    uint64_t stateShared = 0;
+    uint64_t texturesAtlased = 0;
+    uint64_t atlasesBuilt = 0;
+    uint64_t drawsRemapped = 0;
+
+    void report(std::ostream& out) const;
+
+    //Forget what has been shared and prepared, so the next read of a file reads it again
+    void clear();
+
+private:
+    struct ModelBinds
+    {
+        std::string name;
+        size_t before = 0;
+        size_t after = 0;
+    };
+    std::vector<ModelBinds> models;
+    std::set<vsg::ref_ptr<vsg::Node>> prepared;
+    std::mutex mutex;
+
+    void shareState(vsg::Node& model);
+    void atlas(vsg::Node& model);
+};
+
+//The process wide registry loadObject() reads through
+AssetRegistry& assetRegistry();
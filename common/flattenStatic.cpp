@@ -0,0 +1,436 @@
+#include "flattenStatic.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <typeinfo>
+#include <vector>
+
+namespace
+{
+    bool isIdentity(const vsg::dmat4& matrix)
+    {
+        return matrix == vsg::dmat4();
+    }
+
+    bool isStaticData(const vsg::ref_ptr<vsg::BufferInfo>& bufferInfo)
+    {
+        return bufferInfo && bufferInfo->data && bufferInfo->data->properties.dataVariance != vsg::DYNAMIC_DATA &&
+               bufferInfo->data->properties.dataVariance != vsg::DYNAMIC_DATA_TRANSFER_AFTER_RECORD;
+    }
+
+    //Largest scale the matrix applies along any axis, for growing bounding spheres
+    double maxScale(const vsg::dmat4& matrix)
+    {
+        double scale = 0.0;
+        for (int c = 0; c < 3; ++c)
+        {
+            scale = std::max(scale, vsg::length(vsg::dvec3(matrix[c][0], matrix[c][1], matrix[c][2])));
+        }
+        return scale;
+    }
+
+    vsg::dsphere transformBound(const vsg::dsphere& bound, const vsg::dmat4& matrix)
+    {
+        return vsg::dsphere(matrix * bound.center, bound.radius * maxScale(matrix));
+    }
+
+    //Vertex, index and draw parameters of a StateGroup holding a single plain VertexIndexDraw
+    struct MergeCandidate
+    {
+        vsg::ref_ptr<vsg::StateGroup> stateGroup;
+        vsg::ref_ptr<vsg::VertexIndexDraw> draw;
+        size_t vertexCount = 0;
+    };
+
+    size_t indexCount(const vsg::Data& indices)
+    {
+        return indices.valueCount();
+    }
+
+    uint32_t readIndex(const vsg::Data& indices, size_t i)
+    {
+        auto data = static_cast<const uint8_t*>(indices.dataPointer());
+        switch (indices.valueSize())
+        {
+        case 1: return data[i];
+        case 2: return reinterpret_cast<const uint16_t*>(data)[i];
+        default: return reinterpret_cast<const uint32_t*>(data)[i];
+        }
+    }
+
+    //Per vertex arrays are concatenated, only these types are handled
+    bool concatenatable(const vsg::Data& data)
+    {
+        return (data.is_compatible(typeid(vsg::vec2Array)) || data.is_compatible(typeid(vsg::vec3Array)) || data.is_compatible(typeid(vsg::vec4Array)) ||
+                data.is_compatible(typeid(vsg::ubvec4Array))) &&
+               data.stride() == data.valueSize();
+    }
+
+    template <class A>
+    vsg::ref_ptr<vsg::Data> concatenate(const std::vector<vsg::ref_ptr<vsg::Data>>& parts, size_t total)
+    {
+        auto result = A::create(static_cast<uint32_t>(total));
+        auto dest = static_cast<uint8_t*>(result->dataPointer());
+        for (auto& part : parts)
+        {
+            std::memcpy(dest, part->dataPointer(), part->dataSize());
+            dest += part->dataSize();
+        }
+        return result;
+    }
+
+    vsg::ref_ptr<vsg::Data> concatenate(const std::vector<vsg::ref_ptr<vsg::Data>>& parts, size_t total)
+    {
+        auto& first = *parts.front();
+        if (first.is_compatible(typeid(vsg::vec2Array))) return concatenate<vsg::vec2Array>(parts, total);
+        if (first.is_compatible(typeid(vsg::vec3Array))) return concatenate<vsg::vec3Array>(parts, total);
+        if (first.is_compatible(typeid(vsg::vec4Array))) return concatenate<vsg::vec4Array>(parts, total);
+        return concatenate<vsg::ubvec4Array>(parts, total);
+    }
+}
+
+void FlattenStaticTransforms::apply(vsg::Node& node)
+{
+    node.traverse(*this);
+}
+
+void FlattenStaticTransforms::apply(vsg::Group& group)
+{
+    if (!visited.insert(&group).second) return;
+
+    vsg::Group::Children children;
+    for (auto& child : group.children)
+    {
+        auto transform = child.cast<vsg::MatrixTransform>();
+        if (!transform || !isStatic(transform.get()))
+        {
+            children.push_back(child);
+            continue;
+        }
+
+        //Counts from a subgraph that turns out not to be bakeable are dropped with its copies
+        auto baseBaked = transformsBaked;
+        auto baseVertices = verticesBaked;
+        vsg::Group::Children baked;
+        if (bake(transform, vsg::dmat4(), baked))
+        {
+            children.insert(children.end(), baked.begin(), baked.end());
+        }
+        else
+        {
+            transformsBaked = baseBaked;
+            verticesBaked = baseVertices;
+            children.push_back(collapse(transform));
+        }
+    }
+
+    mergeSiblings(children);
+    group.children = children;
+
+    group.traverse(*this);
+}
+
+bool FlattenStaticTransforms::isStatic(const vsg::Node* node) const
+{
+    return typeid(*node) == typeid(vsg::MatrixTransform) && dynamicNodes.count(node) == 0;
+}
+
+bool FlattenStaticTransforms::bake(const vsg::ref_ptr<vsg::Node>& node, const vsg::dmat4& matrix, vsg::Group::Children& baked)
+{
+    if (!node || dynamicNodes.count(node.get()) > 0) return false;
+
+    auto& type = typeid(*node);
+    vsg::Group::Children children;
+
+    auto bakeChildren = [&](const vsg::Group& group, const vsg::dmat4& childMatrix) {
+        for (auto& child : group.children)
+        {
+            if (!bake(child, childMatrix, children)) return false;
+        }
+        return true;
+    };
+
+    if (type == typeid(vsg::MatrixTransform))
+    {
+        auto& transform = static_cast<const vsg::MatrixTransform&>(*node);
+        if (!bakeChildren(transform, matrix * transform.matrix)) return false;
+        baked.insert(baked.end(), children.begin(), children.end());
+        ++transformsBaked;
+        return true;
+    }
+
+    if (type == typeid(vsg::Group))
+    {
+        if (!bakeChildren(static_cast<const vsg::Group&>(*node), matrix)) return false;
+        baked.insert(baked.end(), children.begin(), children.end());
+        return true;
+    }
+
+    if (type == typeid(vsg::StateGroup))
+    {
+        auto& stateGroup = static_cast<const vsg::StateGroup&>(*node);
+        if (!bakeChildren(stateGroup, matrix)) return false;
+
+        auto copy = vsg::StateGroup::create();
+        copy->stateCommands = stateGroup.stateCommands;
+        copy->prototypeArrayState = stateGroup.prototypeArrayState;
+        copy->children = children;
+        baked.push_back(copy);
+        return true;
+    }
+
+    if (type == typeid(vsg::CullGroup))
+    {
+        auto& cullGroup = static_cast<const vsg::CullGroup&>(*node);
+        if (!bakeChildren(cullGroup, matrix)) return false;
+
+        auto copy = vsg::CullGroup::create();
+        copy->bound = transformBound(cullGroup.bound, matrix);
+        copy->children = children;
+        baked.push_back(copy);
+        return true;
+    }
+
+    if (type == typeid(vsg::CullNode))
+    {
+        auto& cullNode = static_cast<const vsg::CullNode&>(*node);
+        if (!bake(cullNode.child, matrix, children)) return false;
+        if (children.empty()) return true;
+
+        vsg::ref_ptr<vsg::Node> child = children.front();
+        if (children.size() > 1)
+        {
+            auto group = vsg::Group::create();
+            group->children = children;
+            child = group;
+        }
+        baked.push_back(vsg::CullNode::create(transformBound(cullNode.bound, matrix), child));
+        return true;
+    }
+
+    if (type == typeid(vsg::VertexIndexDraw))
+    {
+        auto draw = bakeDraw(node.cast<vsg::VertexIndexDraw>(), matrix);
+        if (!draw) return false;
+        baked.push_back(draw);
+        return true;
+    }
+
+    return false;
+}
+
+vsg::ref_ptr<vsg::VertexIndexDraw> FlattenStaticTransforms::bakeDraw(const vsg::ref_ptr<vsg::VertexIndexDraw>& draw, const vsg::dmat4& matrix)
+{
+    //Instanced draws carry per instance positions the matrix would also have to move
+    if (draw->arrays.empty() || draw->instanceCount != 1 || !draw->indices) return {};
+    if (!std::all_of(draw->arrays.begin(), draw->arrays.end(), isStaticData)) return {};
+
+    auto vertices = draw->arrays[0]->data.cast<vsg::vec3Array>();
+    if (!vertices || vertices->stride() != sizeof(vsg::vec3)) return {};
+
+    if (isIdentity(matrix)) return draw;
+
+    auto bakedVertices = vsg::vec3Array::create(static_cast<uint32_t>(vertices->size()));
+    for (size_t i = 0; i < vertices->size(); ++i)
+    {
+        (*bakedVertices)[i] = vsg::vec3(matrix * vsg::dvec3((*vertices)[i]));
+    }
+
+    vsg::DataList arrays{bakedVertices};
+    for (size_t i = 1; i < draw->arrays.size(); ++i)
+    {
+        //The second array holds the normals when it is one vec3 per vertex, as Builder and vsgXchange lay them out
+        auto normals = draw->arrays[i]->data.cast<vsg::vec3Array>();
+        if (i == 1 && normals && normals->size() == vertices->size() && normals->stride() == sizeof(vsg::vec3))
+        {
+            auto normalMatrix = vsg::transpose(vsg::inverse(matrix));
+            auto bakedNormals = vsg::vec3Array::create(static_cast<uint32_t>(normals->size()));
+            for (size_t n = 0; n < normals->size(); ++n)
+            {
+                auto normal = normalMatrix * vsg::dvec4(vsg::dvec3((*normals)[n]), 0.0);
+                (*bakedNormals)[n] = vsg::vec3(vsg::normalize(vsg::dvec3(normal.x, normal.y, normal.z)));
+            }
+            arrays.push_back(bakedNormals);
+        }
+        else
+        {
+            arrays.push_back(draw->arrays[i]->data);
+        }
+    }
+
+    auto baked = vsg::VertexIndexDraw::create();
+    baked->assignArrays(arrays);
+    baked->assignIndices(draw->indices->data);
+    baked->firstBinding = draw->firstBinding;
+    baked->indexCount = draw->indexCount;
+    baked->instanceCount = draw->instanceCount;
+    baked->firstIndex = draw->firstIndex;
+    baked->vertexOffset = draw->vertexOffset;
+    baked->firstInstance = draw->firstInstance;
+
+    verticesBaked += vertices->size();
+    return baked;
+}
+
+vsg::ref_ptr<vsg::MatrixTransform> FlattenStaticTransforms::collapse(vsg::ref_ptr<vsg::MatrixTransform> transform)
+{
+    while (transform->children.size() == 1 && isStatic(transform->children.front().get()))
+    {
+        auto child = transform->children.front().cast<vsg::MatrixTransform>();
+
+        //A new transform so a subgraph shared with another parent is left as it was
+        auto combined = vsg::MatrixTransform::create(transform->matrix * child->matrix);
+        combined->children = child->children;
+        transform = combined;
+        ++transformsCollapsed;
+    }
+    return transform;
+}
+
+void FlattenStaticTransforms::mergeSiblings(vsg::Group::Children& children)
+{
+    auto candidate = [&](const vsg::ref_ptr<vsg::Node>& node, MergeCandidate& result) {
+        if (!node || typeid(*node) != typeid(vsg::StateGroup)) return false;
+
+        auto stateGroup = node.cast<vsg::StateGroup>();
+        if (stateGroup->children.size() != 1 || !stateGroup->children.front() || typeid(*stateGroup->children.front()) != typeid(vsg::VertexIndexDraw)) return false;
+
+        auto draw = stateGroup->children.front().cast<vsg::VertexIndexDraw>();
+        if (draw->arrays.empty() || draw->instanceCount != 1 || draw->firstIndex != 0 || draw->vertexOffset != 0 || !isStaticData(draw->indices)) return false;
+        if (draw->indexCount != indexCount(*draw->indices->data)) return false;
+        if (!std::all_of(draw->arrays.begin(), draw->arrays.end(), isStaticData)) return false;
+
+        result.stateGroup = stateGroup;
+        result.draw = draw;
+        result.vertexCount = draw->arrays[0]->data->valueCount();
+        if (result.vertexCount < 2) return false;
+
+        //Every array is either one value per vertex or a single value shared by the one instance
+        for (auto& array : draw->arrays)
+        {
+            auto count = array->data->valueCount();
+            if (count == result.vertexCount && !concatenatable(*array->data)) return false;
+            if (count != result.vertexCount && count != 1) return false;
+        }
+        return true;
+    };
+
+    auto compatible = [](const MergeCandidate& a, const MergeCandidate& b) {
+        if (a.stateGroup->stateCommands != b.stateGroup->stateCommands || a.stateGroup->prototypeArrayState != b.stateGroup->prototypeArrayState) return false;
+        if (a.draw->firstBinding != b.draw->firstBinding || a.draw->firstInstance != b.draw->firstInstance || a.draw->arrays.size() != b.draw->arrays.size()) return false;
+
+        for (size_t i = 0; i < a.draw->arrays.size(); ++i)
+        {
+            auto& dataA = *a.draw->arrays[i]->data;
+            auto& dataB = *b.draw->arrays[i]->data;
+            if (typeid(dataA) != typeid(dataB)) return false;
+
+            bool perVertexA = dataA.valueCount() == a.vertexCount;
+            bool perVertexB = dataB.valueCount() == b.vertexCount;
+            if (perVertexA != perVertexB) return false;
+
+            //Per instance values, such as Builder's colour, have to match exactly to be drawn as one
+            if (!perVertexA && (dataA.dataSize() != dataB.dataSize() || std::memcmp(dataA.dataPointer(), dataB.dataPointer(), dataA.dataSize()) != 0)) return false;
+        }
+        return true;
+    };
+
+    auto merge = [&](const std::vector<MergeCandidate>& run) {
+        size_t totalVertices = 0;
+        size_t totalIndices = 0;
+        for (auto& part : run)
+        {
+            totalVertices += part.vertexCount;
+            totalIndices += part.draw->indexCount;
+        }
+
+        vsg::DataList arrays;
+        auto& first = run.front();
+        for (size_t i = 0; i < first.draw->arrays.size(); ++i)
+        {
+            if (first.draw->arrays[i]->data->valueCount() != first.vertexCount)
+            {
+                arrays.push_back(first.draw->arrays[i]->data);
+                continue;
+            }
+
+            std::vector<vsg::ref_ptr<vsg::Data>> parts;
+            for (auto& part : run) parts.push_back(part.draw->arrays[i]->data);
+            arrays.push_back(concatenate(parts, totalVertices));
+        }
+
+        //Indices offset by the vertices of the draws before, 16 bit while they fit
+        std::vector<uint32_t> indices;
+        indices.reserve(totalIndices);
+        uint32_t base = 0;
+        for (auto& part : run)
+        {
+            auto& partIndices = *part.draw->indices->data;
+            for (size_t i = 0; i < part.draw->indexCount; ++i) indices.push_back(base + readIndex(partIndices, i));
+            base += static_cast<uint32_t>(part.vertexCount);
+        }
+
+        vsg::ref_ptr<vsg::Data> indexData;
+        if (totalVertices <= 65536)
+        {
+            auto shortIndices = vsg::ushortArray::create(static_cast<uint32_t>(indices.size()));
+            for (size_t i = 0; i < indices.size(); ++i) (*shortIndices)[i] = static_cast<uint16_t>(indices[i]);
+            indexData = shortIndices;
+        }
+        else
+        {
+            auto intIndices = vsg::uintArray::create(static_cast<uint32_t>(indices.size()));
+            std::copy(indices.begin(), indices.end(), intIndices->begin());
+            indexData = intIndices;
+        }
+
+        auto draw = vsg::VertexIndexDraw::create();
+        draw->assignArrays(arrays);
+        draw->assignIndices(indexData);
+        draw->firstBinding = first.draw->firstBinding;
+        draw->indexCount = static_cast<uint32_t>(indices.size());
+        draw->instanceCount = 1;
+        draw->firstInstance = first.draw->firstInstance;
+
+        auto stateGroup = vsg::StateGroup::create();
+        stateGroup->stateCommands = first.stateGroup->stateCommands;
+        stateGroup->prototypeArrayState = first.stateGroup->prototypeArrayState;
+        stateGroup->addChild(draw);
+
+        drawsMerged += run.size() - 1;
+        return stateGroup;
+    };
+
+    //Only neighbours are merged so draws keep their order relative to other state, which blending can depend on
+    vsg::Group::Children merged;
+    std::vector<MergeCandidate> run;
+    auto flush = [&]() {
+        if (run.size() > 1) merged.push_back(merge(run));
+        else if (run.size() == 1) merged.push_back(run.front().stateGroup);
+        run.clear();
+    };
+
+    for (auto& child : children)
+    {
+        MergeCandidate next;
+        if (!candidate(child, next))
+        {
+            flush();
+            merged.push_back(child);
+            continue;
+        }
+
+        if (!run.empty() && !compatible(run.front(), next)) flush();
+        run.push_back(next);
+    }
+    flush();
+
+    children = merged;
+}
+
+void FlattenStaticTransforms::report(std::ostream& out) const
+{
+    out << "Flattened static transforms: " << transformsBaked << " baked into " << verticesBaked << " vertices, " << transformsCollapsed
+        << " collapsed, " << drawsMerged << " draws merged into their neighbours" << std::endl;
+}
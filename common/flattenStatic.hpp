@@ -0,0 +1,42 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <iostream>
+#include <set>
+
+//Removes static transforms from a scene graph and merges the draws they leave side by side
+//A static MatrixTransform is baked into copies of the vertex and normal arrays below it, so its modelview push goes away,
+//where something below it cannot be baked (lights, LODs, text, dynamic data) a chain of them is collapsed into one matrix
+//Consecutive sibling StateGroups with the same state commands, each drawing one VertexIndexDraw, become one draw
+//Transforms passed to keep() are the ones the app moves, they are left where they are with their own matrix
+class FlattenStaticTransforms : public vsg::Inherit<vsg::Visitor, FlattenStaticTransforms>
+{
+public:
+    void keep(vsg::ref_ptr<vsg::Node> node) { dynamicNodes.insert(node.get()); }
+
+    void apply(vsg::Node& node) override;
+    void apply(vsg::Group& group) override;
+
+    //Transforms baked away or collapsed into another, draws removed by merging and vertices copied while baking
+    uint64_t transformsBaked = 0;
+    uint64_t transformsCollapsed = 0;
+    uint64_t drawsMerged = 0;
+    uint64_t verticesBaked = 0;
+
+    void report(std::ostream& out) const;
+
+private:
+    std::set<const vsg::Node*> dynamicNodes;
+    std::set<const vsg::Node*> visited;
+
+    bool isStatic(const vsg::Node* node) const;
+
+    //Append copies of node with matrix applied to baked, false if anything below it cannot be baked
+    bool bake(const vsg::ref_ptr<vsg::Node>& node, const vsg::dmat4& matrix, vsg::Group::Children& baked);
+    vsg::ref_ptr<vsg::VertexIndexDraw> bakeDraw(const vsg::ref_ptr<vsg::VertexIndexDraw>& draw, const vsg::dmat4& matrix);
+
+    //A static transform whose only child is another becomes one transform with both matrices
+    vsg::ref_ptr<vsg::MatrixTransform> collapse(vsg::ref_ptr<vsg::MatrixTransform> transform);
+
+    void mergeSiblings(vsg::Group::Children& children);
+};
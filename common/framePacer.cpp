@@ -0,0 +1,100 @@
+#include "framePacer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+FramePacer::FramePacer(bool _enabled) : enabled(_enabled)
+{
+    lastPresent = vsg::clock::now();
+    lastAcquire = lastPresent;
+    workStart = lastPresent;
+    period = 1.0 / 60.0;
+    workEstimate = 0.0;
+    haveInput = false;
+    frames = 0;
+    totalSleep = 0.0;
+    latencySamples = 0;
+    latencySum = 0.0;
+    latencyMax = 0.0;
+}
+
+void FramePacer::beginFrame(vsg::ref_ptr<vsg::Viewer> viewer)
+{
+    auto acquire = vsg::clock::now();
+    if (frames > 0)
+    {
+        //Track the refresh period from the acquire cadence, ignoring hitches once warmed up
+        double interval = std::chrono::duration<double>(acquire - lastAcquire).count();
+        if (interval > 0.0 && (frames < 60 || interval < period * 1.5)) period += (interval - period) * 0.05;
+    }
+    lastAcquire = acquire;
+
+    if (enabled && frames > 0)
+    {
+        //Start the work so that it completes just before the vsync after the last present
+        double target = period - workEstimate - safetyMargin;
+        auto wakeTime = lastPresent + std::chrono::duration_cast<vsg::clock::duration>(std::chrono::duration<double>(target));
+        auto now = vsg::clock::now();
+        if (wakeTime > now)
+        {
+            std::this_thread::sleep_until(wakeTime);
+            totalSleep += std::chrono::duration<double>(vsg::clock::now() - now).count();
+
+            //Pick up any input that arrived while sleeping so it is handled this frame
+            for (auto& window : viewer->windows())
+            {
+                window->pollEvents(viewer->getEvents());
+            }
+        }
+    }
+
+    noteInput(viewer->getEvents());
+    workStart = vsg::clock::now();
+}
+
+void FramePacer::endFrame()
+{
+    lastPresent = vsg::clock::now();
+
+    //Follow increases in work immediately and decay slowly so one short frame does not cause a miss
+    double work = std::chrono::duration<double>(lastPresent - workStart).count();
+    workEstimate = std::max(work, workEstimate * 0.98 + work * 0.02);
+
+    if (haveInput)
+    {
+        double latency = std::chrono::duration<double>(lastPresent - oldestInput).count();
+        latencySum += latency;
+        latencyMax = std::max(latencyMax, latency);
+        ++latencySamples;
+        haveInput = false;
+    }
+    ++frames;
+}
+
+void FramePacer::noteInput(const vsg::UIEvents& events)
+{
+    for (auto& event : events)
+    {
+        if (!event.cast<vsg::KeyEvent>() && !event.cast<vsg::PointerEvent>() && !event.cast<vsg::ScrollWheelEvent>()) continue;
+
+        if (!haveInput || event->time < oldestInput)
+        {
+            oldestInput = event->time;
+            haveInput = true;
+        }
+    }
+}
+
+void FramePacer::report(std::ostream& out) const
+{
+    out << "Frame pacing " << (enabled ? "on" : "off") << ": estimated refresh " << (1.0 / period) << " Hz, work "
+        << workEstimate * 1000.0 << " ms";
+    if (frames > 0) out << ", average sleep " << totalSleep * 1000.0 / static_cast<double>(frames) << " ms";
+    out << std::endl;
+
+    if (latencySamples > 0)
+    {
+        out << "Input to present latency: average " << latencySum * 1000.0 / static_cast<double>(latencySamples)
+            << " ms, max " << latencyMax * 1000.0 << " ms over " << latencySamples << " frames with input" << std::endl;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <iostream>
+
+//Frame pacing for lower input-to-photon latency, enabled with --pacing
+//Instead of starting work as soon as a swapchain image is free, beginFrame() sleeps so that
+//update+record start as late as possible before the next vsync, then polls the windows again
+//so the freshest input is used when the camera is latched.
+class FramePacer
+{
+public:
+    FramePacer(bool _enabled);
+
+    bool enabled;
+
+    //Time (seconds) left spare between the predicted end of the frame's work and vsync
+    double safetyMargin = 0.002;
+
+    //Call straight after viewer->advanceToNextFrame(), sleeps when pacing is enabled
+    void beginFrame(vsg::ref_ptr<vsg::Viewer> viewer);
+
+    //Call straight after viewer->present()
+    void endFrame();
+
+    //Print pacing and input-to-present latency statistics
+    void report(std::ostream& out) const;
+
+private:
+    //Scans the viewer's events for the oldest input event of this frame
+    void noteInput(const vsg::UIEvents& events);
+
+    vsg::time_point lastPresent;
+    vsg::time_point lastAcquire;
+    vsg::time_point workStart;
+
+    //Estimated refresh period and update+record+submit+present duration in seconds
+    double period;
+    double workEstimate;
+
+    //Oldest input event consumed by the current frame
+    bool haveInput;
+    vsg::time_point oldestInput;
+
+    uint64_t frames;
+    double totalSleep;
+    uint64_t latencySamples;
+    double latencySum;
+    double latencyMax;
+};
@@ -0,0 +1,204 @@
+#include "frameStats.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+GpuFrameTimer::GpuFrameTimer() : frameIndex(0), timestampPeriod(1.0), supported(true)
+{
+    for (auto& queryPool : queryPools)
+    {
+        queryPool = vsg::QueryPool::create();
+        queryPool->queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPool->queryCount = 2;
+    }
+    beginTimestamp = Timestamp::create(this, true);
+    endTimestamp = Timestamp::create(this, false);
+    results.resize(2);
+}
+
+void GpuFrameTimer::Timestamp::compile(vsg::Context& context)
+{
+    if (!begin) return;
+
+    auto& limits = context.device->getPhysicalDevice()->getProperties().limits;
+    timer->supported = limits.timestampComputeAndGraphics == VK_TRUE;
+    timer->timestampPeriod = limits.timestampPeriod;
+
+    for (auto& queryPool : timer->queryPools)
+    {
+        queryPool->compile(context);
+    }
+}
+
+void GpuFrameTimer::Timestamp::record(vsg::CommandBuffer& commandBuffer) const
+{
+    if (!timer->supported) return;
+
+    auto& queryPool = timer->queryPools[timer->frameIndex.load() % numSlots];
+    if (begin)
+    {
+        vkCmdResetQueryPool(commandBuffer, queryPool->vk(), 0, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool->vk(), 0);
+    }
+    else
+    {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool->vk(), 1);
+    }
+}
+
+void GpuFrameTimer::assign(vsg::ref_ptr<vsg::CommandGraph> commandGraph)
+{
+    commandGraph->children.insert(commandGraph->children.begin(), beginTimestamp);
+    commandGraph->children.push_back(endTimestamp);
+}
+
+bool GpuFrameTimer::read(uint64_t frame, double& milliseconds)
+{
+    if (!supported) return false;
+
+    //Never wait, a result that is not ready yet is simply skipped
+    if (queryPools[frame % numSlots]->getResults(results, 0, VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) return false;
+
+    milliseconds = static_cast<double>(results[1] - results[0]) * timestampPeriod * 1e-6;
+    return true;
+}
+
+FrameStats::FrameStats(size_t capacity) : samples(capacity), count(0), current{}, excluded(0.0f), started(false)
+{
+}
+
+void FrameStats::beginFrame()
+{
+    auto now = vsg::clock::now();
+    if (started)
+    {
+        current.frame = std::chrono::duration<float, std::chrono::milliseconds::period>(now - frameStart).count() - excluded;
+        samples[count % samples.size()] = current;
+        ++count;
+    }
+    started = true;
+    frameStart = now;
+    lastMark = now;
+    excluded = 0.0f;
+    current = FrameSample{0.0f, 0.0f, 0.0f, 0.0f, -1.0f};
+
+    if (gpuTimer) gpuTimer->frameIndex = count;
+}
+
+void FrameStats::mark(Phase phase)
+{
+    auto now = vsg::clock::now();
+    float duration = std::chrono::duration<float, std::chrono::milliseconds::period>(now - lastMark).count();
+    lastMark = now;
+
+    switch (phase)
+    {
+    case UPDATE: current.update += duration; break;
+    case RECORD: current.record += duration; break;
+    case PRESENT: current.present += duration; break;
+    }
+}
+
+void FrameStats::exclude()
+{
+    auto now = vsg::clock::now();
+    excluded += std::chrono::duration<float, std::chrono::milliseconds::period>(now - lastMark).count();
+    lastMark = now;
+}
+
+void FrameStats::endFrame()
+{
+    if (!gpuTimer) return;
+
+    //The slot of the oldest frame still in the query pool ring has had time to complete
+    uint64_t lag = GpuFrameTimer::numSlots - 1;
+    if (count < lag) return;
+
+    uint64_t frame = count - lag;
+    double milliseconds;
+    if (frame < count && count - frame <= samples.size() && gpuTimer->read(frame, milliseconds))
+    {
+        samples[frame % samples.size()].gpu = static_cast<float>(milliseconds);
+    }
+}
+
+std::vector<FrameSample> FrameStats::history() const
+{
+    std::vector<FrameSample> ordered;
+    ordered.reserve(size());
+    for (uint64_t i = count - size(); i < count; ++i)
+    {
+        ordered.push_back(samples[i % samples.size()]);
+    }
+    return ordered;
+}
+
+void FrameStats::report(std::ostream& out) const
+{
+    auto ordered = history();
+    if (ordered.empty()) return;
+
+    auto printRow = [&](const char* name, float FrameSample::*member) {
+        std::vector<float> values;
+        values.reserve(ordered.size());
+        for (auto& sample : ordered)
+        {
+            if (sample.*member >= 0.0f) values.push_back(sample.*member);
+        }
+        if (values.empty()) return;
+
+        auto percentile = [&](double p) {
+            size_t index = std::min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size())));
+            std::nth_element(values.begin(), values.begin() + index, values.end());
+            return values[index];
+        };
+
+        out << std::setw(10) << name
+            << std::setw(10) << percentile(0.50)
+            << std::setw(10) << percentile(0.95)
+            << std::setw(10) << percentile(0.99)
+            << std::setw(10) << *std::max_element(values.begin(), values.end()) << std::endl;
+    };
+
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "Frame times (ms) over the last " << ordered.size() << " frames" << std::endl;
+    out << std::setw(10) << "" << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+    printRow("frame", &FrameSample::frame);
+    printRow("update", &FrameSample::update);
+    printRow("record", &FrameSample::record);
+    printRow("present", &FrameSample::present);
+    printRow("gpu", &FrameSample::gpu);
+
+    auto overBudget = std::count_if(ordered.begin(), ordered.end(), [&](const FrameSample& sample) { return sample.frame > budget; });
+    out << "Frames over the " << budget << " ms budget: " << overBudget << " ("
+        << 100.0 * static_cast<double>(overBudget) / static_cast<double>(ordered.size()) << "%)" << std::endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool FrameStats::writeCSV(const std::string& filename) const
+{
+    std::ofstream fout(filename);
+    if (!fout) return false;
+
+    fout << "frame,frame_ms,update_ms,record_ms,present_ms,gpu_ms\n";
+    uint64_t frame = count - size();
+    for (auto& sample : history())
+    {
+        fout << frame++ << ',' << sample.frame << ',' << sample.update << ',' << sample.record << ',' << sample.present << ',';
+        if (sample.gpu >= 0.0f) fout << sample.gpu;
+        fout << '\n';
+    }
+    return static_cast<bool>(fout);
+}
+
+void FrameStatsOptions::read(vsg::CommandLine& arguments)
+{
+    arguments.read("--frame-csv", csvFilename);
+    arguments.read("--budget", budget);
+    if (arguments.read("--no-gpu-time")) gpuTime = false;
+}
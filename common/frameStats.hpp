@@ -0,0 +1,120 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Per frame timings in milliseconds
+struct FrameSample
+{
+    float frame;   //advanceToNextFrame() to advanceToNextFrame(), includes waiting for the swapchain but not excluded time
+    float update;  //event handling, app update and viewer->update()
+    float record;  //viewer->recordAndSubmit(), vsg records and submits in one call
+    float present; //viewer->present()
+    float gpu;     //GPU time from timestamp queries, negative when not available
+};
+
+//Writes GPU timestamps at the start and end of a command graph
+//A small ring of query pools is used so results can be read without stalling on the frames in flight
+class GpuFrameTimer : public vsg::Inherit<vsg::Object, GpuFrameTimer>
+{
+public:
+    GpuFrameTimer();
+
+    //Number of query pools, must exceed the number of frames in flight
+    static constexpr uint32_t numSlots = 4;
+
+    class Timestamp : public vsg::Inherit<vsg::Command, Timestamp>
+    {
+    public:
+        Timestamp(GpuFrameTimer* _timer, bool _begin) : timer(_timer), begin(_begin) {}
+
+        GpuFrameTimer* timer;
+        bool begin;
+
+        void compile(vsg::Context& context) override;
+        void record(vsg::CommandBuffer& commandBuffer) const override;
+    };
+
+    //Insert the begin/end timestamp commands around the children of a command graph
+    void assign(vsg::ref_ptr<vsg::CommandGraph> commandGraph);
+
+    //Set by FrameStats before each recordAndSubmit()
+    std::atomic<uint64_t> frameIndex;
+
+    //Read the GPU time of an earlier frame, returns false when it is not available yet
+    bool read(uint64_t frame, double& milliseconds);
+
+private:
+    vsg::ref_ptr<vsg::QueryPool> queryPools[numSlots];
+    vsg::ref_ptr<Timestamp> beginTimestamp;
+    vsg::ref_ptr<Timestamp> endTimestamp;
+    double timestampPeriod;
+    bool supported;
+    std::vector<uint64_t> results;
+};
+
+//Frame time statistics kept in a fixed size ring buffer
+//Recording is a few clock reads per frame, percentiles are only computed in report()
+class FrameStats
+{
+public:
+    enum Phase
+    {
+        UPDATE,
+        RECORD,
+        PRESENT
+    };
+
+    FrameStats(size_t capacity = 16384);
+
+    //Frames longer than this (milliseconds) are counted as over budget
+    double budget = 1000.0 / 60.0;
+
+    //Optional GPU timer, assign() it to the command graph before viewer->compile()
+    vsg::ref_ptr<GpuFrameTimer> gpuTimer;
+
+    //Call straight after viewer->advanceToNextFrame()
+    void beginFrame();
+
+    //Attribute the time since the last call (or beginFrame) to a phase
+    void mark(Phase phase);
+
+    //Leave the time since the last mark out of every phase and the frame time, for work that is only there to measure
+    void exclude();
+
+    //Call after viewer->present()
+    void endFrame();
+
+    size_t size() const { return count < samples.size() ? static_cast<size_t>(count) : samples.size(); }
+
+    //Samples in recording order, oldest first
+    std::vector<FrameSample> history() const;
+
+    //Print p50/p95/p99/max of each phase and the number of frames over budget
+    void report(std::ostream& out) const;
+
+    //Write every sample in the ring buffer as CSV
+    bool writeCSV(const std::string& filename) const;
+
+private:
+    std::vector<FrameSample> samples;
+    uint64_t count;
+    FrameSample current;
+    vsg::time_point frameStart;
+    vsg::time_point lastMark;
+    float excluded;
+    bool started;
+};
+
+//Read the --frame-csv, --budget and --no-gpu-time options shared by every app
+struct FrameStatsOptions
+{
+    std::string csvFilename;
+    double budget = 1000.0 / 60.0;
+    bool gpuTime = true;
+
+    void read(vsg::CommandLine& arguments);
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//Layout of the shared memory segment written by MetricsPublisher and read by the metrics CLI
+//Kept free of vsg so the reader does not need to link against it
+
+constexpr uint32_t METRICS_MAGIC = 0x4d535356; //"VSSM"
+constexpr uint32_t METRICS_VERSION = 1;
+
+//One published sample, all values cover the last publish interval unless noted
+struct MetricsData
+{
+    uint64_t pid;
+    uint64_t frameCount;      //total frames rendered since startup
+    double uptime;            //seconds since the publisher was created
+    double frameTimeAverage;  //milliseconds
+    double frameTimeMax;      //milliseconds
+    double framesPerSecond;
+    uint64_t entityCount;     //transforms in the scene graph
+    uint64_t drawCount;       //draw commands in the scene graph
+    uint64_t gpuMemoryAllocated; //bytes of device local memory allocated by vsg
+    uint64_t gpuMemoryUsed;      //bytes of that memory handed out to buffers and images
+    double simulationStepsPerSecond;
+    char application[32];
+};
+
+//Written with a sequence lock, the sequence is odd while an update is in progress
+//Readers never block the writer, they retry if the sequence changed while copying
+struct MetricsSegment
+{
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint32_t> sequence;
+    MetricsData data;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "the sequence must be lock free to be shared between processes");
+
+//Name of the POSIX shared memory object for a metrics name given on the command line
+inline std::string metricsSegmentName(const std::string& name)
+{
+    return "/vsg_metrics_" + name;
+}
+
+inline void writeMetrics(MetricsSegment& segment, const MetricsData& data)
+{
+    uint32_t sequence = segment.sequence.load(std::memory_order_relaxed);
+    segment.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    segment.data = data;
+    std::atomic_thread_fence(std::memory_order_release);
+    segment.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+//Returns false if a consistent copy could not be made within the given number of attempts
+inline bool readMetrics(const MetricsSegment& segment, MetricsData& data, int attempts = 1000)
+{
+    for (int i = 0; i < attempts; ++i)
+    {
+        uint32_t before = segment.sequence.load(std::memory_order_acquire);
+        if (before & 1) continue;
+
+        data = segment.data;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (segment.sequence.load(std::memory_order_relaxed) == before) return true;
+    }
+    return false;
+}
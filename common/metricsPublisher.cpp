@@ -0,0 +1,141 @@
+#include "metricsPublisher.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+    //Counts transforms and draw commands, shared subgraphs are counted each time they are reached as they are when rendering
+    class SceneCounter : public vsg::Inherit<vsg::ConstVisitor, SceneCounter>
+    {
+    public:
+        uint64_t entities = 0;
+        uint64_t draws = 0;
+
+        void apply(const vsg::Node& node) override { node.traverse(*this); }
+        void apply(const vsg::Transform& transform) override
+        {
+            ++entities;
+            transform.traverse(*this);
+        }
+        void apply(const vsg::Draw&) override { ++draws; }
+        void apply(const vsg::DrawIndexed&) override { ++draws; }
+        void apply(const vsg::VertexDraw&) override { ++draws; }
+        void apply(const vsg::VertexIndexDraw&) override { ++draws; }
+    };
+}
+
+MetricsPublisher::MetricsPublisher(const std::string& _name, const std::string& application) : name(_name)
+{
+    startTime = vsg::clock::now();
+    lastFrame = startTime;
+    lastPublish = startTime;
+
+    if (name.empty()) return;
+
+    auto segmentName = metricsSegmentName(name);
+    int fd = shm_open(segmentName.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        std::cout << "Unable to create metrics segment " << segmentName << std::endl;
+        return;
+    }
+
+    if (ftruncate(fd, sizeof(MetricsSegment)) == 0)
+    {
+        void* ptr = mmap(nullptr, sizeof(MetricsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ptr != MAP_FAILED) segment = new (ptr) MetricsSegment;
+    }
+    close(fd);
+
+    if (!segment)
+    {
+        std::cout << "Unable to map metrics segment " << segmentName << std::endl;
+        shm_unlink(segmentName.c_str());
+        return;
+    }
+
+    data.pid = static_cast<uint64_t>(getpid());
+    std::strncpy(data.application, application.c_str(), sizeof(data.application) - 1);
+
+    segment->sequence.store(0, std::memory_order_relaxed);
+    writeMetrics(*segment, data);
+    segment->version = METRICS_VERSION;
+    segment->magic = METRICS_MAGIC;
+
+    std::cout << "Publishing metrics to " << segmentName << std::endl;
+}
+
+MetricsPublisher::~MetricsPublisher()
+{
+    if (!segment) return;
+
+    munmap(segment, sizeof(MetricsSegment));
+    shm_unlink(metricsSegmentName(name).c_str());
+}
+
+void MetricsPublisher::endFrame()
+{
+    if (!segment) return;
+
+    auto now = vsg::clock::now();
+    double frameTime = std::chrono::duration<double, std::chrono::milliseconds::period>(now - lastFrame).count();
+    lastFrame = now;
+
+    ++data.frameCount;
+    ++intervalFrames;
+    intervalFrameTime += frameTime;
+    intervalFrameMax = std::max(intervalFrameMax, frameTime);
+
+    if (std::chrono::duration<double>(now - lastPublish).count() >= interval) publish(now);
+}
+
+void MetricsPublisher::publish(vsg::time_point now)
+{
+    double elapsed = std::chrono::duration<double>(now - lastPublish).count();
+    lastPublish = now;
+
+    data.uptime = std::chrono::duration<double>(now - startTime).count();
+    data.frameTimeAverage = intervalFrameTime / static_cast<double>(intervalFrames);
+    data.frameTimeMax = intervalFrameMax;
+    data.framesPerSecond = static_cast<double>(intervalFrames) / elapsed;
+
+    uint64_t steps = simulationSteps.load(std::memory_order_relaxed);
+    data.simulationStepsPerSecond = static_cast<double>(steps - lastSimulationSteps) / elapsed;
+    lastSimulationSteps = steps;
+
+    //Once a second is cheap enough to walk the whole scene, which also picks up paged or loaded models
+    if (scene)
+    {
+        SceneCounter counter;
+        scene->accept(counter);
+        data.entityCount = counter.entities;
+        data.drawCount = counter.draws;
+    }
+
+    data.gpuMemoryAllocated = 0;
+    data.gpuMemoryUsed = 0;
+    for (auto& deviceMemory : vsg::getActiveDeviceMemoryList(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+    {
+        data.gpuMemoryAllocated += deviceMemory->getMemoryRequirements().size;
+        data.gpuMemoryUsed += deviceMemory->totalReservedSize();
+    }
+
+    writeMetrics(*segment, data);
+
+    intervalFrames = 0;
+    intervalFrameTime = 0.0;
+    intervalFrameMax = 0.0;
+}
+
+std::string readMetricsName(vsg::CommandLine& arguments)
+{
+    std::string name;
+    arguments.read("--metrics", name);
+    return name;
+}
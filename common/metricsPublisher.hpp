@@ -0,0 +1,54 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <atomic>
+#include <string>
+
+#include "metricsBlock.hpp"
+
+//Publishes live metrics to a POSIX shared memory segment (/dev/shm/vsg_metrics_<name>) about once a second
+//Read them from another terminal with the metrics tool, nothing is opened on the network
+class MetricsPublisher
+{
+public:
+    //An empty name leaves the publisher disabled, every call is then a no-op
+    MetricsPublisher(const std::string& _name, const std::string& application);
+    ~MetricsPublisher();
+
+    MetricsPublisher(const MetricsPublisher&) = delete;
+    MetricsPublisher& operator=(const MetricsPublisher&) = delete;
+
+    bool enabled() const { return segment != nullptr; }
+
+    //Seconds between updates of the segment
+    double interval = 1.0;
+
+    //Scene whose transforms and draw commands are counted at each publish
+    vsg::ref_ptr<vsg::Node> scene;
+
+    //Safe to call from a simulation thread
+    void countSimulationStep() { simulationSteps.fetch_add(1, std::memory_order_relaxed); }
+
+    //Call once per frame after present, publishes when the interval has elapsed
+    void endFrame();
+
+private:
+    void publish(vsg::time_point now);
+
+    std::string name;
+    MetricsSegment* segment = nullptr;
+    MetricsData data{};
+
+    std::atomic<uint64_t> simulationSteps{0};
+    uint64_t lastSimulationSteps = 0;
+
+    vsg::time_point startTime;
+    vsg::time_point lastFrame;
+    vsg::time_point lastPublish;
+    uint64_t intervalFrames = 0;
+    double intervalFrameTime = 0.0;
+    double intervalFrameMax = 0.0;
+};
+
+//Read --metrics <name>, which is then used for the shared memory segment name
+std::string readMetricsName(vsg::CommandLine& arguments);
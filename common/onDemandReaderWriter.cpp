@@ -0,0 +1,95 @@
+#include "onDemandReaderWriter.hpp"
+
+#include <vsgXchange/images.h>
+#include <vsgXchange/models.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+namespace
+{
+    struct ReaderEntry
+    {
+        const char* name;
+        std::vector<std::string> extensions;
+        std::function<vsg::ref_ptr<vsg::ReaderWriter>()> create;
+    };
+
+    //The formats the scenes' models and their textures come in
+    const std::vector<ReaderEntry>& readerTable()
+    {
+        static const std::vector<ReaderEntry> s_readers{
+            {"vsg", {".vsgt", ".vsgb"}, []() -> vsg::ref_ptr<vsg::ReaderWriter> { return vsg::VSG::create(); }},
+            {"assimp", {".obj", ".fbx", ".gltf", ".glb", ".dae", ".3ds", ".ply", ".stl"}, []() -> vsg::ref_ptr<vsg::ReaderWriter> { return vsgXchange::assimp::create(); }},
+            {"stbi", {".jpg", ".jpeg", ".png", ".tga", ".bmp", ".psd", ".gif", ".hdr"}, []() -> vsg::ref_ptr<vsg::ReaderWriter> { return vsgXchange::stbi::create(); }},
+            {"dds", {".dds"}, []() -> vsg::ref_ptr<vsg::ReaderWriter> { return vsgXchange::dds::create(); }},
+            {"ktx", {".ktx", ".ktx2"}, []() -> vsg::ref_ptr<vsg::ReaderWriter> { return vsgXchange::ktx::create(); }},
+        };
+        return s_readers;
+    }
+
+    vsg::Path hintedExtension(const vsg::ref_ptr<const vsg::Options>& options)
+    {
+        return options ? vsg::lowerCaseFileExtension(options->extensionHint) : vsg::Path();
+    }
+}
+
+vsg::ref_ptr<vsg::Object> OnDemandReaderWriter::read(const vsg::Path& filename, vsg::ref_ptr<const vsg::Options> options) const
+{
+    auto readerWriter = readerWriterFor(vsg::lowerCaseFileExtension(filename));
+    return readerWriter ? readerWriter->read(filename, options) : vsg::ref_ptr<vsg::Object>();
+}
+
+vsg::ref_ptr<vsg::Object> OnDemandReaderWriter::read(std::istream& fin, vsg::ref_ptr<const vsg::Options> options) const
+{
+    auto readerWriter = readerWriterFor(hintedExtension(options));
+    return readerWriter ? readerWriter->read(fin, options) : vsg::ref_ptr<vsg::Object>();
+}
+
+vsg::ref_ptr<vsg::Object> OnDemandReaderWriter::read(const uint8_t* ptr, size_t size, vsg::ref_ptr<const vsg::Options> options) const
+{
+    auto readerWriter = readerWriterFor(hintedExtension(options));
+    return readerWriter ? readerWriter->read(ptr, size, options) : vsg::ref_ptr<vsg::Object>();
+}
+
+bool OnDemandReaderWriter::getFeatures(Features& features) const
+{
+    //Listing what the readers support would mean creating them all, so every extension in the table is offered for reading
+    for (auto& entry : readerTable())
+    {
+        for (auto& extension : entry.extensions)
+        {
+            features.extensionFeatureMap[extension] = static_cast<FeatureMask>(READ_FILENAME | READ_ISTREAM | READ_MEMORY);
+        }
+    }
+    return true;
+}
+
+std::vector<std::pair<std::string, double>> OnDemandReaderWriter::created() const
+{
+    std::scoped_lock<std::mutex> lock(mutex);
+    return creationTimes;
+}
+
+vsg::ref_ptr<vsg::ReaderWriter> OnDemandReaderWriter::readerWriterFor(const vsg::Path& extension) const
+{
+    if (!extension) return {};
+
+    auto& table = readerTable();
+    auto entry = std::find_if(table.begin(), table.end(), [&](const ReaderEntry& candidate) {
+        return std::find(candidate.extensions.begin(), candidate.extensions.end(), extension.string()) != candidate.extensions.end();
+    });
+    if (entry == table.end()) return {};
+
+    //Readers can be asked for from loading threads, each is only ever created once
+    std::scoped_lock<std::mutex> lock(mutex);
+    auto& readerWriter = readerWriters[entry->name];
+    if (!readerWriter)
+    {
+        auto start = vsg::clock::now();
+        readerWriter = entry->create();
+        creationTimes.emplace_back(entry->name, std::chrono::duration<double, std::milli>(vsg::clock::now() - start).count());
+    }
+    return readerWriter;
+}
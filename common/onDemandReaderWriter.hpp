@@ -0,0 +1,32 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Stands in for vsgXchange::all with only the readers the scenes need, each created the first time a file asks for it
+//vsgXchange::all builds every plugin vsgXchange was compiled with (assimp, the image loaders, curl, GDAL...) up front,
+//here a .obj creates the assimp reader, the .jpg textures it pulls in the stb image reader, and .vsgt/.vsgb go to vsg's own
+//Extensions outside the table are left to any readers after this one in the options, and to vsg's built in fallbacks
+class OnDemandReaderWriter : public vsg::Inherit<vsg::ReaderWriter, OnDemandReaderWriter>
+{
+public:
+    vsg::ref_ptr<vsg::Object> read(const vsg::Path& filename, vsg::ref_ptr<const vsg::Options> options = {}) const override;
+    vsg::ref_ptr<vsg::Object> read(std::istream& fin, vsg::ref_ptr<const vsg::Options> options = {}) const override;
+    vsg::ref_ptr<vsg::Object> read(const uint8_t* ptr, size_t size, vsg::ref_ptr<const vsg::Options> options = {}) const override;
+
+    bool getFeatures(Features& features) const override;
+
+    //Readers created so far in the order they were first needed, with the milliseconds each took to create
+    std::vector<std::pair<std::string, double>> created() const;
+
+private:
+    vsg::ref_ptr<vsg::ReaderWriter> readerWriterFor(const vsg::Path& extension) const;
+
+    mutable std::mutex mutex;
+    mutable std::map<std::string, vsg::ref_ptr<vsg::ReaderWriter>> readerWriters;
+    mutable std::vector<std::pair<std::string, double>> creationTimes;
+};
@@ -0,0 +1,94 @@
+#include "onDemandRendering.hpp"
+
+OnDemandRendering::OnDemandRendering(bool _enabled) : enabled(_enabled), frameRequested(true), dirty(true)
+{
+    settleUntil = vsg::clock::now();
+    startTime = settleUntil;
+    framesRendered = 0;
+    idleTime = 0.0;
+}
+
+void OnDemandRendering::requestFrame()
+{
+    //Only wake the render thread on the transition, the sim thread may call this millions of times a second
+    if (!frameRequested.exchange(true))
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+        }
+        cv.notify_one();
+    }
+}
+
+void OnDemandRendering::markDirty()
+{
+    dirty = true;
+}
+
+bool OnDemandRendering::advanceToNextFrame(vsg::ref_ptr<vsg::Viewer> viewer, double simulationTime)
+{
+    auto advance = [&]() { return simulationTime < 0.0 ? viewer->advanceToNextFrame() : viewer->advanceToNextFrame(simulationTime); };
+
+    if (!enabled)
+    {
+        if (!advance()) return false;
+        ++framesRendered;
+        return true;
+    }
+
+    //Events polled while waiting, Viewer::advanceToNextFrame() discards its previous event list so we hand them back afterwards
+    vsg::UIEvents pending;
+
+    auto waitStart = vsg::clock::now();
+    for (;;)
+    {
+        if (!viewer->active()) return false;
+
+        for (auto& window : viewer->windows())
+        {
+            window->pollEvents(pending);
+        }
+
+        if (!pending.empty()) break;
+        if (frameRequested.exchange(false)) break;
+        if (dirty) break;
+        if (vsg::clock::now() < settleUntil) break;
+
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_for(lock, std::chrono::duration<double>(pollInterval), [this]() { return frameRequested.load(); });
+    }
+    idleTime += std::chrono::duration<double>(vsg::clock::now() - waitStart).count();
+    dirty = false;
+
+    if (!advance()) return false;
+
+    if (!pending.empty())
+    {
+        auto& events = viewer->getEvents();
+        events.insert(events.begin(), pending.begin(), pending.end());
+    }
+
+    ++framesRendered;
+    return true;
+}
+
+void OnDemandRendering::report(std::ostream& out) const
+{
+    if (!enabled) return;
+
+    auto duration = std::chrono::duration<double>(vsg::clock::now() - startTime).count();
+    out << "On demand rendering: " << framesRendered << " frames rendered, idle for "
+        << (duration > 0.0 ? 100.0 * idleTime / duration : 0.0) << "% of " << duration << "s" << std::endl;
+}
+
+void OnDemandRendering::apply(vsg::UIEvent& event)
+{
+    //Any input or window event keeps the loop running for a short while
+    auto until = event.time + std::chrono::duration_cast<vsg::clock::duration>(std::chrono::duration<double>(settleTime));
+    if (until > settleUntil) settleUntil = until;
+}
+
+void OnDemandRendering::apply(vsg::FrameEvent&)
+{
+    //FrameEvents are generated by the viewer itself so must not keep the loop awake
+}
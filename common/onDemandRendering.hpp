@@ -0,0 +1,53 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+
+//Event handler and frame gate for the --on-demand mode
+//A frame is only produced when input arrives, an animation/simulation calls requestFrame()
+//or the scene has been marked dirty. Otherwise advanceToNextFrame() blocks the calling thread.
+class OnDemandRendering : public vsg::Inherit<vsg::Visitor, OnDemandRendering>
+{
+public:
+    OnDemandRendering(bool _enabled);
+
+    //When false advanceToNextFrame() behaves exactly like viewer->advanceToNextFrame()
+    bool enabled;
+
+    //Keep rendering this long (seconds) after the last input so trackball throws and resizes settle
+    double settleTime = 0.5;
+
+    //Longest time (seconds) the thread sleeps before polling the windows again
+    double pollInterval = 0.01;
+
+    //Thread safe, call whenever an animation or simulation publishes new state
+    void requestFrame();
+
+    //Call from the main thread after modifying the scene graph directly
+    void markDirty();
+
+    //Replacement for viewer->advanceToNextFrame() in the main loop
+    //A simulationTime of zero or more is passed on to the viewer, negative uses the time since the viewer started
+    bool advanceToNextFrame(vsg::ref_ptr<vsg::Viewer> viewer, double simulationTime = -1.0);
+
+    //Print how many frames were rendered and how long the loop was idle
+    void report(std::ostream& out) const;
+
+    void apply(vsg::UIEvent& event) override;
+    void apply(vsg::FrameEvent& event) override;
+
+private:
+    std::atomic<bool> frameRequested;
+    bool dirty;
+    vsg::time_point settleUntil;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    uint64_t framesRendered;
+    double idleTime;
+    vsg::time_point startTime;
+};
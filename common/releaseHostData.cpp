@@ -0,0 +1,207 @@
+#include "releaseHostData.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <typeinfo>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "assetRegistry.hpp"
+
+namespace
+{
+    bool isStaticData(const vsg::Data& data)
+    {
+        return data.properties.dataVariance != vsg::DYNAMIC_DATA && data.properties.dataVariance != vsg::DYNAMIC_DATA_TRANSFER_AFTER_RECORD;
+    }
+
+    bool isDraw(const vsg::Node& node)
+    {
+        return node.is_compatible(typeid(vsg::VertexIndexDraw)) || node.is_compatible(typeid(vsg::VertexDraw)) || node.is_compatible(typeid(vsg::Geometry));
+    }
+}
+
+void ReleaseHostData::apply(vsg::Node& node)
+{
+    if (visited.insert(&node).second) node.traverse(*this);
+}
+
+void ReleaseHostData::apply(vsg::Group& group)
+{
+    if (visited.insert(&group).second) releaseChildren(group);
+}
+
+void ReleaseHostData::apply(vsg::StateGroup& stateGroup)
+{
+    if (!visited.insert(&stateGroup).second) return;
+
+    for (auto& stateCommand : stateGroup.stateCommands)
+    {
+        if (auto bind = stateCommand.cast<vsg::BindDescriptorSet>())
+        {
+            releaseDescriptorSet(bind->descriptorSet.get());
+        }
+        else if (auto binds = stateCommand.cast<vsg::BindDescriptorSets>())
+        {
+            for (auto& descriptorSet : binds->descriptorSets) releaseDescriptorSet(descriptorSet.get());
+        }
+    }
+
+    releaseChildren(stateGroup);
+}
+
+void ReleaseHostData::releaseChildren(vsg::Group& group)
+{
+    for (auto& child : group.children)
+    {
+        if (!child) continue;
+        if (!isDraw(*child))
+        {
+            child->accept(*this);
+            continue;
+        }
+
+        //A draw under several parents is wrapped once and every parent gets the same CullNode
+        auto found = culled.find(child.get());
+        if (found != culled.end())
+        {
+            child = found->second;
+            continue;
+        }
+        if (!visited.insert(child.get()).second) continue;
+
+        //The bounds are taken while the vertices and indices are still there, ComputeBounds stops at the CullNode after
+        auto bounds = vsg::visit<vsg::ComputeBounds>(child).bounds;
+        if (!bounds.valid() || !releaseDraw(*child)) continue;
+
+        auto cullNode = vsg::CullNode::create(vsg::dsphere((bounds.min + bounds.max) * 0.5, vsg::length(bounds.max - bounds.min) * 0.5), child);
+        culled[child.get()] = cullNode;
+        child = cullNode;
+    }
+}
+
+bool ReleaseHostData::releaseDraw(vsg::Node& draw)
+{
+    uint64_t before = arraysReleased;
+    if (auto vertexIndexDraw = draw.cast<vsg::VertexIndexDraw>())
+    {
+        releaseArrays(vertexIndexDraw->arrays);
+        if (vertexIndexDraw->indices && visited.insert(vertexIndexDraw->indices.get()).second && release(vertexIndexDraw->indices->data)) ++arraysReleased;
+    }
+    else if (auto vertexDraw = draw.cast<vsg::VertexDraw>())
+    {
+        releaseArrays(vertexDraw->arrays);
+    }
+    else if (auto geometry = draw.cast<vsg::Geometry>())
+    {
+        releaseArrays(geometry->arrays);
+        if (geometry->indices && visited.insert(geometry->indices.get()).second && release(geometry->indices->data)) ++arraysReleased;
+    }
+    return arraysReleased > before;
+}
+
+bool ReleaseHostData::release(vsg::ref_ptr<vsg::Data>& data)
+{
+    if (!data || !isStaticData(*data)) return false;
+
+    //Several buffers can share one array, its bytes are only counted once
+    if (released.insert(data.get()).second) bytesReleased += data->dataSize();
+    data = {};
+    return true;
+}
+
+void ReleaseHostData::releaseArrays(vsg::BufferInfoList& arrays)
+{
+    for (auto& bufferInfo : arrays)
+    {
+        if (bufferInfo && visited.insert(bufferInfo.get()).second && release(bufferInfo->data)) ++arraysReleased;
+    }
+}
+
+void ReleaseHostData::releaseDescriptorSet(vsg::DescriptorSet* descriptorSet)
+{
+    if (!descriptorSet || !visited.insert(descriptorSet).second) return;
+
+    for (auto& descriptor : descriptorSet->descriptors)
+    {
+        auto descriptorImage = descriptor.cast<vsg::DescriptorImage>();
+        if (!descriptorImage) continue;
+
+        for (auto& imageInfo : descriptorImage->imageInfoList)
+        {
+            if (!imageInfo->imageView || !imageInfo->imageView->image) continue;
+            if (release(imageInfo->imageView->image->data)) ++texturesReleased;
+        }
+    }
+}
+
+size_t residentSetSize()
+{
+#if defined(__linux__)
+    //The second field of statm is the resident page count
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (statm >> pages >> resident) return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return 0;
+}
+
+void HostDataRelease::read(vsg::CommandLine& arguments)
+{
+    std::string list;
+    if (!arguments.read("--release-host-data", list)) return;
+
+    std::istringstream names(list);
+    std::string name;
+    while (std::getline(names, name, ','))
+    {
+        if (!name.empty()) assets.push_back(name);
+    }
+}
+
+void HostDataRelease::release(const std::vector<std::pair<std::string, vsg::ref_ptr<vsg::Node>>>& available, std::ostream& out) const
+{
+    if (!enabled()) return;
+
+    bool all = std::find(assets.begin(), assets.end(), "all") != assets.end();
+    auto chosen = [&](const std::string& name) { return all || std::find(assets.begin(), assets.end(), name) != assets.end(); };
+    for (auto& asset : assets)
+    {
+        if (asset == "all") continue;
+        if (std::none_of(available.begin(), available.end(), [&](auto& entry) { return entry.first == asset; }))
+        {
+            out << "No asset called " << asset << " to release" << std::endl;
+        }
+    }
+
+    size_t before = residentSetSize();
+
+    auto releaser = ReleaseHostData::create();
+    for (auto& [name, node] : available)
+    {
+        if (node && chosen(name)) node->accept(*releaser);
+    }
+
+    //The registry's shared objects still hold the files that were read and the images they loaded
+    assetRegistry().clear();
+
+#if defined(__GLIBC__)
+    //Hand the freed heap back to the system so the RSS shows it
+    malloc_trim(0);
+#endif
+
+    size_t after = residentSetSize();
+
+    out << "Released host data: " << releaser->arraysReleased << " arrays and " << releaser->texturesReleased << " textures, "
+        << releaser->bytesReleased / 1024 << " KiB" << std::endl;
+    if (before > 0)
+    {
+        out << "  resident set " << before / (1024 * 1024) << " MiB before, " << after / (1024 * 1024) << " MiB after" << std::endl;
+    }
+}
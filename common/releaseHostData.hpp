@@ -0,0 +1,57 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Drops the host copies of static vertex, index and texture data once viewer->compile() has uploaded them
+//Data marked dynamic is left alone, the app still writes it every frame
+//Each released draw is moved under a vsg::CullNode holding the bounds it had, vsg::ComputeBounds uses the node's bound
+//instead of walking vertices and indices that are gone, so the camera and per frame bounds code keep working
+//(the box around each draw's bounding sphere, a little larger than its vertices). Draws that are not a child of a group
+//keep their geometry, there is no parent to put the CullNode in
+//Only run it after compile, anything compiled later (another window, a recompile) would have nothing to upload
+class ReleaseHostData : public vsg::Inherit<vsg::Visitor, ReleaseHostData>
+{
+public:
+    void apply(vsg::Node& node) override;
+    void apply(vsg::Group& group) override;
+    void apply(vsg::StateGroup& stateGroup) override;
+
+    //Arrays and textures let go, and the bytes they held
+    uint64_t arraysReleased = 0;
+    uint64_t texturesReleased = 0;
+    uint64_t bytesReleased = 0;
+
+private:
+    std::set<const vsg::Object*> visited;
+    std::set<const vsg::Data*> released;
+    std::map<const vsg::Node*, vsg::ref_ptr<vsg::CullNode>> culled;
+
+    void releaseChildren(vsg::Group& group);
+    bool releaseDraw(vsg::Node& draw);
+    bool release(vsg::ref_ptr<vsg::Data>& data);
+    void releaseArrays(vsg::BufferInfoList& arrays);
+    void releaseDescriptorSet(vsg::DescriptorSet* descriptorSet);
+};
+
+//Resident set size of the process in bytes, 0 where it cannot be read
+size_t residentSetSize();
+
+//--release-host-data boat,plane,... picks the assets to release after compile, "all" releases every one
+class HostDataRelease
+{
+public:
+    void read(vsg::CommandLine& arguments);
+
+    std::vector<std::string> assets;
+
+    bool enabled() const { return !assets.empty(); }
+
+    //Release the chosen assets among the named ones the app offers and print the RSS before and after
+    void release(const std::vector<std::pair<std::string, vsg::ref_ptr<vsg::Node>>>& available, std::ostream& out) const;
+};
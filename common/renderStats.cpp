@@ -0,0 +1,626 @@
+#include "renderStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+namespace
+{
+    uint64_t primitiveCount(VkPrimitiveTopology topology, uint32_t vertexCount)
+    {
+        switch (topology)
+        {
+        case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST: return vertexCount / 3;
+        case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP:
+        case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN: return vertexCount >= 3 ? vertexCount - 2 : 0;
+        default: return 0;
+        }
+    }
+
+    VkPrimitiveTopology pipelineTopology(const vsg::GraphicsPipeline* pipeline, VkPrimitiveTopology topology)
+    {
+        if (!pipeline) return topology;
+        for (auto& pipelineState : pipeline->pipelineStates)
+        {
+            if (auto inputAssemblyState = dynamic_cast<const vsg::InputAssemblyState*>(pipelineState.get())) return inputAssemblyState->topology;
+        }
+        return topology;
+    }
+
+    bool isDescriptorBind(const vsg::StateCommand* stateCommand)
+    {
+        return dynamic_cast<const vsg::BindDescriptorSet*>(stateCommand) || dynamic_cast<const vsg::BindDescriptorSets*>(stateCommand) ||
+               dynamic_cast<const vsg::BindViewDescriptorSets*>(stateCommand);
+    }
+}
+
+void RenderStatsCollector::collect(const std::vector<vsg::ref_ptr<vsg::CommandGraph>>& commandGraphs)
+{
+    for (auto& viewStats : views) viewStats.stats = RenderStats{};
+
+    for (auto& commandGraph : commandGraphs)
+    {
+        commandGraph->accept(*this);
+    }
+}
+
+void RenderStatsCollector::apply(const vsg::Node& node)
+{
+    node.traverse(*this);
+}
+
+void RenderStatsCollector::apply(const vsg::View& view)
+{
+    if (!view.camera)
+    {
+        view.traverse(*this);
+        return;
+    }
+
+    auto itr = std::find_if(views.begin(), views.end(), [&](const ViewStats& viewStats) { return viewStats.view == &view; });
+    if (itr == views.end()) itr = views.insert(views.end(), ViewStats{&view, RenderStats{}});
+    current = &(itr->stats);
+
+    //Each view starts recording with fresh state, as vsg::RecordTraversal does
+    projection = view.camera->projectionMatrix->transform();
+    modelviewStack.assign(1, view.camera->viewMatrix->transform());
+    ++modelviewVersion;
+    recordedModelviewVersion = 0;
+    projectionRecorded = false;
+    stateStacks.clear();
+    recordedState.clear();
+    topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    bins.clear();
+
+    view.traverse(*this);
+    recordBins(view);
+
+    current = nullptr;
+}
+
+void RenderStatsCollector::recordBins(const vsg::View& view)
+{
+    //Bins are recorded once the view's own children are, lowest bin number first; a DepthSorted met while recording a bin
+    //goes into the next pass
+    while (!bins.empty())
+    {
+        auto pending = std::move(bins);
+        bins.clear();
+
+        for (auto& [binNumber, entries] : pending)
+        {
+            auto sortOrder = vsg::Bin::NO_SORT;
+            for (auto& bin : view.bins)
+            {
+                if (bin && bin->binNumber == binNumber) sortOrder = bin->sortOrder;
+            }
+            if (sortOrder == vsg::Bin::ASCENDING)
+                std::stable_sort(entries.begin(), entries.end(), [](const BinEntry& lhs, const BinEntry& rhs) { return lhs.distance < rhs.distance; });
+            else if (sortOrder == vsg::Bin::DESCENDING)
+                std::stable_sort(entries.begin(), entries.end(), [](const BinEntry& lhs, const BinEntry& rhs) { return lhs.distance > rhs.distance; });
+
+            for (auto& entry : entries)
+            {
+                stateStacks = std::move(entry.stateStacks);
+                if (recordedState.size() < stateStacks.size()) recordedState.resize(stateStacks.size(), nullptr);
+                modelviewStack.assign(1, entry.modelview);
+                ++modelviewVersion;
+
+                entry.node->accept(*this);
+            }
+        }
+    }
+}
+
+void RenderStatsCollector::apply(const vsg::Transform& transform)
+{
+    if (modelviewStack.empty())
+    {
+        transform.traverse(*this);
+        return;
+    }
+
+    modelviewStack.push_back(transform.transform(modelviewStack.back()));
+    ++modelviewVersion;
+
+    transform.traverse(*this);
+
+    modelviewStack.pop_back();
+    ++modelviewVersion;
+}
+
+void RenderStatsCollector::apply(const vsg::StateGroup& stateGroup)
+{
+    for (auto& stateCommand : stateGroup.stateCommands)
+    {
+        if (stateCommand->slot >= stateStacks.size())
+        {
+            stateStacks.resize(stateCommand->slot + 1);
+            recordedState.resize(stateCommand->slot + 1, nullptr);
+        }
+        stateStacks[stateCommand->slot].push_back(stateCommand.get());
+    }
+
+    stateGroup.traverse(*this);
+
+    for (auto& stateCommand : stateGroup.stateCommands)
+    {
+        stateStacks[stateCommand->slot].pop_back();
+    }
+}
+
+void RenderStatsCollector::apply(const vsg::CullGroup& cullGroup)
+{
+    if (visible(cullGroup.bound))
+        cullGroup.traverse(*this);
+    else if (current)
+        ++current->culledNodes;
+}
+
+void RenderStatsCollector::apply(const vsg::CullNode& cullNode)
+{
+    if (visible(cullNode.bound))
+        cullNode.child->accept(*this);
+    else if (current)
+        ++current->culledNodes;
+}
+
+void RenderStatsCollector::apply(const vsg::LOD& lod)
+{
+    if (!visible(lod.bound))
+    {
+        if (current) ++current->culledNodes;
+        return;
+    }
+
+    //Same selection as the record traversal, the first child whose minimum screen height ratio is met
+    double ratio = screenHeightRatio(lod.bound);
+    for (auto& child : lod.children)
+    {
+        if (ratio > child.minimumScreenHeightRatio)
+        {
+            if (child.node) child.node->accept(*this);
+            return;
+        }
+    }
+}
+
+void RenderStatsCollector::apply(const vsg::PagedLOD& plod)
+{
+    if (!visible(plod.bound))
+    {
+        if (current) ++current->culledNodes;
+        return;
+    }
+
+    //The high resolution child when it is in range and has been loaded, otherwise the low resolution one if it is in range
+    double ratio = screenHeightRatio(plod.bound);
+    auto& highRes = plod.children[0];
+    if (ratio > highRes.minimumScreenHeightRatio && highRes.node)
+    {
+        highRes.node->accept(*this);
+        return;
+    }
+
+    auto& lowRes = plod.children[1];
+    if (ratio > lowRes.minimumScreenHeightRatio && lowRes.node) lowRes.node->accept(*this);
+}
+
+void RenderStatsCollector::apply(const vsg::DepthSorted& depthSorted)
+{
+    if (!visible(depthSorted.bound))
+    {
+        if (current) ++current->culledNodes;
+        return;
+    }
+    if (!depthSorted.child) return;
+
+    //Outside a view there are no bins to defer to
+    if (modelviewStack.empty())
+    {
+        depthSorted.child->accept(*this);
+        return;
+    }
+
+    auto& mv = modelviewStack.back();
+    auto& center = depthSorted.bound.center;
+    double distance = -(mv[0][2] * center.x + mv[1][2] * center.y + mv[2][2] * center.z + mv[3][2]);
+    bins[depthSorted.binNumber].push_back(BinEntry{distance, depthSorted.child.get(), mv, stateStacks});
+}
+
+void RenderStatsCollector::apply(const vsg::Switch& sw)
+{
+    for (auto& child : sw.children)
+    {
+        if (child.mask != 0) child.node->accept(*this);
+    }
+}
+
+void RenderStatsCollector::apply(const vsg::Geometry& geometry)
+{
+    for (auto& command : geometry.commands)
+    {
+        command->accept(*this);
+    }
+}
+
+void RenderStatsCollector::apply(const vsg::PushConstants&)
+{
+    if (current) ++current->pushConstants;
+}
+
+void RenderStatsCollector::apply(const vsg::Draw& draw)
+{
+    recordDraw(draw.vertexCount, draw.instanceCount);
+}
+
+void RenderStatsCollector::apply(const vsg::DrawIndexed& drawIndexed)
+{
+    recordDraw(drawIndexed.indexCount, drawIndexed.instanceCount);
+}
+
+void RenderStatsCollector::apply(const vsg::VertexDraw& vertexDraw)
+{
+    recordDraw(vertexDraw.vertexCount, vertexDraw.instanceCount);
+}
+
+void RenderStatsCollector::apply(const vsg::VertexIndexDraw& vertexIndexDraw)
+{
+    recordDraw(vertexIndexDraw.indexCount, vertexIndexDraw.instanceCount);
+}
+
+bool RenderStatsCollector::visible(const vsg::dsphere& bound) const
+{
+    if (modelviewStack.empty()) return true;
+
+    //Clip space planes of the view frustum in the local coordinates of the bound, Vulkan depth is 0 to w
+    auto m = projection * modelviewStack.back();
+    auto row = [&](int r) { return vsg::dvec4(m[0][r], m[1][r], m[2][r], m[3][r]); };
+    auto r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+    const vsg::dvec4 planes[6] = {
+        vsg::dvec4(r3.x + r0.x, r3.y + r0.y, r3.z + r0.z, r3.w + r0.w),
+        vsg::dvec4(r3.x - r0.x, r3.y - r0.y, r3.z - r0.z, r3.w - r0.w),
+        vsg::dvec4(r3.x + r1.x, r3.y + r1.y, r3.z + r1.z, r3.w + r1.w),
+        vsg::dvec4(r3.x - r1.x, r3.y - r1.y, r3.z - r1.z, r3.w - r1.w),
+        r2,
+        vsg::dvec4(r3.x - r2.x, r3.y - r2.y, r3.z - r2.z, r3.w - r2.w)};
+
+    for (auto& plane : planes)
+    {
+        double distance = plane.x * bound.center.x + plane.y * bound.center.y + plane.z * bound.center.z + plane.w;
+        double length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if (distance < -bound.radius * length) return false;
+    }
+    return true;
+}
+
+double RenderStatsCollector::screenHeightRatio(const vsg::dsphere& bound) const
+{
+    if (modelviewStack.empty()) return 1.0;
+
+    auto& mv = modelviewStack.back();
+    double depth = -(mv[0][2] * bound.center.x + mv[1][2] * bound.center.y + mv[2][2] * bound.center.z + mv[3][2]);
+    double scale = std::sqrt(mv[0][0] * mv[0][0] + mv[0][1] * mv[0][1] + mv[0][2] * mv[0][2]);
+    if (depth <= 0.0) return 1.0;
+
+    return bound.radius * scale * std::abs(projection[1][1]) / depth;
+}
+
+void RenderStatsCollector::recordDraw(uint32_t vertexCount, uint32_t instanceCount)
+{
+    if (!current) return;
+
+    //Only the slots whose top changed since the last draw are bound again
+    for (size_t slot = 0; slot < stateStacks.size(); ++slot)
+    {
+        if (stateStacks[slot].empty()) continue;
+
+        auto stateCommand = stateStacks[slot].back();
+        if (stateCommand == recordedState[slot]) continue;
+        recordedState[slot] = stateCommand;
+
+        if (auto bindPipeline = dynamic_cast<const vsg::BindGraphicsPipeline*>(stateCommand))
+        {
+            ++current->pipelineBinds;
+            topology = pipelineTopology(bindPipeline->pipeline.get(), topology);
+        }
+        else if (isDescriptorBind(stateCommand))
+        {
+            ++current->descriptorBinds;
+        }
+    }
+
+    if (!projectionRecorded)
+    {
+        ++current->pushConstants;
+        projectionRecorded = true;
+    }
+    if (recordedModelviewVersion != modelviewVersion)
+    {
+        ++current->pushConstants;
+        recordedModelviewVersion = modelviewVersion;
+    }
+
+    ++current->draws;
+    current->instances += instanceCount;
+    current->triangles += primitiveCount(topology, vertexCount) * instanceCount;
+}
+
+void RenderStatsMonitor::assign(vsg::ref_ptr<vsg::CommandGraph> commandGraph, vsg::ref_ptr<vsg::Window> window, vsg::ref_ptr<vsg::Options> _options)
+{
+    if (!enabled) return;
+
+    commandGraphs.push_back(commandGraph);
+    options = _options;
+
+    if (!overlay) return;
+
+    vsg::ref_ptr<vsg::RenderGraph> renderGraph;
+    for (auto& child : commandGraph->children)
+    {
+        if ((renderGraph = child.cast<vsg::RenderGraph>())) break;
+    }
+
+    auto font = vsg::read_cast<vsg::Font>("fonts/times.vsgb", options);
+    if (!renderGraph || !font)
+    {
+        std::cout << "Render stats overlay needs fonts/times.vsgb on VSG_FILE_PATH, stats will only be reported at exit" << std::endl;
+        return;
+    }
+
+    auto extent = window->extent2D();
+    float size = 14.0f;
+
+    auto layout = vsg::StandardLayout::create();
+    layout->horizontalAlignment = vsg::StandardLayout::LEFT_ALIGNMENT;
+    layout->verticalAlignment = vsg::StandardLayout::TOP_ALIGNMENT;
+    layout->position = vsg::vec3(8.0f, static_cast<float>(extent.height) - 8.0f, 0.0f);
+    layout->horizontal = vsg::vec3(size, 0.0f, 0.0f);
+    layout->vertical = vsg::vec3(0.0f, size, 0.0f);
+    layout->color = vsg::vec4(1.0f, 1.0f, 0.0f, 1.0f);
+
+    //GpuLayoutTechnique lays the glyphs out in the shader so the string can change every update without rebuilding geometry
+    label = vsg::stringValue::create("render stats");
+    text = vsg::Text::create();
+    text->text = label;
+    text->font = font;
+    text->layout = layout;
+    text->technique = vsg::GpuLayoutTechnique::create();
+    text->setup(2048, options);
+
+    auto hudCamera = vsg::Camera::create(vsg::Orthographic::create(0.0, static_cast<double>(extent.width), 0.0, static_cast<double>(extent.height), -10.0, 10.0),
+                                         vsg::LookAt::create(vsg::dvec3(0.0, 0.0, 0.0), vsg::dvec3(0.0, 0.0, -1.0), vsg::dvec3(0.0, 1.0, 0.0)),
+                                         vsg::ViewportState::create(extent));
+    auto hudView = vsg::View::create(hudCamera);
+    hudView->addChild(text);
+
+    //Clear the depth left by the scene so the overlay is always drawn on top
+    VkClearValue clearValue{};
+    clearValue.depthStencil = {0.0f, 0};
+    VkClearAttachment attachment{VK_IMAGE_ASPECT_DEPTH_BIT, 1, clearValue};
+    VkClearRect rect{VkRect2D{VkOffset2D{0, 0}, extent}, 0, 1};
+    renderGraph->addChild(vsg::ClearAttachments::create(vsg::ClearAttachments::Attachments{attachment}, vsg::ClearAttachments::Rects{rect}));
+    renderGraph->addChild(hudView);
+}
+
+void RenderStatsMonitor::collect()
+{
+    if (!enabled) return;
+
+    if (!collector) collector = RenderStatsCollector::create();
+    collector->collect(commandGraphs);
+    ++frames;
+
+    totals.resize(collector->views.size());
+    for (size_t i = 0; i < collector->views.size(); ++i)
+    {
+        auto& stats = collector->views[i].stats;
+        auto& sum = totals[i].sum;
+        auto& max = totals[i].max;
+        sum.draws += stats.draws;
+        sum.instances += stats.instances;
+        sum.triangles += stats.triangles;
+        sum.pipelineBinds += stats.pipelineBinds;
+        sum.descriptorBinds += stats.descriptorBinds;
+        sum.pushConstants += stats.pushConstants;
+        sum.culledNodes += stats.culledNodes;
+        max.draws = std::max(max.draws, stats.draws);
+        max.instances = std::max(max.instances, stats.instances);
+        max.triangles = std::max(max.triangles, stats.triangles);
+        max.pipelineBinds = std::max(max.pipelineBinds, stats.pipelineBinds);
+        max.descriptorBinds = std::max(max.descriptorBinds, stats.descriptorBinds);
+        max.pushConstants = std::max(max.pushConstants, stats.pushConstants);
+        max.culledNodes = std::max(max.culledNodes, stats.culledNodes);
+    }
+
+    auto now = vsg::clock::now();
+    if (!text || std::chrono::duration<double>(now - lastOverlayUpdate).count() < overlayInterval) return;
+    lastOverlayUpdate = now;
+
+    std::ostringstream str;
+    for (size_t i = 0; i < collector->views.size(); ++i)
+    {
+        auto& stats = collector->views[i].stats;
+        str << "view " << i << ": draws " << stats.draws << "  triangles " << stats.triangles << "\n"
+            << "  pipelines " << stats.pipelineBinds << "  descriptors " << stats.descriptorBinds << "  push " << stats.pushConstants
+            << "  culled " << stats.culledNodes << "\n";
+    }
+    label->value() = str.str();
+    text->setup(0, options);
+}
+
+void RenderStatsMonitor::report(std::ostream& out) const
+{
+    if (!enabled || frames == 0 || !collector) return;
+
+    auto average = [&](uint64_t sum) { return static_cast<double>(sum) / static_cast<double>(frames); };
+
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(1);
+    out << "Render stats per frame over " << frames << " frames (average / max)" << std::endl;
+    for (size_t i = 0; i < totals.size(); ++i)
+    {
+        auto& sum = totals[i].sum;
+        auto& max = totals[i].max;
+        out << "  view " << i << std::endl;
+        out << std::setw(20) << "draws" << std::setw(14) << average(sum.draws) << std::setw(12) << max.draws << std::endl;
+        out << std::setw(20) << "instances" << std::setw(14) << average(sum.instances) << std::setw(12) << max.instances << std::endl;
+        out << std::setw(20) << "triangles" << std::setw(14) << average(sum.triangles) << std::setw(12) << max.triangles << std::endl;
+        out << std::setw(20) << "pipeline binds" << std::setw(14) << average(sum.pipelineBinds) << std::setw(12) << max.pipelineBinds << std::endl;
+        out << std::setw(20) << "descriptor binds" << std::setw(14) << average(sum.descriptorBinds) << std::setw(12) << max.descriptorBinds << std::endl;
+        out << std::setw(20) << "push constants" << std::setw(14) << average(sum.pushConstants) << std::setw(12) << max.pushConstants << std::endl;
+        out << std::setw(20) << "culled nodes" << std::setw(14) << average(sum.culledNodes) << std::setw(12) << max.culledNodes << std::endl;
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+namespace
+{
+    //Everything a model would submit if fully in view, shared state and textures counted once
+    class ComplexityCounter : public vsg::Inherit<vsg::ConstVisitor, ComplexityCounter>
+    {
+    public:
+        uint64_t nodes = 0;
+        uint64_t transforms = 0;
+        uint64_t stateGroups = 0;
+        uint64_t draws = 0;
+        uint64_t triangles = 0;
+        uint64_t vertices = 0;
+        uint64_t textureBytes = 0;
+        std::set<const vsg::Object*> pipelines;
+        std::set<const vsg::Object*> descriptorSets;
+        std::set<const vsg::Object*> textures;
+        std::vector<VkPrimitiveTopology> topologies{VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+
+        void apply(const vsg::Node& node) override
+        {
+            ++nodes;
+            node.traverse(*this);
+        }
+
+        void apply(const vsg::Transform& transform) override
+        {
+            ++transforms;
+            apply(static_cast<const vsg::Node&>(transform));
+        }
+
+        void apply(const vsg::LOD& lod) override
+        {
+            //Only the highest detail child is counted
+            ++nodes;
+            if (!lod.children.empty() && lod.children.front().node) lod.children.front().node->accept(*this);
+        }
+
+        void apply(const vsg::PagedLOD& plod) override
+        {
+            //The high resolution child if it has been loaded, otherwise the low resolution one
+            ++nodes;
+            auto& child = plod.children[0].node ? plod.children[0] : plod.children[1];
+            if (child.node) child.node->accept(*this);
+        }
+
+        void apply(const vsg::StateGroup& stateGroup) override
+        {
+            ++stateGroups;
+            auto topology = topologies.back();
+            for (auto& stateCommand : stateGroup.stateCommands)
+            {
+                if (auto bindPipeline = stateCommand.cast<vsg::BindGraphicsPipeline>())
+                {
+                    pipelines.insert(bindPipeline->pipeline.get());
+                    topology = pipelineTopology(bindPipeline->pipeline.get(), topology);
+                }
+                else if (auto bindDescriptorSet = stateCommand.cast<vsg::BindDescriptorSet>())
+                {
+                    addDescriptorSet(bindDescriptorSet->descriptorSet.get());
+                }
+                else if (auto bindDescriptorSets = stateCommand.cast<vsg::BindDescriptorSets>())
+                {
+                    for (auto& descriptorSet : bindDescriptorSets->descriptorSets) addDescriptorSet(descriptorSet.get());
+                }
+            }
+
+            topologies.push_back(topology);
+            apply(static_cast<const vsg::Node&>(stateGroup));
+            topologies.pop_back();
+        }
+
+        void apply(const vsg::Geometry& geometry) override
+        {
+            ++nodes;
+            addVertices(geometry.arrays);
+            for (auto& command : geometry.commands) command->accept(*this);
+        }
+
+        void apply(const vsg::Draw& draw) override { addDraw(draw.vertexCount, draw.instanceCount); }
+        void apply(const vsg::DrawIndexed& drawIndexed) override { addDraw(drawIndexed.indexCount, drawIndexed.instanceCount); }
+
+        void apply(const vsg::VertexDraw& vertexDraw) override
+        {
+            ++nodes;
+            addVertices(vertexDraw.arrays);
+            addDraw(vertexDraw.vertexCount, vertexDraw.instanceCount);
+        }
+
+        void apply(const vsg::VertexIndexDraw& vertexIndexDraw) override
+        {
+            ++nodes;
+            addVertices(vertexIndexDraw.arrays);
+            addDraw(vertexIndexDraw.indexCount, vertexIndexDraw.instanceCount);
+        }
+
+    private:
+        void addDraw(uint32_t vertexCount, uint32_t instanceCount)
+        {
+            ++draws;
+            triangles += primitiveCount(topologies.back(), vertexCount) * instanceCount;
+        }
+
+        void addVertices(const vsg::BufferInfoList& arrays)
+        {
+            if (!arrays.empty() && arrays.front()->data) vertices += arrays.front()->data->valueCount();
+        }
+
+        void addDescriptorSet(const vsg::DescriptorSet* descriptorSet)
+        {
+            if (!descriptorSet || !descriptorSets.insert(descriptorSet).second) return;
+
+            for (auto& descriptor : descriptorSet->descriptors)
+            {
+                auto descriptorImage = descriptor.cast<vsg::DescriptorImage>();
+                if (!descriptorImage) continue;
+
+                for (auto& imageInfo : descriptorImage->imageInfoList)
+                {
+                    if (!imageInfo->imageView || !imageInfo->imageView->image) continue;
+
+                    auto& data = imageInfo->imageView->image->data;
+                    if (data && textures.insert(data.get()).second) textureBytes += data->dataSize();
+                }
+            }
+        }
+    };
+}
+
+void reportModelComplexity(const std::string& name, vsg::ref_ptr<vsg::Node> node, std::ostream& out)
+{
+    if (!node)
+    {
+        out << "Model complexity of " << name << ": not loaded" << std::endl;
+        return;
+    }
+
+    ComplexityCounter counter;
+    node->accept(counter);
+
+    out << "Model complexity of " << name << ":" << std::endl;
+    out << "  nodes " << counter.nodes << ", transforms " << counter.transforms << ", state groups " << counter.stateGroups << std::endl;
+    out << "  pipelines " << counter.pipelines.size() << ", descriptor sets " << counter.descriptorSets.size() << ", textures "
+        << counter.textures.size() << " (" << counter.textureBytes / 1024 << " KiB)" << std::endl;
+    out << "  draws " << counter.draws << ", triangles " << counter.triangles << ", vertices " << counter.vertices << std::endl;
+}
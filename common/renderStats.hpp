@@ -0,0 +1,133 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+//What the record traversal submits for one view in one frame
+struct RenderStats
+{
+    uint64_t draws = 0;           //draw and drawIndexed calls
+    uint64_t instances = 0;
+    uint64_t triangles = 0;
+    uint64_t pipelineBinds = 0;
+    uint64_t descriptorBinds = 0;
+    uint64_t pushConstants = 0;   //PushConstants commands plus the projection/modelview matrix pushes
+    uint64_t culledNodes = 0;     //CullGroup, CullNode, LOD, PagedLOD and DepthSorted nodes rejected
+};
+
+//Walks command graphs the way vsg::RecordTraversal does so the counts match what is recorded:
+//view frustum culling of CullGroup/CullNode/LOD, PagedLOD drawing its high resolution child only when it is in range
+//and loaded, DepthSorted children recorded after the view in bin order with the state and matrix they were reached with,
+//state only rebound when the top of a slot's stack changes and matrices only pushed when they changed since the last draw
+class RenderStatsCollector : public vsg::Inherit<vsg::ConstVisitor, RenderStatsCollector>
+{
+public:
+    struct ViewStats
+    {
+        const vsg::View* view;
+        RenderStats stats;
+    };
+
+    //One entry per view in traversal order
+    std::vector<ViewStats> views;
+
+    void collect(const std::vector<vsg::ref_ptr<vsg::CommandGraph>>& commandGraphs);
+
+    void apply(const vsg::Node& node) override;
+    void apply(const vsg::View& view) override;
+    void apply(const vsg::Transform& transform) override;
+    void apply(const vsg::StateGroup& stateGroup) override;
+    void apply(const vsg::CullGroup& cullGroup) override;
+    void apply(const vsg::CullNode& cullNode) override;
+    void apply(const vsg::LOD& lod) override;
+    void apply(const vsg::PagedLOD& plod) override;
+    void apply(const vsg::DepthSorted& depthSorted) override;
+    void apply(const vsg::Switch& sw) override;
+    void apply(const vsg::Geometry& geometry) override;
+    void apply(const vsg::PushConstants& pushConstants) override;
+    void apply(const vsg::Draw& draw) override;
+    void apply(const vsg::DrawIndexed& drawIndexed) override;
+    void apply(const vsg::VertexDraw& vertexDraw) override;
+    void apply(const vsg::VertexIndexDraw& vertexIndexDraw) override;
+
+private:
+    bool visible(const vsg::dsphere& bound) const;
+    double screenHeightRatio(const vsg::dsphere& bound) const;
+    void recordDraw(uint32_t vertexCount, uint32_t instanceCount);
+    void recordBins(const vsg::View& view);
+
+    //A DepthSorted child waiting for its bin, with what the traversal had bound when it was reached
+    struct BinEntry
+    {
+        double distance;
+        const vsg::Node* node;
+        vsg::dmat4 modelview;
+        std::vector<std::vector<const vsg::StateCommand*>> stateStacks;
+    };
+    std::map<int32_t, std::vector<BinEntry>> bins;
+
+    RenderStats* current = nullptr;
+    vsg::dmat4 projection;
+    std::vector<vsg::dmat4> modelviewStack;
+    uint64_t modelviewVersion = 0;
+    uint64_t recordedModelviewVersion = 0;
+    bool projectionRecorded = false;
+
+    std::vector<std::vector<const vsg::StateCommand*>> stateStacks;
+    std::vector<const vsg::StateCommand*> recordedState;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+};
+
+//Collects RenderStats every frame, shows them in a text overlay and keeps per view totals for the exit report
+class RenderStatsMonitor
+{
+public:
+    RenderStatsMonitor(bool _enabled) : enabled(_enabled) {}
+
+    bool enabled;
+
+    //Show the counts on screen, without it they are only collected for the reports
+    bool overlay = true;
+
+    //Seconds between updates of the overlay text
+    double overlayInterval = 0.5;
+
+    //Add a text overlay after the existing views of the first RenderGraph in the command graph
+    //The font is found through options->paths, without one the stats are still collected and reported
+    void assign(vsg::ref_ptr<vsg::CommandGraph> commandGraph, vsg::ref_ptr<vsg::Window> window, vsg::ref_ptr<vsg::Options> options);
+
+    //Call after viewer->update() and before recordAndSubmit() so the transforms and cameras are the ones recorded
+    void collect();
+
+    //Average and maximum per frame of each count, for every view
+    void report(std::ostream& out) const;
+
+    struct Totals
+    {
+        RenderStats sum;
+        RenderStats max;
+    };
+
+    //Per view sums and maxima over framesCollected() frames, for reports written elsewhere
+    const std::vector<Totals>& viewTotals() const { return totals; }
+    uint64_t framesCollected() const { return frames; }
+
+private:
+
+    vsg::ref_ptr<RenderStatsCollector> collector;
+    std::vector<vsg::ref_ptr<vsg::CommandGraph>> commandGraphs;
+    std::vector<Totals> totals;
+    uint64_t frames = 0;
+
+    vsg::ref_ptr<vsg::Text> text;
+    vsg::ref_ptr<vsg::stringValue> label;
+    vsg::ref_ptr<vsg::Options> options;
+    vsg::time_point lastOverlayUpdate;
+};
+
+//Print what a loaded model costs to render: nodes, transforms, state groups, unique pipelines,
+//descriptor sets and textures, draws, triangles and vertices
+void reportModelComplexity(const std::string& name, vsg::ref_ptr<vsg::Node> node, std::ostream& out);
@@ -0,0 +1,126 @@
+#include "sceneBenchmark.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+void SceneBenchmark::read(vsg::CommandLine& arguments)
+{
+    arguments.read("--benchmark", frames);
+    arguments.read("--benchmark-step", step);
+    arguments.read("--benchmark-warmup", warmup);
+    arguments.read("--benchmark-script", scriptFilename);
+    arguments.read("--benchmark-json", jsonFilename);
+}
+
+void SceneBenchmark::configure(RenderStatsMonitor& renderStats) const
+{
+    if (!enabled() || renderStats.enabled) return;
+
+    renderStats.enabled = true;
+    renderStats.overlay = false;
+}
+
+void SceneBenchmark::assign(vsg::ref_ptr<vsg::Viewer> viewer, vsg::ref_ptr<vsg::Camera> camera, vsg::ref_ptr<vsg::Options> options)
+{
+    if (scriptFilename.empty()) return;
+
+    cameraAnimation = vsg::CameraAnimation::create(camera, scriptFilename, options);
+    viewer->addEventHandler(cameraAnimation);
+
+    if (!enabled()) return;
+    if (cameraAnimation->animation)
+    {
+        cameraAnimation->play();
+    }
+    else
+    {
+        std::cout << "Unable to read camera script " << scriptFilename << ", the benchmark will use the app's own camera" << std::endl;
+    }
+}
+
+void SceneBenchmark::endFrame()
+{
+    if (enabled()) ++frame;
+}
+
+bool SceneBenchmark::writeReport(const std::string& app, const FrameStats& frameStats, const RenderStatsMonitor& renderStats, std::ostream& out) const
+{
+    if (!enabled()) return true;
+
+    auto history = frameStats.history();
+    size_t skip = std::min(history.size(), static_cast<size_t>(std::max(warmup, 0)));
+    history.erase(history.begin(), history.begin() + static_cast<std::ptrdiff_t>(skip));
+
+    std::ofstream file(jsonFilename);
+    if (!file)
+    {
+        out << "Unable to write " << jsonFilename << std::endl;
+        return false;
+    }
+
+    //Mean and percentiles of one phase, the GPU time is missing for frames whose queries were not read
+    auto writeTimes = [&](const char* name, float FrameSample::*member) {
+        std::vector<float> values;
+        values.reserve(history.size());
+        for (auto& sample : history)
+        {
+            if (sample.*member >= 0.0f) values.push_back(sample.*member);
+        }
+
+        file << "  \"" << name << "\": ";
+        if (values.empty())
+        {
+            file << "null,\n";
+            return;
+        }
+
+        std::sort(values.begin(), values.end());
+        auto percentile = [&](double p) { return values[std::min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size())))]; };
+        double sum = 0.0;
+        for (auto value : values) sum += value;
+
+        file << "{\"mean\": " << sum / static_cast<double>(values.size()) << ", \"p50\": " << percentile(0.50) << ", \"p90\": " << percentile(0.90)
+             << ", \"p95\": " << percentile(0.95) << ", \"p99\": " << percentile(0.99) << ", \"max\": " << values.back() << "},\n";
+    };
+
+    //Frame times run from one advanceToNextFrame() to the next less the render stats walk, so they add up to the length
+    //of the timed frames as they would be drawn without it
+    double seconds = 0.0;
+    for (auto& sample : history) seconds += sample.frame * 1e-3;
+
+    file << std::setprecision(6);
+    file << "{\n";
+    file << "  \"app\": \"" << app << "\",\n";
+    file << "  \"frames\": " << frame << ",\n";
+    file << "  \"warmup\": " << skip << ",\n";
+    file << "  \"step\": " << step << ",\n";
+    file << "  \"script\": \"" << (scripted() ? scriptFilename : std::string()) << "\",\n";
+    file << "  \"seconds\": " << seconds << ",\n";
+    file << "  \"fps\": " << (seconds > 0.0 ? static_cast<double>(history.size()) / seconds : 0.0) << ",\n";
+    writeTimes("frame_ms", &FrameSample::frame);
+    writeTimes("update_ms", &FrameSample::update);
+    writeTimes("record_ms", &FrameSample::record);
+    writeTimes("present_ms", &FrameSample::present);
+    writeTimes("gpu_ms", &FrameSample::gpu);
+
+    //Draw counts are averaged over every frame, on a fixed timeline they do not depend on timing
+    auto& totals = renderStats.viewTotals();
+    double collected = static_cast<double>(std::max<uint64_t>(renderStats.framesCollected(), 1));
+    auto average = [&](uint64_t sum) { return static_cast<double>(sum) / collected; };
+    file << "  \"views\": [";
+    for (size_t i = 0; i < totals.size(); ++i)
+    {
+        auto& sum = totals[i].sum;
+        file << (i > 0 ? "," : "") << "\n    {\"draws\": " << average(sum.draws) << ", \"instances\": " << average(sum.instances)
+             << ", \"triangles\": " << average(sum.triangles) << ", \"pipeline_binds\": " << average(sum.pipelineBinds)
+             << ", \"descriptor_binds\": " << average(sum.descriptorBinds) << ", \"push_constants\": " << average(sum.pushConstants)
+             << ", \"culled_nodes\": " << average(sum.culledNodes) << ", \"max_draws\": " << totals[i].max.draws << "}";
+    }
+    file << (totals.empty() ? "]\n" : "\n  ]\n");
+    file << "}\n";
+
+    out << "Benchmark of " << frame << " frames (" << skip << " warmup) written to " << jsonFilename << std::endl;
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include "frameStats.hpp"
+#include "renderStats.hpp"
+
+//Fixed length benchmark runs over a simulated timeline, so runs of different builds or settings draw the same frames
+//Frame n is drawn at simulation time n * step whatever the wall clock does, the app animates from simulationTime()
+//and an optional camera script (a vsg::CameraAnimation file) is played over the same timeline
+//Without --benchmark the script handler is still installed so a new script can be recorded with its keys (r to toggle)
+class SceneBenchmark
+{
+public:
+    //Reads --benchmark frames, --benchmark-step seconds, --benchmark-warmup frames, --benchmark-script file
+    //and --benchmark-json file
+    void read(vsg::CommandLine& arguments);
+
+    int frames = 0;
+    double step = 1.0 / 60.0;
+
+    //Frames at the start left out of the timings, pipelines and uploads are still settling
+    int warmup = 10;
+
+    std::string scriptFilename;
+    std::string jsonFilename = "benchmark.json";
+
+    bool enabled() const { return frames > 0; }
+
+    //Collect draw counts for the report, the overlay is only shown if --render-stats asked for it
+    //The apps leave the collection out of the frame timings with FrameStats::exclude()
+    void configure(RenderStatsMonitor& renderStats) const;
+
+    //Enough frame history for the whole run
+    size_t historySize() const { return std::max<size_t>(16384, static_cast<size_t>(frames)); }
+
+    //Add the script handler for camera, during a run the script is played from the first frame
+    void assign(vsg::ref_ptr<vsg::Viewer> viewer, vsg::ref_ptr<vsg::Camera> camera, vsg::ref_ptr<vsg::Options> options);
+
+    //True when a script is moving the camera, so the app should not move it itself
+    bool scripted() const { return enabled() && cameraAnimation && cameraAnimation->animation; }
+
+    //False once every frame of a run has been drawn, always true without --benchmark
+    bool running() const { return !enabled() || frame < frames; }
+
+    //Simulation time of the current frame, negative without --benchmark so advanceToNextFrame() uses the wall clock
+    double simulationTime() const { return enabled() ? static_cast<double>(frame) * step : -1.0; }
+
+    //Call at the end of each frame
+    void endFrame();
+
+    //Frame, update, record, present and GPU time percentiles after the warmup, and per view draw counts
+    bool writeReport(const std::string& app, const FrameStats& frameStats, const RenderStatsMonitor& renderStats, std::ostream& out) const;
+
+private:
+    vsg::ref_ptr<vsg::CameraAnimation> cameraAnimation;
+    int frame = 0;
+};
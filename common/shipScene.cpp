@@ -0,0 +1,244 @@
+#include "shipScene.hpp"
+
+#include <iostream>
+
+#include "appProfiler.hpp"
+#include "assetRegistry.hpp"
+
+vsg::ref_ptr<vsg::Node> createTextureQuad(vsg::ref_ptr<vsg::Data> sourceData, vsg::ref_ptr<vsg::Options> options)
+{
+    auto builder = vsg::Builder::create();
+    builder->options = options;
+
+    vsg::StateInfo state;
+    state.image = sourceData;
+    state.lighting = false;
+
+    vsg::GeometryInfo geom;
+    geom.dy.set(0.0f, 0.0f, 1.0f);
+    geom.dz.set(0.0f, -1.0f, 0.0f);
+
+    return builder->createQuad(geom, state);
+}
+
+vsg::ref_ptr<vsg::Node> loadObject(const std::string& filepath)
+{
+    APP_ZONE("loadObject", APP_COLOR_LOAD);
+
+    vsg::Path vsgFilePath = filepath;
+    vsg::ref_ptr<vsg::Object> object;
+    // every model is read with the same options, so state they have in common is shared
+    auto& registry = assetRegistry();
+    auto options = registry.options;
+
+    if(vsgFilePath.find(".vsg") != std::string::npos)
+    {
+        object = registry.read(vsgFilePath);
+        std::cout << "vsg" << std::endl;
+    }
+    else
+    {
+        object = registry.read(vsgFilePath).cast<vsg::Node>();
+        std::cout << "novsg" << std::endl;
+    }
+
+    if (vsg::ref_ptr<vsg::Node> node = object.cast<vsg::Node>())
+    {
+        registry.prepare(filepath, node);
+        return node;
+    }
+    else if (auto data = object.cast<vsg::Data>())
+    {
+        if (vsg::ref_ptr<vsg::Node> textureGeometry = createTextureQuad(data, options))
+        {
+            registry.prepare(filepath, textureGeometry);
+            return textureGeometry;
+        }
+    }
+    else if (object)
+    {
+        std::cout << "Unable to view object of type " << object->className() << std::endl;
+    }
+    else
+    {
+        std::cout << "Unable to load file " << vsgFilePath << std::endl;
+    }
+    vsg::ref_ptr<vsg::Node> node;
+    return node;
+}
+
+vsg::ref_ptr<vsg::MatrixTransform> makeStovePipe(vsg::ref_ptr<vsg::Builder> builder, const vsg::vec4& clr)
+{
+    vsg::GeometryInfo geomInfo;
+    vsg::StateInfo stateInfo;
+
+    float thickness = 0.05f;
+    geomInfo.dx = {thickness, 0.0f, 0.0f};
+    geomInfo.dy = {0.0f, thickness, 0.0f};
+    geomInfo.dz = {0.0f, 0.0f, 1.0f};
+    geomInfo.color = clr;
+    auto z_cylinder = builder->createCylinder(geomInfo, stateInfo);
+    geomInfo.dx = {.25f, 0.0f, 0.0f};
+    geomInfo.dy = {0.0f, .25f, 0.0f};
+    geomInfo.dz = {0.0f, 0.0f, .25f};
+    geomInfo.transform = vsg::translate(0.0f, 0.0f, 0.5f);
+    auto z_cone = builder->createCone(geomInfo, stateInfo);
+    auto stove_pipe = vsg::MatrixTransform::create();
+    stove_pipe->addChild(z_cylinder);
+    stove_pipe->addChild(z_cone);
+    return stove_pipe;
+}
+
+vsg::ref_ptr<vsg::MatrixTransform> makeAxes(vsg::ref_ptr<vsg::Builder> builder)
+{
+    float scale = 200.0f;
+    auto zStovePipe = makeStovePipe(builder, vsg::vec4{0.0f, 0.0f, 1.0f, 1.0f});
+    zStovePipe->matrix = vsg::scale(scale, scale, scale);
+
+    auto xStovePipe = makeStovePipe(builder, vsg::vec4{1.0f, 0.0f, 0.0f, 1.0f});
+    xStovePipe->matrix = vsg::rotate(vsg::radians(90.0f), 0.0f, 1.0f, 0.0f)
+        * vsg::scale(scale, scale, scale);
+
+    auto yStovePipe = makeStovePipe(builder, vsg::vec4{0.0f, 1.0f, 0.0f, 1.0f});
+    yStovePipe->matrix = vsg::rotate(vsg::radians(90.0f), -1.0f, 0.0f, 0.0f)
+        * vsg::scale(scale, scale, scale);
+
+    auto axes = vsg::MatrixTransform::create();
+    axes->addChild(zStovePipe);
+    axes->addChild(xStovePipe);
+    axes->addChild(yStovePipe);
+    return axes;
+}
+
+ShipObj::ShipObj(class vsg::ref_ptr<vsg::Group> scene, vsg::ref_ptr<vsg::Builder> builder, const std::string& modelPath)
+{
+    objNode = loadObject(modelPath);
+    // objNode = loadObject("../models/ww 1 for ele.obj");
+    // objNode = makeAxes(builder);
+    objAlignWithX = vsg::MatrixTransform::create();
+    objAlignWithX->addChild(objNode);
+    objTransform = vsg::MatrixTransform::create();
+    objTransform->addChild(objAlignWithX);
+    lastTime = 0;
+    lastTranslation = pathFunc(0);
+    objAlignWithX->matrix = vsg::rotate(vsg::radians(270.0f), 1.0f, 0.0f, 0.0f)
+        * vsg::rotate(vsg::radians(180.0f), 0.0f, 1.0f, 0.0f);
+    objTransform->matrix = vsg::translate(lastTranslation)
+        * vsg::scale(vsg::vec3(.2f, .2f, .2f));
+    scene->addChild(objTransform);
+}
+
+vsg::dbox ShipObj::fetchObjBounds()
+{
+    return vsg::visit<vsg::ComputeBounds>(objTransform).bounds;
+}
+
+vsg::vec3 ShipObj::fetchObjPosition()
+{
+    auto bounds = fetchObjBounds();
+    objPosition = (bounds.min + bounds.max) * 0.5;
+    return objPosition;
+}
+
+void ShipObj::updateTransform(double _thisTime)
+{
+    thisTime = _thisTime;
+    thisTranslation = pathFunc(thisTime);
+    objTransform->matrix = vsg::translate(thisTranslation)
+        * rotateFromTranslate()
+        * vsg::scale(vsg::vec3(0.2f, 0.2f, 0.2f));
+}
+
+vsg::mat4 ShipObj::rotateFromTranslate()
+{
+    using namespace std;
+
+    cout << "#############SHIP OBJECT#############" << endl;
+    vsg::vec3 dx = thisTranslation - lastTranslation;
+    cout << "transx: " << thisTranslation.x;
+    cout << " transy: " << thisTranslation.y;
+    cout << " transz: " << thisTranslation.z << endl;
+
+    double dt = thisTime - lastTime;
+    dx *= 1/(dt);
+    float theta = acos(dx.x/vsg::length(dx));
+    dx = vsg::normalize(dx);
+
+    lastTranslation = thisTranslation;
+    lastTime = thisTime;
+
+    auto cross = vsg::cross(vsg::vec3(1.0f, 0.0f, 0.0f), dx);
+    cross = vsg::normalize(cross);
+    cout << "dx: " << dx.x;
+    cout << " dy: " << dx.y;
+    cout << " dz: " << dx.z << endl;
+    cout << "Cross x: " << cross.x;
+    cout << " Cross y: " << cross.y;
+    cout << " Cross z: " << cross.z << endl;
+    cout << "Ship theta: " << vsg::degrees(theta) << endl;
+    return vsg::rotate(theta, cross);
+}
+
+PlaneObj::PlaneObj(class vsg::ref_ptr<vsg::Group> scene, const std::string& modelPath)
+{
+    objNode = loadObject(modelPath);
+    objAlignWithX = vsg::MatrixTransform::create();
+    objAlignWithX->addChild(objNode);
+    objTransform = vsg::MatrixTransform::create();
+    objTransform->addChild(objAlignWithX);
+    lastTime = 0;
+    lastTranslation = pathFunc(0);
+    objAlignWithX->matrix = vsg::rotate(vsg::radians(90.0f), 0.0f, 0.0f, 1.0f);
+    objTransform->matrix = vsg::translate(lastTranslation);
+    scene->addChild(objTransform);
+}
+
+vsg::dbox PlaneObj::fetchObjBounds()
+{
+    return vsg::visit<vsg::ComputeBounds>(objTransform).bounds;
+}
+
+vsg::vec3 PlaneObj::fetchObjPosition()
+{
+    auto bounds = fetchObjBounds();
+    objPosition = (bounds.min + bounds.max) * 0.5;
+    return objPosition;
+}
+
+void PlaneObj::updateTransform(double _thisTime)
+{
+    thisTime = _thisTime;
+    thisTranslation = pathFunc(thisTime);
+    objTransform->matrix = vsg::translate(thisTranslation)
+        * rotateFromTranslate();
+}
+
+vsg::mat4 PlaneObj::rotateFromTranslate()
+{
+    using namespace std;
+
+    cout << "#############PLANE OBJECT#############" << endl;
+    vsg::vec3 dx = thisTranslation - lastTranslation;
+    cout << "transx: " << thisTranslation.x;
+    cout << " transy: " << thisTranslation.y;
+    cout << " transz: " << thisTranslation.z << endl;
+
+    double dt = thisTime - lastTime;
+    dx *= 1/(dt);
+    float theta = acos(dx.x/vsg::length(dx));
+    dx = vsg::normalize(dx);
+    lastTranslation = thisTranslation;
+    lastTime = thisTime;
+
+    auto cross = vsg::cross(vsg::vec3(1.0f, 0.0f, 0.0f), dx);
+    cross = vsg::normalize(cross);
+    cout << "dx: " << dx.x;
+    cout << " dy: " << dx.y;
+    cout << " dz: " << dx.z << endl;
+    cout << "Cross x: " << cross.x;
+    cout << " Cross y: " << cross.y;
+    cout << " Cross z: " << cross.z << endl;
+    cout << "Plane theta: " << vsg::degrees(theta) << endl;
+
+    return vsg::rotate(theta, cross);
+}
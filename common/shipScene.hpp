@@ -0,0 +1,67 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <functional>
+#include <string>
+
+//Scene pieces shared by the ship scene apps and the benchmarks
+
+//Textured quad showing an image that was loaded in place of a model
+vsg::ref_ptr<vsg::Node> createTextureQuad(vsg::ref_ptr<vsg::Data> sourceData, vsg::ref_ptr<vsg::Options> options);
+
+//Reads a model with vsgXchange through assetRegistry(), returns a null node if it cannot be read or shown
+vsg::ref_ptr<vsg::Node> loadObject(const std::string& filepath);
+
+//Unit length cylinder up +z with a cone on top, in colour clr
+vsg::ref_ptr<vsg::MatrixTransform> makeStovePipe(vsg::ref_ptr<vsg::Builder> builder, const vsg::vec4& clr);
+
+//x, y and z stove pipes 200 units long
+vsg::ref_ptr<vsg::MatrixTransform> makeAxes(vsg::ref_ptr<vsg::Builder> builder);
+
+//The boat, sailing a circle of 2000 units radius
+class ShipObj
+{
+    public:
+    vsg::ref_ptr<vsg::Node> objNode;
+    vsg::vec3 objPosition;
+    vsg::ref_ptr<vsg::MatrixTransform> objAlignWithX;
+    vsg::ref_ptr<vsg::MatrixTransform> objTransform;
+    vsg::vec3 thisTranslation;
+    vsg::vec3 lastTranslation;
+    double thisTime;
+    double lastTime;
+    std::function<vsg::vec3(double)> pathFunc = [](double t){return vsg::vec3((float)(sin(t/10)*2000), (float)(cos(t/10)*2000), 33.0f);};
+
+    ShipObj(class vsg::ref_ptr<vsg::Group> scene, vsg::ref_ptr<vsg::Builder> builder, const std::string& modelPath = "../models/12219_boat_v2_L2.obj");
+
+    vsg::dbox fetchObjBounds();
+    vsg::vec3 fetchObjPosition();
+    void updateTransform(double _thisTime);
+
+    private:
+    vsg::mat4 rotateFromTranslate();
+};
+
+//The plane, flying a circle of 5000 units radius 2000 units up
+class PlaneObj
+{
+    public:
+    vsg::ref_ptr<vsg::Node> objNode;
+    vsg::vec3 objPosition;
+    vsg::ref_ptr<vsg::MatrixTransform> objAlignWithX;
+    vsg::ref_ptr<vsg::MatrixTransform> objTransform;
+    vsg::vec3 thisTranslation;
+    vsg::vec3 lastTranslation;
+    double thisTime;
+    double lastTime;
+    std::function<vsg::vec3(double)> pathFunc = [](double t){return vsg::vec3((float)(-sin(t/10)*5000), (float)(cos(t/10)*5000), 2000.0f);};
+
+    PlaneObj(class vsg::ref_ptr<vsg::Group> scene, const std::string& modelPath = "../models/ww 1 for ele.obj");
+
+    vsg::dbox fetchObjBounds();
+    vsg::vec3 fetchObjPosition();
+    void updateTransform(double _thisTime);
+
+    private:
+    vsg::mat4 rotateFromTranslate();
+};
@@ -0,0 +1,269 @@
+#include "stateRecording.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    uint32_t recordSizeFor(uint32_t payloadSize)
+    {
+        return (static_cast<uint32_t>(sizeof(double)) + payloadSize + 7u) & ~7u;
+    }
+}
+
+StateRecorder::StateRecorder(const std::string& _filename, RecordingKind kind, uint32_t _payloadSize) :
+    filename(_filename),
+    payloadSize(_payloadSize),
+    recordSize(recordSizeFor(_payloadSize))
+{
+    if (filename.empty()) return;
+
+    file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "Unable to record to " << filename << std::endl;
+        return;
+    }
+
+    RecordingHeader header;
+    header.kind = static_cast<uint32_t>(kind);
+    header.payloadSize = payloadSize;
+    header.recordSize = recordSize;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    current.reserve(chunkSize);
+    writer = std::thread([this]() { write(); });
+
+    std::cout << "Recording to " << filename << std::endl;
+}
+
+StateRecorder::~StateRecorder()
+{
+    if (!enabled()) return;
+
+    flush();
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+}
+
+void StateRecorder::append(double time, const void* payload)
+{
+    if (!enabled()) return;
+
+    auto start = std::chrono::steady_clock::now();
+
+    size_t offset = current.size();
+    current.resize(offset + recordSize);
+    std::memcpy(current.data() + offset, &time, sizeof(double));
+    std::memcpy(current.data() + offset + sizeof(double), payload, payloadSize);
+    ++records;
+
+    if (current.size() + recordSize > chunkSize)
+    {
+        //Swap in a spare chunk so the copy above never reallocates once the recorder has warmed up
+        std::vector<uint8_t> next;
+        {
+            std::scoped_lock<std::mutex> lock(mutex);
+            full.push_back(std::move(current));
+            if (!spare.empty())
+            {
+                next = std::move(spare.back());
+                spare.pop_back();
+            }
+        }
+        wake.notify_one();
+        next.clear();
+        next.reserve(chunkSize);
+        current = std::move(next);
+    }
+
+    double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    appendNanoseconds += nanoseconds;
+    appendMax = std::max(appendMax, nanoseconds);
+}
+
+void StateRecorder::flush()
+{
+    if (!enabled()) return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!current.empty())
+    {
+        full.push_back(std::move(current));
+        current = std::vector<uint8_t>();
+        current.reserve(chunkSize);
+    }
+    wake.notify_one();
+    drained.wait(lock, [this]() { return full.empty() && !writing; });
+}
+
+void StateRecorder::write()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        wake.wait(lock, [this]() { return stopping || !full.empty(); });
+        if (full.empty())
+        {
+            if (stopping) return;
+            continue;
+        }
+
+        auto chunk = std::move(full.front());
+        full.pop_front();
+        writing = true;
+        lock.unlock();
+
+        file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+        file.flush();
+        bytesWritten.fetch_add(chunk.size(), std::memory_order_relaxed);
+
+        lock.lock();
+        writing = false;
+        spare.push_back(std::move(chunk));
+        if (full.empty()) drained.notify_all();
+    }
+}
+
+void StateRecorder::report(std::ostream& out) const
+{
+    if (!enabled()) return;
+
+    out << "Recorded " << records << " records of " << recordSize << " bytes to " << filename << ", "
+        << static_cast<double>(bytesWritten.load(std::memory_order_relaxed)) / (1024.0 * 1024.0) << " MiB";
+    if (records > 0) out << ", append " << appendNanoseconds / static_cast<double>(records) << " ns average, " << appendMax << " ns max";
+    out << std::endl;
+}
+
+StatePlayer::StatePlayer(const std::string& _filename, RecordingKind kind, uint32_t _payloadSize) :
+    filename(_filename)
+{
+    if (filename.empty()) return;
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cout << "Unable to open recording " << filename << std::endl;
+        return;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) >= sizeof(RecordingHeader))
+    {
+        mappingSize = static_cast<size_t>(status.st_size);
+        mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) mapping = nullptr;
+    }
+    close(fd);
+
+    if (!mapping)
+    {
+        std::cout << "Unable to map recording " << filename << std::endl;
+        return;
+    }
+
+    RecordingHeader expected;
+    expected.kind = static_cast<uint32_t>(kind);
+    expected.payloadSize = _payloadSize;
+    expected.recordSize = recordSizeFor(_payloadSize);
+
+    auto header = static_cast<const RecordingHeader*>(mapping);
+    if (std::memcmp(header, &expected, sizeof(RecordingHeader)) != 0)
+    {
+        std::cout << filename << " is not a recording of this scene" << std::endl;
+        return;
+    }
+
+    //Playback goes through the records in order, let the kernel read ahead
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+
+    recordSize = expected.recordSize;
+    records = static_cast<const uint8_t*>(mapping) + sizeof(RecordingHeader);
+    numRecords = (mappingSize - sizeof(RecordingHeader)) / recordSize;
+
+    std::cout << "Playing " << numRecords << " records (" << endTime() - startTime() << " s) from " << filename << std::endl;
+}
+
+StatePlayer::~StatePlayer()
+{
+    if (mapping) munmap(mapping, mappingSize);
+}
+
+double StatePlayer::playbackTime(double elapsed) const
+{
+    double duration = endTime() - startTime();
+    double offset = seek + elapsed * speed;
+    if (loop && duration > 0.0)
+    {
+        offset = std::fmod(offset, duration);
+        if (offset < 0.0) offset += duration;
+    }
+    return startTime() + offset;
+}
+
+size_t StatePlayer::find(double t) const
+{
+    ++lookups;
+
+    size_t low = 0, high = numRecords;
+    while (high - low > 1)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (time(middle) <= t) low = middle;
+        else high = middle;
+    }
+    return low;
+}
+
+void StatePlayer::report(std::ostream& out) const
+{
+    if (!enabled()) return;
+
+    out << "Played " << lookups << " frames from " << numRecords << " records in " << filename << " at " << speed << "x" << std::endl;
+}
+
+void RecordingOptions::read(vsg::CommandLine& arguments)
+{
+    arguments.read("--record", recordFilename);
+    arguments.read("--play", playFilename);
+    arguments.read("--play-speed", speed);
+    arguments.read("--play-seek", seek);
+    if (arguments.read("--play-once")) loop = false;
+}
+
+void RecordingOptions::configure(StatePlayer& player) const
+{
+    player.speed = speed;
+    player.seek = seek;
+    player.loop = loop;
+}
+
+void recordTransforms(StateRecorder& recorder, double time, const std::vector<vsg::ref_ptr<vsg::MatrixTransform>>& transforms)
+{
+    if (!recorder.enabled()) return;
+
+    //Reused between frames so recording does not allocate once running
+    static thread_local std::vector<vsg::dmat4> matrices;
+    matrices.resize(transforms.size());
+    for (size_t i = 0; i < transforms.size(); ++i) matrices[i] = transforms[i]->matrix;
+    recorder.append(time, matrices.data());
+}
+
+void playTransforms(const StatePlayer& player, double time, const std::vector<vsg::ref_ptr<vsg::MatrixTransform>>& transforms)
+{
+    if (!player.enabled()) return;
+
+    auto matrices = static_cast<const vsg::dmat4*>(player.payload(player.find(time)));
+    for (size_t i = 0; i < transforms.size(); ++i) transforms[i]->matrix = matrices[i];
+}
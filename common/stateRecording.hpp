@@ -0,0 +1,147 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//What a recording holds, checked by the player so a pendulum run is not replayed into the ship scene
+enum class RecordingKind : uint32_t
+{
+    Pendulum = 1, //PData
+    Entities = 2  //one dmat4 per entity transform
+};
+
+//File layout: this header, then fixed size records, each a double time in seconds followed by payloadSize bytes
+//padded to 8 so every record and payload stays aligned when the file is memory mapped
+struct RecordingHeader
+{
+    char magic[8] = {'V', 'S', 'G', 'S', 'T', 'A', 'T', 'E'};
+    uint32_t version = 1;
+    uint32_t kind = 0;
+    uint32_t payloadSize = 0;
+    uint32_t recordSize = 0;
+};
+
+//Appends timestamped records to a file without the calling thread touching the disk
+//Records are copied into a chunk, full chunks are handed to a writer thread and come back to be reused
+class StateRecorder
+{
+public:
+    //An empty filename leaves the recorder disabled, every call is then a no-op
+    StateRecorder(const std::string& filename, RecordingKind kind, uint32_t _payloadSize);
+    ~StateRecorder();
+
+    StateRecorder(const StateRecorder&) = delete;
+    StateRecorder& operator=(const StateRecorder&) = delete;
+
+    bool enabled() const { return file.is_open(); }
+
+    //Call from one thread at a time, copies payloadSize bytes from payload
+    void append(double time, const void* payload);
+
+    //Hand over the partly filled chunk and wait for everything to reach the file
+    void flush();
+
+    void report(std::ostream& out) const;
+
+private:
+    void write();
+
+    std::string filename;
+    std::ofstream file;
+    uint32_t payloadSize;
+    uint32_t recordSize;
+
+    //Bytes per chunk handed to the writer
+    static constexpr size_t chunkSize = 1 << 16;
+    std::vector<uint8_t> current;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable drained;
+    std::deque<std::vector<uint8_t>> full;
+    std::vector<std::vector<uint8_t>> spare;
+    bool writing = false;
+    bool stopping = false;
+    std::thread writer;
+
+    uint64_t records = 0;
+    std::atomic<uint64_t> bytesWritten{0};
+    double appendNanoseconds = 0.0;
+    double appendMax = 0.0;
+};
+
+//Memory maps a recording and looks up the record to show at any time, at any speed and from any seek position
+class StatePlayer
+{
+public:
+    //An empty filename leaves the player disabled, so does a missing file or one of the wrong kind or payload size
+    StatePlayer(const std::string& filename, RecordingKind kind, uint32_t _payloadSize);
+    ~StatePlayer();
+
+    StatePlayer(const StatePlayer&) = delete;
+    StatePlayer& operator=(const StatePlayer&) = delete;
+
+    bool enabled() const { return numRecords > 0; }
+
+    //Playback rate relative to the recording, seconds into the recording to start from and whether to loop at the end
+    double speed = 1.0;
+    double seek = 0.0;
+    bool loop = true;
+
+    size_t size() const { return numRecords; }
+    double startTime() const { return numRecords > 0 ? time(0) : 0.0; }
+    double endTime() const { return numRecords > 0 ? time(numRecords - 1) : 0.0; }
+
+    //Recording time to show elapsed seconds of playback after starting
+    double playbackTime(double elapsed) const;
+
+    //Last record at or before recording time t, the first one before the recording starts, a binary search
+    size_t find(double t) const;
+
+    double time(size_t i) const { return *reinterpret_cast<const double*>(records + i * recordSize); }
+    const void* payload(size_t i) const { return records + i * recordSize + sizeof(double); }
+
+    template<typename T>
+    const T& value(size_t i) const { return *reinterpret_cast<const T*>(payload(i)); }
+
+    void report(std::ostream& out) const;
+
+private:
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    const uint8_t* records = nullptr;
+    size_t numRecords = 0;
+    uint32_t recordSize = 0;
+    std::string filename;
+
+    mutable uint64_t lookups = 0;
+};
+
+//--record file writes the run to file, --play file replays one instead of simulating
+//--play-speed x, --play-seek seconds and --play-once control the playback
+struct RecordingOptions
+{
+    std::string recordFilename;
+    std::string playFilename;
+    double speed = 1.0;
+    double seek = 0.0;
+    bool loop = true;
+
+    void read(vsg::CommandLine& arguments);
+
+    //Apply the playback settings to a player
+    void configure(StatePlayer& player) const;
+};
+
+//Entity transforms as one record of their matrices, in the order given
+void recordTransforms(StateRecorder& recorder, double time, const std::vector<vsg::ref_ptr<vsg::MatrixTransform>>& transforms);
+void playTransforms(const StatePlayer& player, double time, const std::vector<vsg::ref_ptr<vsg::MatrixTransform>>& transforms);
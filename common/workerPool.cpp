@@ -0,0 +1,80 @@
+#include "workerPool.hpp"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned int numThreads)
+{
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int i = 1; i < numThreads; ++i)
+    {
+        threads.emplace_back([this]() { work(); });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start.notify_all();
+    for (auto& thread : threads) thread.join();
+}
+
+void WorkerPool::run(size_t _numTasks, const std::function<void(size_t)>& task)
+{
+    if (_numTasks == 0) return;
+    if (threads.empty() || _numTasks == 1)
+    {
+        for (size_t i = 0; i < _numTasks; ++i) task(i);
+        return;
+    }
+
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+        currentTask = &task;
+        numTasks = _numTasks;
+        nextTask = 0;
+        busyThreads = threads.size();
+        ++generation;
+    }
+    start.notify_all();
+
+    take();
+
+    //Wait for the workers to finish the tasks they took before the task goes out of scope
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return busyThreads == 0; });
+    currentTask = nullptr;
+}
+
+void WorkerPool::take()
+{
+    for (size_t i = nextTask++; i < numTasks; i = nextTask++)
+    {
+        (*currentTask)(i);
+    }
+}
+
+void WorkerPool::work()
+{
+    uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        take();
+
+        bool last;
+        {
+            std::scoped_lock<std::mutex> lock(mutex);
+            last = (--busyThreads == 0);
+        }
+        if (last) done.notify_one();
+    }
+}
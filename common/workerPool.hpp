@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed set of threads for splitting per frame work into tasks
+//run() hands out task indices from an atomic counter, the calling thread takes tasks too and returns once all are done
+class WorkerPool
+{
+public:
+    //numThreads of 0 uses one thread per hardware thread, including the caller
+    WorkerPool(unsigned int numThreads = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    //Threads working on run(), including the caller
+    unsigned int size() const { return static_cast<unsigned int>(threads.size()) + 1; }
+
+    //Call task(i) for every i in [0, numTasks), blocks until all have returned
+    void run(size_t numTasks, const std::function<void(size_t)>& task);
+
+private:
+    void work();
+    void take();
+
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable done;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    const std::function<void(size_t)>* currentTask = nullptr;
+    size_t numTasks = 0;
+    std::atomic<size_t> nextTask{0};
+    size_t busyThreads = 0;
+};
@@ -0,0 +1,112 @@
+#include "capsuleField.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    //Animation shared by the initial layout and update()
+    inline vsg::vec4 animate(float x, float y, float time)
+    {
+        float phase = (x + y) * 0.35f;
+        return vsg::vec4(x, y, 0.4f * std::sin(time * 2.0f + phase), 1.0f + 0.25f * std::sin(time * 3.0f + phase * 0.5f));
+    }
+}
+
+CapsuleField::CapsuleField(uint32_t _count, uint32_t _chunkSize, unsigned int numThreads) :
+    count(std::min(std::max(_count, 1u), maxCount)),
+    chunkSize(std::max(_chunkSize, 1u)),
+    workers(numThreads)
+{
+    columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+}
+
+vsg::ref_ptr<vsg::Node> CapsuleField::createScene(vsg::ref_ptr<vsg::Options> options)
+{
+    auto builder = vsg::Builder::create();
+    builder->options = options;
+
+    auto scene = vsg::Group::create();
+
+    vsg::GeometryInfo geomInfo;
+    geomInfo.dx.set(0.4f * spacing, 0.0f, 0.0f);
+    geomInfo.dy.set(0.0f, 0.4f * spacing, 0.0f);
+    geomInfo.dz.set(0.0f, 0.0f, 0.8f * spacing);
+
+    vsg::StateInfo stateInfo;
+
+    //Centre the grid on the origin
+    float offset = -0.5f * static_cast<float>(columns - 1) * spacing;
+
+    for (uint32_t first = 0; first < count; first += chunkSize)
+    {
+        uint32_t size = std::min(chunkSize, count - first);
+
+        auto instances = vsg::vec4Array::create(size);
+        instances->properties.dataVariance = vsg::DYNAMIC_DATA;
+
+        vsg::dbox bounds;
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            uint32_t index = first + i;
+            float x = offset + static_cast<float>(index % columns) * spacing;
+            float y = offset + static_cast<float>(index / columns) * spacing;
+            instances->at(i) = animate(x, y, 0.0f);
+            bounds.add(vsg::dvec3(x, y, 0.0));
+        }
+
+        geomInfo.positions = instances;
+        auto capsules = builder->createCapsule(geomInfo, stateInfo);
+
+        //Pad the bound by the largest capsule at the top of its bob
+        auto cullGroup = vsg::CullGroup::create();
+        cullGroup->bound.center = (bounds.min + bounds.max) * 0.5;
+        cullGroup->bound.radius = vsg::length(bounds.max - bounds.min) * 0.5 + 1.5 * spacing;
+        cullGroup->addChild(capsules);
+        scene->addChild(cullGroup);
+
+        chunks.push_back(instances);
+    }
+
+    float side = static_cast<float>(columns + 1) * spacing;
+    vsg::GeometryInfo groundInfo;
+    groundInfo.position.set(0.0f, 0.0f, -0.8f * spacing);
+    groundInfo.dx.set(side, 0.0f, 0.0f);
+    groundInfo.dy.set(0.0f, side, 0.0f);
+    scene->addChild(builder->createQuad(groundInfo, stateInfo));
+
+    std::cout << "Capsule field: " << count << " capsules in " << chunks.size() << " instanced draws of up to " << chunkSize
+              << ", animated by " << workers.size() << " threads" << std::endl;
+
+    return scene;
+}
+
+void CapsuleField::update(double time)
+{
+    auto start = vsg::clock::now();
+
+    float t = static_cast<float>(time);
+    workers.run(chunks.size(), [&](size_t c) {
+        auto& chunk = chunks[c];
+        auto instances = chunk->data();
+        uint32_t size = static_cast<uint32_t>(chunk->size());
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            instances[i] = animate(instances[i].x, instances[i].y, t);
+        }
+        chunk->dirty();
+    });
+
+    double milliseconds = std::chrono::duration<double, std::chrono::milliseconds::period>(vsg::clock::now() - start).count();
+    totalUpdateTime += milliseconds;
+    maxUpdateTime = std::max(maxUpdateTime, milliseconds);
+    ++updates;
+}
+
+void CapsuleField::report(std::ostream& out) const
+{
+    if (updates == 0) return;
+
+    out << "Capsule field: " << count << " capsules, " << chunks.size() << " draws, animation " << totalUpdateTime / static_cast<double>(updates)
+        << " ms per frame on average, " << maxUpdateTime << " ms at most with " << workers.size() << " threads" << std::endl;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <iostream>
+#include <vector>
+
+#include "workerPool.hpp"
+
+//Stress scene of up to maxCount capsules laid out on a grid and drawn with instancing
+//The instances are split into chunks, each one instanced draw under its own CullGroup, so the number of draws,
+//the culling granularity and the number of instances per draw can be varied independently
+//Each instance's position and scale live in a DYNAMIC_DATA vec4Array that is animated by a worker pool every frame
+class CapsuleField : public vsg::Inherit<vsg::Object, CapsuleField>
+{
+public:
+    CapsuleField(uint32_t _count, uint32_t _chunkSize, unsigned int numThreads);
+
+    static constexpr uint32_t maxCount = 1000000;
+
+    const uint32_t count;
+    const uint32_t chunkSize;
+
+    //Build the chunks and a ground quad under them
+    vsg::ref_ptr<vsg::Node> createScene(vsg::ref_ptr<vsg::Options> options);
+
+    //Bob and pulse every instance, call before viewer->recordAndSubmit() so the arrays are copied this frame
+    void update(double time);
+
+    void report(std::ostream& out) const;
+
+private:
+    //Per instance xyz position and w scale of each chunk
+    std::vector<vsg::ref_ptr<vsg::vec4Array>> chunks;
+    WorkerPool workers;
+    uint32_t columns;
+    float spacing = 1.0f;
+
+    uint64_t updates = 0;
+    double totalUpdateTime = 0.0;
+    double maxUpdateTime = 0.0;
+};
@@ -0,0 +1,437 @@
+#include "clusteredLighting.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+
+namespace
+{
+    //Fragment shader for vsg's standard.vert, untextured phong lighting from the lights of the fragment's cluster
+    const char* clustered_phong_frag = R"(
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(set = 0, binding = 10) uniform MaterialData
+{
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    vec4 specularColor;
+    vec4 emissiveColor;
+    float shininess;
+    float alphaMask;
+    float alphaMaskCutoff;
+} material;
+
+layout(set = 2, binding = 0) uniform ClusterParams
+{
+    vec4 grid;     // tiles x, tiles y, slices, light count
+    vec4 depth;    // near, far, unused, slices / log(far / near)
+    vec4 viewport; // width, height, tiles x / width, tiles y / height
+    vec4 ambient;
+} params;
+
+struct Light
+{
+    vec4 position;  // view space position, range
+    vec4 color;     // color * intensity, 1 for spot lights
+    vec4 direction; // view space direction, cos of outer angle
+    vec4 cone;      // cos of inner angle
+};
+
+layout(std430, set = 2, binding = 1) readonly buffer Lights { Light lights[]; };
+layout(std430, set = 2, binding = 2) readonly buffer Clusters { uvec2 clusters[]; };
+layout(std430, set = 2, binding = 3) readonly buffer LightIndices { uint lightIndices[]; };
+
+layout(location = 0) in vec3 eyePos;
+layout(location = 1) in vec3 normalDir;
+layout(location = 2) in vec4 vertexColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    vec4 diffuseColor = vertexColor * material.diffuseColor;
+    vec3 normal = normalize(normalDir);
+    vec3 view = normalize(-eyePos);
+    if (dot(normal, view) < 0.0) normal = -normal;
+
+    vec3 color = diffuseColor.rgb * params.ambient.rgb + material.emissiveColor.rgb;
+
+    uvec3 cell;
+    cell.xy = uvec2(gl_FragCoord.xy * params.viewport.zw);
+    cell.z = uint(max(log(-eyePos.z / params.depth.x) * params.depth.w, 0.0));
+    cell = min(cell, uvec3(params.grid.xyz) - uvec3(1));
+    uvec2 range = clusters[cell.x + uint(params.grid.x) * (cell.y + uint(params.grid.y) * cell.z)];
+
+    for (uint i = range.x; i < range.x + range.y; ++i)
+    {
+        Light light = lights[lightIndices[i]];
+        vec3 delta = light.position.xyz - eyePos;
+        float distance = length(delta);
+        if (distance >= light.position.w) continue;
+
+        vec3 L = delta / distance;
+        float attenuation = 1.0 - distance / light.position.w;
+        attenuation *= attenuation;
+        if (light.color.w > 0.5) attenuation *= smoothstep(light.direction.w, light.cone.x, dot(-L, light.direction.xyz));
+
+        float NdotL = max(dot(normal, L), 0.0);
+        float specular = NdotL > 0.0 ? pow(max(dot(normal, normalize(L + view)), 0.0), max(material.shininess, 1.0)) : 0.0;
+        color += (diffuseColor.rgb * NdotL + material.specularColor.rgb * specular) * light.color.rgb * attenuation;
+    }
+
+    outColor = vec4(color, diffuseColor.a);
+}
+)";
+
+    //Adds a BindDescriptorSet of the cluster data to every StateGroup that binds a pipeline
+    class BindClusters : public vsg::Inherit<vsg::Visitor, BindClusters>
+    {
+    public:
+        vsg::Descriptors descriptors;
+        std::map<const vsg::DescriptorSetLayout*, vsg::ref_ptr<vsg::DescriptorSet>> descriptorSets;
+        uint32_t bound = 0;
+        uint32_t skipped = 0;
+
+        void apply(vsg::Node& node) override { node.traverse(*this); }
+
+        void apply(vsg::StateGroup& stateGroup) override
+        {
+            vsg::ref_ptr<vsg::PipelineLayout> layout;
+            for (auto& stateCommand : stateGroup.stateCommands)
+            {
+                if (auto bindPipeline = stateCommand.cast<vsg::BindGraphicsPipeline>()) layout = bindPipeline->pipeline->layout;
+            }
+
+            if (layout)
+            {
+                //Binding with the pipeline's own layout keeps the sets below it compatible
+                if (layout->setLayouts.size() > ClusteredLighting::descriptorSet)
+                {
+                    auto& setLayout = layout->setLayouts[ClusteredLighting::descriptorSet];
+                    auto& descriptorSet = descriptorSets[setLayout.get()];
+                    if (!descriptorSet) descriptorSet = vsg::DescriptorSet::create(setLayout, descriptors);
+
+                    stateGroup.add(vsg::BindDescriptorSet::create(VK_PIPELINE_BIND_POINT_GRAPHICS, layout, ClusteredLighting::descriptorSet, descriptorSet));
+                    ++bound;
+                }
+                else
+                {
+                    ++skipped;
+                }
+            }
+
+            stateGroup.traverse(*this);
+        }
+    };
+}
+
+ClusteredLighting::ClusteredLighting(uint32_t _numLights, unsigned int numThreads) : numLights(_numLights), workers(numThreads)
+{
+    params = vsg::vec4Array::create(4);
+    params->properties.dataVariance = vsg::DYNAMIC_DATA;
+
+    lightData = vsg::vec4Array::create(std::max(numLights, 1u) * 4);
+    lightData->properties.dataVariance = vsg::DYNAMIC_DATA;
+
+    clusterData = vsg::uivec2Array::create(numClusters);
+    clusterData->properties.dataVariance = vsg::DYNAMIC_DATA;
+
+    //Room for every light touching 64 clusters, or 16 lights in every cluster, whichever is larger
+    indexData = vsg::uintArray::create(std::max(numLights * 64, numClusters * 16));
+    indexData->properties.dataVariance = vsg::DYNAMIC_DATA;
+
+    counts.resize(numClusters);
+}
+
+void ClusteredLighting::assignShaderSet(vsg::ref_ptr<vsg::Options> options)
+{
+    options->shaderSets.erase("phong");
+    auto shaderSet = vsg::createPhongShaderSet(options);
+
+    for (auto& stage : shaderSet->stages)
+    {
+        if (stage->stage == VK_SHADER_STAGE_FRAGMENT_BIT) stage = vsg::ShaderStage::create(VK_SHADER_STAGE_FRAGMENT_BIT, "main", clustered_phong_frag);
+    }
+
+    shaderSet->addDescriptorBinding("clusterParams", "", descriptorSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, vsg::vec4Array::create(4));
+    shaderSet->addDescriptorBinding("clusterLights", "", descriptorSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, vsg::vec4Array::create(4));
+    shaderSet->addDescriptorBinding("clusterRanges", "", descriptorSet, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, vsg::uivec2Array::create(1));
+    shaderSet->addDescriptorBinding("clusterIndices", "", descriptorSet, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, vsg::uintArray::create(1));
+
+    options->shaderSets["phong"] = shaderSet;
+}
+
+void ClusteredLighting::placeLights(const vsg::dbox& bounds)
+{
+    std::mt19937 generator(numLights);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    auto span = static_cast<float>(vsg::length(bounds.max - bounds.min));
+    orbitCentre = (bounds.min + bounds.max) * 0.5;
+
+    //Shrink the lights as the count goes up so the scene does not wash out
+    float shrink = std::pow(static_cast<float>(std::max(numLights, 1u)), 0.25f);
+
+    lights.resize(numLights);
+    for (auto& light : lights)
+    {
+        light.position.set(static_cast<float>(bounds.min.x) + unit(generator) * static_cast<float>(bounds.max.x - bounds.min.x),
+                           static_cast<float>(bounds.min.y) + unit(generator) * static_cast<float>(bounds.max.y - bounds.min.y),
+                           static_cast<float>(bounds.min.z) + unit(generator) * span * 0.3f);
+        light.range = span * (0.05f + 0.15f * unit(generator)) * 4.0f / shrink;
+
+        //Bright saturated colours so individual lights can be picked out
+        float hue = unit(generator) * 6.0f;
+        vsg::vec3 color(std::clamp(std::abs(hue - 3.0f) - 1.0f, 0.0f, 1.0f),
+                        std::clamp(2.0f - std::abs(hue - 2.0f), 0.0f, 1.0f),
+                        std::clamp(2.0f - std::abs(hue - 4.0f), 0.0f, 1.0f));
+        light.color = color * 2.0f;
+
+        light.spot = unit(generator) < 0.3f;
+        light.cosOuter = std::cos(vsg::radians(20.0f + 20.0f * unit(generator)));
+        light.cosInner = std::min(1.0f, light.cosOuter + 0.05f);
+        light.orbitSpeed = 0.1f + 0.4f * unit(generator);
+    }
+}
+
+void ClusteredLighting::bind(vsg::ref_ptr<vsg::Node> scene)
+{
+    BindClusters bindClusters;
+    bindClusters.descriptors = vsg::Descriptors{
+        vsg::DescriptorBuffer::create(params, 0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
+        vsg::DescriptorBuffer::create(lightData, 1, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+        vsg::DescriptorBuffer::create(clusterData, 2, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+        vsg::DescriptorBuffer::create(indexData, 3, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)};
+    scene->accept(bindClusters);
+
+    std::cout << "Clustered lighting: " << numLights << " lights, " << tilesX << "x" << tilesY << "x" << slices << " clusters, bound to "
+              << bindClusters.bound << " pipelines" << std::endl;
+    if (bindClusters.skipped > 0)
+    {
+        std::cout << "Clustered lighting: " << bindClusters.skipped << " pipelines have no descriptor set " << descriptorSet << " and will not be lit" << std::endl;
+    }
+}
+
+void ClusteredLighting::update(double time, vsg::ref_ptr<vsg::Camera> camera, const VkExtent2D& extent)
+{
+    auto start = vsg::clock::now();
+
+    auto viewMatrix = camera->viewMatrix->transform();
+    auto projection = camera->projectionMatrix->transform();
+
+    double zNear = 0.1, zFar = 1000.0;
+    if (auto perspective = camera->projectionMatrix.cast<vsg::Perspective>())
+    {
+        zNear = perspective->nearDistance;
+        zFar = perspective->farDistance;
+    }
+
+    //Orbit the lights about the vertical axis through the centre of the scene and move them to view space
+    viewPositions.resize(lights.size());
+    viewDirections.resize(lights.size());
+    auto lightArray = lightData->data();
+    for (size_t i = 0; i < lights.size(); ++i)
+    {
+        auto& light = lights[i];
+        double angle = time * light.orbitSpeed;
+        double ca = std::cos(angle), sa = std::sin(angle);
+        double dx = light.position.x - orbitCentre.x, dy = light.position.y - orbitCentre.y;
+        vsg::dvec3 world(orbitCentre.x + dx * ca - dy * sa, orbitCentre.y + dx * sa + dy * ca, light.position.z);
+
+        //Spot lights point down and slightly outwards
+        vsg::dvec3 worldDirection = vsg::normalize(vsg::dvec3(dx * ca - dy * sa, dx * sa + dy * ca, -4.0 * light.range));
+
+        auto eye = viewMatrix * world;
+        auto eyeDirection = vsg::normalize((viewMatrix * (world + worldDirection)) - eye);
+        viewPositions[i] = vsg::vec3(eye);
+        viewDirections[i] = vsg::vec3(eyeDirection);
+
+        auto& position = lightArray[i * 4];
+        auto& color = lightArray[i * 4 + 1];
+        auto& direction = lightArray[i * 4 + 2];
+        auto& cone = lightArray[i * 4 + 3];
+        position.set(viewPositions[i].x, viewPositions[i].y, viewPositions[i].z, light.range);
+        color.set(light.color.x, light.color.y, light.color.z, light.spot ? 1.0f : 0.0f);
+        direction.set(viewDirections[i].x, viewDirections[i].y, viewDirections[i].z, light.cosOuter);
+        cone.set(light.cosInner, 0.0f, 0.0f, 0.0f);
+    }
+
+    assign(projection, zNear, zFar, extent);
+
+    auto paramArray = params->data();
+    paramArray[0].set(static_cast<float>(tilesX), static_cast<float>(tilesY), static_cast<float>(slices), static_cast<float>(numLights));
+    paramArray[1].set(static_cast<float>(zNear), static_cast<float>(zFar), 0.0f, static_cast<float>(slices / std::log(zFar / zNear)));
+    paramArray[2].set(static_cast<float>(extent.width), static_cast<float>(extent.height), static_cast<float>(tilesX) / static_cast<float>(extent.width),
+                      static_cast<float>(tilesY) / static_cast<float>(extent.height));
+    paramArray[3].set(ambient.x, ambient.y, ambient.z, 1.0f);
+
+    params->dirty();
+    lightData->dirty();
+    clusterData->dirty();
+    indexData->dirty();
+
+    totalAssignTime += std::chrono::duration<double, std::chrono::milliseconds::period>(vsg::clock::now() - start).count();
+    ++updates;
+}
+
+void ClusteredLighting::assign(const vsg::dmat4& projection, double zNear, double zFar, const VkExtent2D& extent)
+{
+    auto start = vsg::clock::now();
+
+    //One chunk of lights per thread, each with its own counts so no two threads write the same cluster
+    size_t numChunks = std::max<size_t>(1, std::min<size_t>(workers.size(), (lights.size() + lightBlock - 1) / lightBlock));
+    ranges.resize(lights.size());
+    chunkCounts.assign(numChunks * numClusters, 0u);
+
+    vsg::mat4 projectionf(projection);
+    auto chunkBegin = [&](size_t chunk) { return lights.size() * chunk / numChunks; };
+    workers.run(numChunks, [&](size_t chunk) {
+        assignRange(chunkBegin(chunk), chunkBegin(chunk + 1), projectionf, zNear, zFar, &chunkCounts[chunk * numClusters]);
+    });
+
+    //Counting sort, prefix sum of the counts gives each cluster's offset into the index list
+    //Within a cluster each chunk's lights follow the previous chunk's, so the list is in light order as if built on one thread
+    uint32_t capacity = static_cast<uint32_t>(indexData->size());
+    auto clusters = clusterData->data();
+    uint32_t offset = 0;
+    for (uint32_t c = 0; c < numClusters; ++c)
+    {
+        uint32_t total = 0;
+        for (size_t chunk = 0; chunk < numChunks; ++chunk)
+        {
+            auto& chunkCount = chunkCounts[chunk * numClusters + c];
+            uint32_t count = chunkCount;
+            chunkCount = offset + total;
+            total += count;
+        }
+        counts[c] = total;
+
+        uint32_t count = std::min(total, capacity - std::min(offset, capacity));
+        clusters[c].set(offset, count);
+        maxClusterLights = std::max(maxClusterLights, total);
+        offset += total;
+    }
+    if (offset > capacity) ++overflowFrames;
+    totalIndices += std::min(offset, capacity);
+
+    auto indices = indexData->data();
+    workers.run(numChunks, [&](size_t chunk) {
+        auto cursors = &chunkCounts[chunk * numClusters];
+        for (size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i)
+        {
+            auto& range = ranges[i];
+            for (uint32_t z = range.z0; z <= range.z1; ++z)
+                for (uint32_t y = range.y0; y <= range.y1; ++y)
+                    for (uint32_t x = range.x0; x <= range.x1; ++x)
+                    {
+                        auto& cursor = cursors[x + tilesX * (y + tilesY * z)];
+                        if (cursor < capacity) indices[cursor++] = static_cast<uint32_t>(i);
+                    }
+        }
+    });
+
+    totalClusterTime += std::chrono::duration<double, std::chrono::milliseconds::period>(vsg::clock::now() - start).count();
+}
+
+void ClusteredLighting::assignRange(size_t begin, size_t end, const vsg::mat4& m, double zNear, double zFar, uint32_t* chunkCounts)
+{
+    double sliceScale = slices / std::log(zFar / zNear);
+    auto slice = [&](double depth) {
+        if (depth <= zNear) return 0u;
+        return std::min(slices - 1, static_cast<uint32_t>(std::log(depth / zNear) * sliceScale));
+    };
+    auto tile = [](double ndc, uint32_t tiles) {
+        return std::min(tiles - 1, static_cast<uint32_t>(std::max(0.0, (ndc + 1.0) * 0.5 * tiles)));
+    };
+
+    for (size_t first = begin; first < end; first += lightBlock)
+    {
+        size_t count = std::min(lightBlock, end - first);
+
+        //Structure of arrays copy of the block, the unused tail sits one unit in front of the camera so it divides safely
+        float x[lightBlock], y[lightBlock], z[lightBlock], r[lightBlock];
+        for (size_t i = 0; i < lightBlock; ++i)
+        {
+            bool used = i < count;
+            x[i] = used ? viewPositions[first + i].x : 0.0f;
+            y[i] = used ? viewPositions[first + i].y : 0.0f;
+            z[i] = used ? viewPositions[first + i].z : -1.0f;
+            r[i] = used ? lights[first + i].range : 0.0f;
+        }
+
+        //Projected box of each light's view space bounding box, a fixed trip count and no branches so it vectorises
+        //Lights behind or through the near plane give meaningless boxes here, they are sorted out below
+        float minX[lightBlock], maxX[lightBlock], minY[lightBlock], maxY[lightBlock];
+        std::fill(std::begin(minX), std::end(minX), 1.0f);
+        std::fill(std::begin(maxX), std::end(maxX), -1.0f);
+        std::fill(std::begin(minY), std::end(minY), 1.0f);
+        std::fill(std::begin(maxY), std::end(maxY), -1.0f);
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            float sx = (corner & 1) ? 1.0f : -1.0f, sy = (corner & 2) ? 1.0f : -1.0f, sz = (corner & 4) ? 1.0f : -1.0f;
+            for (size_t i = 0; i < lightBlock; ++i)
+            {
+                float px = x[i] + sx * r[i], py = y[i] + sy * r[i], pz = z[i] + sz * r[i];
+                float cx = m[0][0] * px + m[1][0] * py + m[2][0] * pz + m[3][0];
+                float cy = m[0][1] * px + m[1][1] * py + m[2][1] * pz + m[3][1];
+                float cw = m[0][3] * px + m[1][3] * py + m[2][3] * pz + m[3][3];
+                float nx = cx / cw, ny = cy / cw;
+                minX[i] = std::min(minX[i], nx);
+                maxX[i] = std::max(maxX[i], nx);
+                minY[i] = std::min(minY[i], ny);
+                maxY[i] = std::max(maxY[i], ny);
+            }
+        }
+
+        //Conservative cluster range of each light
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto& range = ranges[first + i];
+            double radius = r[i];
+            double depth = -z[i];
+
+            if (depth + radius < zNear || depth - radius > zFar)
+            {
+                range = ClusterRange{1, 0, 1, 0, 1, 0};
+                continue;
+            }
+
+            //Crossing the near plane the projected box is unbounded
+            bool throughNear = depth - radius <= zNear;
+            double x0 = throughNear ? -1.0 : minX[i], x1 = throughNear ? 1.0 : maxX[i];
+            double y0 = throughNear ? -1.0 : minY[i], y1 = throughNear ? 1.0 : maxY[i];
+
+            if (x1 < -1.0 || x0 > 1.0 || y1 < -1.0 || y0 > 1.0)
+            {
+                range = ClusterRange{1, 0, 1, 0, 1, 0};
+                continue;
+            }
+
+            range = ClusterRange{tile(x0, tilesX), tile(x1, tilesX), tile(y0, tilesY), tile(y1, tilesY), slice(depth - radius), slice(depth + radius)};
+
+            for (uint32_t cz = range.z0; cz <= range.z1; ++cz)
+                for (uint32_t cy = range.y0; cy <= range.y1; ++cy)
+                {
+                    auto row = &chunkCounts[tilesX * (cy + tilesY * cz)];
+                    for (uint32_t cx = range.x0; cx <= range.x1; ++cx) ++row[cx];
+                }
+        }
+    }
+}
+
+void ClusteredLighting::report(std::ostream& out) const
+{
+    if (updates == 0) return;
+
+    out << "Clustered lighting: " << numLights << " lights, light assignment " << totalAssignTime / static_cast<double>(updates) << " ms per frame, "
+        << static_cast<double>(totalIndices) / static_cast<double>(updates * numClusters) << " lights per cluster on average, "
+        << maxClusterLights << " at most" << std::endl;
+    out << "Clustered lighting: binning " << totalClusterTime * 1e6 / static_cast<double>(updates * std::max(numLights, 1u)) << " ns per light on "
+        << workers.size() << " threads" << std::endl;
+    if (overflowFrames > 0)
+    {
+        out << "Clustered lighting: the light index list overflowed in " << overflowFrames << " frames, some lights were dropped" << std::endl;
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <iostream>
+#include <vector>
+
+#include "workerPool.hpp"
+
+//Clustered forward shading for large numbers of point and spot lights
+//The view frustum is split into tilesX * tilesY screen tiles and exponentially spaced depth slices,
+//each frame the lights are assigned to the clusters they touch on the CPU and the fragment shader
+//only loops over the lights of its own cluster, so cost follows local light density rather than the light count
+//The assignment splits the lights over worker threads, each projects its lights' bounds a block at a time in a branch
+//free loop the compiler vectorises and counts them into its own copy of the grid
+class ClusteredLighting : public vsg::Inherit<vsg::Object, ClusteredLighting>
+{
+public:
+    //numThreads of 0 assigns lights on one thread per hardware thread
+    ClusteredLighting(uint32_t _numLights, unsigned int numThreads = 0);
+
+    static constexpr uint32_t tilesX = 16;
+    static constexpr uint32_t tilesY = 9;
+    static constexpr uint32_t slices = 24;
+    static constexpr uint32_t numClusters = tilesX * tilesY * slices;
+
+    //Descriptor set the cluster data is bound to, after vsg's view dependent set 1
+    static constexpr uint32_t descriptorSet = 2;
+
+    const uint32_t numLights;
+
+    //Ambient term added in the clustered shader, which replaces vsg's ambient and directional lights
+    vsg::vec3 ambient{0.05f, 0.05f, 0.05f};
+
+    //Replace the "phong" ShaderSet in options so the Builder creates pipelines that shade through the clusters
+    //Call before building the scene, only untextured geometry is supported by the clustered shader
+    void assignShaderSet(vsg::ref_ptr<vsg::Options> options);
+
+    //Scatter a mix of point and spot lights over the bounds
+    void placeLights(const vsg::dbox& bounds);
+
+    //Bind the cluster data to every pipeline in the subgraph that was created from the clustered ShaderSet
+    void bind(vsg::ref_ptr<vsg::Node> scene);
+
+    //Animate the lights and rebuild the cluster grid for the camera, call after viewer->update()
+    void update(double time, vsg::ref_ptr<vsg::Camera> camera, const VkExtent2D& extent);
+
+    void report(std::ostream& out) const;
+
+private:
+    struct Light
+    {
+        vsg::vec3 position;
+        float range;
+        vsg::vec3 color;
+        bool spot;
+        float cosInner;
+        float cosOuter;
+        float orbitSpeed;
+    };
+
+    struct ClusterRange
+    {
+        uint32_t x0, x1, y0, y1, z0, z1;
+    };
+
+    //Lights projected together, sized so a block's arrays stay in L1
+    static constexpr size_t lightBlock = 64;
+
+    void assign(const vsg::dmat4& projection, double zNear, double zFar, const VkExtent2D& extent);
+
+    //Cluster ranges of lights [begin, end), counted into chunkCounts
+    void assignRange(size_t begin, size_t end, const vsg::mat4& projection, double zNear, double zFar, uint32_t* chunkCounts);
+
+    WorkerPool workers;
+
+    std::vector<Light> lights;
+    vsg::dvec3 orbitCentre;
+
+    //Scratch space reused every frame
+    std::vector<ClusterRange> ranges;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> chunkCounts; //numClusters per chunk, then each chunk's cursors into the index list
+    std::vector<vsg::vec3> viewPositions;
+    std::vector<vsg::vec3> viewDirections;
+
+    //GPU side, all DYNAMIC_DATA so vsg copies them each frame they are dirtied
+    vsg::ref_ptr<vsg::vec4Array> params;
+    vsg::ref_ptr<vsg::vec4Array> lightData;
+    vsg::ref_ptr<vsg::uivec2Array> clusterData;
+    vsg::ref_ptr<vsg::uintArray> indexData;
+
+    uint64_t updates = 0;
+    double totalAssignTime = 0.0;
+    double totalClusterTime = 0.0;
+    uint64_t totalIndices = 0;
+    uint32_t maxClusterLights = 0;
+    uint64_t overflowFrames = 0;
+};
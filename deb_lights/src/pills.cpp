@@ -11,6 +11,16 @@
 #include <sstream>
 #include <tuple>
 
+#include "onDemandRendering.hpp"
+#include "frameStats.hpp"
+#include "appProfiler.hpp"
+#include "metricsPublisher.hpp"
+#include "renderStats.hpp"
+#include "sceneBenchmark.hpp"
+#include "clusteredLighting.hpp"
+#include "specializedLighting.hpp"
+#include "capsuleField.hpp"
+
 template <typename T>
 std::string demangle(T&&) {
     auto name = typeid(T).name();
@@ -36,6 +46,8 @@ ostream& operator<<(ostream& os, const vsg::GeometryInfo& gi)
 
 std::tuple<vsg::ref_ptr<vsg::Node>, vsg::ref_ptr<vsg::MatrixTransform>> createTestScene(vsg::ref_ptr<vsg::Options> options)
 {
+    APP_ZONE("createTestScene", APP_COLOR_LOAD);
+
     auto builder = vsg::Builder::create();
     builder->options = options;
 
@@ -89,6 +101,20 @@ int main(int argc, char** argv)
     arguments.read("--screen", windowTraits->screenNum);
     arguments.read("--display", windowTraits->display);
     auto numFrames = arguments.value(-1, "-f");
+    bool onDemand = arguments.read("--on-demand");
+    FrameStatsOptions frameStatsOptions;
+    frameStatsOptions.read(arguments);
+    // --benchmark N draws N frames on a fixed simulated timeline and writes a JSON report
+    SceneBenchmark benchmark;
+    benchmark.read(arguments);
+    ProfilerOptions profilerOptions;
+    profilerOptions.read(arguments);
+
+    // create the profiler up front so loading shows up in it
+    auto instrumentation = profilerOptions.createInstrumentation();
+    MetricsPublisher metrics(readMetricsName(arguments), "pills");
+    RenderStatsMonitor renderStats(arguments.read("--render-stats"));
+    benchmark.configure(renderStats);
     if (arguments.read({"--fullscreen", "--fs"})) windowTraits->fullscreen = true;
     if (arguments.read({"--window", "-w"}, windowTraits->width, windowTraits->height)) { windowTraits->fullscreen = false; }
     if (arguments.read("--IMMEDIATE")) windowTraits->swapchainPreferences.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
@@ -121,43 +147,99 @@ int main(int argc, char** argv)
         add_spotlight = false;
     }
 
+    // --threads sets the worker threads of the capsule animation and the clustered light assignment, one per core by default
+    auto numThreads = arguments.value<unsigned int>(0, "--threads");
+
+    // --lights N shades N point and spot lights through a clustered light grid instead of vsg's lights
+    uint32_t numClusteredLights = 0;
+    vsg::ref_ptr<ClusteredLighting> clusteredLighting;
+    if (arguments.read("--lights", numClusteredLights) && numClusteredLights > 0)
+    {
+        clusteredLighting = ClusteredLighting::create(numClusteredLights, numThreads);
+        clusteredLighting->assignShaderSet(options);
 
-    auto tup = createTestScene(options);
-    auto scene = std::get<0>(tup);
-    auto grab_node = std::get<1>(tup);
+        add_ambient = false;
+        add_directional = false;
+        add_point = false;
+        add_spotlight = false;
+        add_headlight = false;
+    }
+
+    // --specialize builds every light under a switch and shades with pipelines specialized for the lights that are on
+    bool specialize = arguments.read("--specialize") && !clusteredLighting;
+
+    // --count N replaces the five capsules with N instanced capsules animated on the worker threads
+    uint32_t capsuleCount = 0;
+    vsg::ref_ptr<CapsuleField> capsuleField;
+    if (arguments.read("--count", capsuleCount) && capsuleCount > 0)
+    {
+        auto chunkSize = arguments.value<uint32_t>(16384, "--chunk");
+        capsuleField = CapsuleField::create(capsuleCount, chunkSize, numThreads);
+    }
+
+    vsg::ref_ptr<vsg::Node> scene;
+    vsg::ref_ptr<vsg::MatrixTransform> grab_node;
+    if (capsuleField)
+    {
+        APP_ZONE("createCapsuleField", APP_COLOR_LOAD);
+        scene = capsuleField->createScene(options);
+    }
+    else
+    {
+        std::tie(scene, grab_node) = createTestScene(options);
+    }
 
     // compute the bounds of the scene graph to help position camera
     auto bounds = vsg::visit<vsg::ComputeBounds>(scene).bounds;
 
-    if (add_ambient || add_directional || add_point || add_spotlight || add_headlight)
+    if (clusteredLighting)
+    {
+        clusteredLighting->placeLights(bounds);
+        clusteredLighting->bind(scene);
+    }
+
+    vsg::ref_ptr<vsg::Switch> lightSwitch;
+    auto litScene = scene;
+    if (specialize || add_ambient || add_directional || add_point || add_spotlight || add_headlight)
     {
         auto span = vsg::length(bounds.max - bounds.min);
         auto group = vsg::Group::create();
         group->addChild(scene);
 
+        // with --specialize every light is created so the keys can switch them, only the requested ones start on
+        if (specialize)
+        {
+            lightSwitch = vsg::Switch::create();
+            group->addChild(lightSwitch);
+        }
+        auto addLight = [&](bool enabled, vsg::ref_ptr<vsg::Node> light) {
+            if (lightSwitch) lightSwitch->addChild(enabled, light);
+            else if (enabled) group->addChild(light);
+        };
+
         // ambient light
-        if (add_ambient)
+        if (add_ambient || specialize)
         {
             auto ambientLight = vsg::AmbientLight::create();
             ambientLight->name = "ambient";
             ambientLight->color.set(1.0f, 1.0f, 1.0f);
             ambientLight->intensity = 0.01f;
-            group->addChild(ambientLight);
+            addLight(add_ambient, ambientLight);
         }
 
         // directional light
-        if (add_directional)
+        if (add_directional || specialize)
         {
             auto directionalLight = vsg::DirectionalLight::create();
             directionalLight->name = "directional";
             directionalLight->color.set(1.0f, 1.0f, 1.0f);
             directionalLight->intensity = 0.85f;
             directionalLight->direction.set(0.0f, -1.0f, -1.0f);
-            group->addChild(directionalLight);
+            addLight(add_directional, directionalLight);
         }
 
         // point light
-        if (add_point)
+        if (add_point || specialize)
         {
             auto pointLight = vsg::PointLight::create();
             pointLight->name = "point";
@@ -172,11 +254,11 @@ int main(int argc, char** argv)
 
             cullGroup->addChild(pointLight);
 
-            group->addChild(cullGroup);
+            addLight(add_point, cullGroup);
         }
 
         // spot light
-        if (add_spotlight)
+        if (add_spotlight || specialize)
         {
             auto spotLight = vsg::SpotLight::create();
             spotLight->name = "spot";
@@ -194,10 +276,10 @@ int main(int argc, char** argv)
 
             cullGroup->addChild(spotLight);
 
-            group->addChild(cullGroup);
+            addLight(add_spotlight, cullGroup);
         }
 
-        if (add_headlight)
+        if (add_headlight || specialize)
         {
             auto ambientLight = vsg::AmbientLight::create();
             ambientLight->name = "ambient";
@@ -214,7 +296,7 @@ int main(int argc, char** argv)
             absoluteTransform->addChild(ambientLight);
             absoluteTransform->addChild(directionalLight);
 
-            group->addChild(absoluteTransform);
+            addLight(add_headlight, absoluteTransform);
         }
 
         scene = group;
@@ -261,28 +343,89 @@ int main(int argc, char** argv)
     viewer->addEventHandler(vsg::CloseHandler::create(viewer));
     viewer->addEventHandler(vsg::Trackball::create(camera));
 
+    // camera script played by --benchmark, or recorded into when not benchmarking
+    benchmark.assign(viewer, camera, options);
+
+    // only render when something changes if --on-demand is set
+    auto onDemandRendering = OnDemandRendering::create(onDemand && !benchmark.enabled());
+    viewer->addEventHandler(onDemandRendering);
+
+    vsg::ref_ptr<SpecializedLighting> specializedLighting;
+    if (lightSwitch)
+    {
+        specializedLighting = SpecializedLighting::create(viewer.get(), litScene, lightSwitch);
+        viewer->addEventHandler(SpecializedLightingHandler::create(specializedLighting));
+    }
+
     auto renderGraph = vsg::RenderGraph::create(window, view);
     auto commandGraph = vsg::CommandGraph::create(window, renderGraph);
     viewer->assignRecordAndSubmitTaskAndPresentation({commandGraph});
 
+    if (instrumentation) viewer->assignInstrumentation(instrumentation);
+
+    // time every frame, plus the GPU work of the main window using timestamp queries
+    FrameStats frameStats(benchmark.historySize());
+    frameStats.budget = frameStatsOptions.budget;
+    if (frameStatsOptions.gpuTime)
+    {
+        frameStats.gpuTimer = GpuFrameTimer::create();
+        frameStats.gpuTimer->assign(commandGraph);
+    }
+
+    renderStats.assign(commandGraph, window, options);
+    metrics.scene = scene;
     viewer->compile();
 
+    if (specializedLighting) specializedLighting->select();
+
     auto startTime = vsg::clock::now();
     double numFramesCompleted = 0.0;
 
     // rendering main loop
-    while (viewer->advanceToNextFrame() && (numFrames < 0 || (numFrames--) > 0))
+    while (benchmark.running() && onDemandRendering->advanceToNextFrame(viewer, benchmark.simulationTime()) && (numFrames < 0 || (numFrames--) > 0))
     {
-        auto t = std::chrono::duration<double, std::chrono::seconds::period>(vsg::clock::now() - startTime).count();
-        grab_node->matrix = vsg::translate(vsg::vec3(0.0f, sin(t), 0.0f))
-            * vsg::scale(vsg::vec3(.2f, .2f, .2f)) * vsg::rotate(vsg::radians(45.0f * (float)sin(t)), 0.0f, 1.0f, 0.0f);
+        frameStats.beginFrame();
+
+        auto t = benchmark.enabled() ? benchmark.simulationTime() : std::chrono::duration<double, std::chrono::seconds::period>(vsg::clock::now() - startTime).count();
+        if (capsuleField)
+        {
+            APP_ZONE("entity update", APP_COLOR_UPDATE);
+            capsuleField->update(t);
+        }
+        else
+        {
+            APP_ZONE("entity update", APP_COLOR_UPDATE);
+            grab_node->matrix = vsg::translate(vsg::vec3(0.0f, sin(t), 0.0f))
+                * vsg::scale(vsg::vec3(.2f, .2f, .2f)) * vsg::rotate(vsg::radians(45.0f * (float)sin(t)), 0.0f, 1.0f, 0.0f);
+        }
         // grab_node->matrix = vsg::rotate(vsg::radians(45.0f * (float)sin(t)), 0.0f, 1.0f, 0.0f);
 
+        // grab_node is animated every frame so keep the on demand loop running
+        onDemandRendering->requestFrame();
+
         // pass any events into EventHandlers assigned to the Viewer
         viewer->handleEvents();
         viewer->update();
+
+        // assign the lights to clusters with the camera that is about to be recorded
+        if (clusteredLighting)
+        {
+            APP_ZONE("light assignment", APP_COLOR_UPDATE);
+            clusteredLighting->update(t, camera, window->extent2D());
+        }
+
+        frameStats.mark(FrameStats::UPDATE);
+        // the stats walk is left out of the timings, it is not part of drawing the frame
+        renderStats.collect();
+        frameStats.exclude();
         viewer->recordAndSubmit();
+        frameStats.mark(FrameStats::RECORD);
         viewer->present();
+        frameStats.mark(FrameStats::PRESENT);
+        frameStats.endFrame();
+        if (specializedLighting) specializedLighting->endFrame(frameStats.gpuTimer);
+        metrics.endFrame();
+        benchmark.endFrame();
         numFramesCompleted += 1.0;
     }
 
@@ -291,6 +434,22 @@ int main(int argc, char** argv)
     {
         std::cout << "Average frame rate = " << (numFramesCompleted / duration) << std::endl;
     }
+    onDemandRendering->report(std::cout);
+    frameStats.report(std::cout);
+    renderStats.report(std::cout);
+    benchmark.writeReport("pills", frameStats, renderStats, std::cout);
+    if (capsuleField) capsuleField->report(std::cout);
+    if (clusteredLighting) clusteredLighting->report(std::cout);
+    if (specializedLighting)
+    {
+        specializedLighting->finish();
+        specializedLighting->report(std::cout);
+    }
+    if (!frameStatsOptions.csvFilename.empty() && !frameStats.writeCSV(frameStatsOptions.csvFilename))
+    {
+        std::cout << "Unable to write " << frameStatsOptions.csvFilename << std::endl;
+    }
+    reportProfiler(instrumentation, profilerOptions.traceFilename, std::cout);
 
     return 0;
 }
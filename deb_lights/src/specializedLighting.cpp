@@ -0,0 +1,379 @@
+#include "specializedLighting.hpp"
+
+#include "appProfiler.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+    //Fragment shader for vsg's standard.vert, untextured phong lighting from vsg's LightData (vsg 1.1 layout, shadows ignored)
+    //lit as vsg's phong shader lights the Builder's untextured geometry: ambient from material.ambientColor, Blinn-Phong
+    //specular and the alpha mask
+    //The light counts in LightData are only trusted up to the specialization constants, so loops for absent light types
+    //are removed by the driver and the remaining loops have a constant trip count limit
+    //Both modes use it, the generic pipelines with limits no scene reaches, so the two only differ by the specialization
+    const char* specialized_phong_frag = R"(
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(constant_id = 0) const int MAX_AMBIENT_LIGHTS = 0;
+layout(constant_id = 1) const int MAX_DIRECTIONAL_LIGHTS = 0;
+layout(constant_id = 2) const int MAX_POINT_LIGHTS = 0;
+layout(constant_id = 3) const int MAX_SPOT_LIGHTS = 0;
+
+layout(set = 0, binding = 10) uniform MaterialData
+{
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    vec4 specularColor;
+    vec4 emissiveColor;
+    float shininess;
+    float alphaMask;
+    float alphaMaskCutoff;
+} material;
+
+layout(set = 1, binding = 0) uniform LightData
+{
+    vec4 values[2048];
+} lightData;
+
+layout(location = 0) in vec3 eyePos;
+layout(location = 1) in vec3 normalDir;
+layout(location = 2) in vec4 vertexColor;
+
+layout(location = 0) out vec4 outColor;
+
+vec3 computeLighting(vec3 diffuseColor, vec3 L, vec3 N, vec3 V)
+{
+    float NdotL = max(dot(N, L), 0.0);
+    vec3 color = diffuseColor * NdotL;
+    if (NdotL > 0.0) color += material.specularColor.rgb * pow(max(dot(normalize(L + V), N), 0.0), max(material.shininess, 1.0));
+    return color;
+}
+
+void main()
+{
+    vec4 diffuseColor = vertexColor * material.diffuseColor;
+    vec4 ambientColor = vertexColor * material.ambientColor;
+    if (material.alphaMask == 1.0 && diffuseColor.a < material.alphaMaskCutoff) discard;
+
+    vec3 N = normalize(normalDir);
+    vec3 V = normalize(-eyePos);
+    if (dot(N, V) < 0.0) N = -N;
+
+    vec3 color = material.emissiveColor.rgb;
+
+    ivec4 lightCounts = ivec4(lightData.values[0]);
+    int index = 1;
+
+    for (int i = 0; i < MAX_AMBIENT_LIGHTS; ++i)
+    {
+        if (i >= lightCounts[0]) break;
+        vec4 lightColor = lightData.values[index++];
+        color += ambientColor.rgb * lightColor.rgb * lightColor.a;
+    }
+
+    for (int i = 0; i < MAX_DIRECTIONAL_LIGHTS; ++i)
+    {
+        if (i >= lightCounts[1]) break;
+        vec4 lightColor = lightData.values[index++];
+        vec3 L = -lightData.values[index++].xyz;
+        vec4 shadowSettings = lightData.values[index++];
+        index += int(shadowSettings.r) * 8;
+        color += computeLighting(diffuseColor.rgb, L, N, V) * lightColor.rgb * lightColor.a;
+    }
+
+    for (int i = 0; i < MAX_POINT_LIGHTS; ++i)
+    {
+        if (i >= lightCounts[2]) break;
+        vec4 lightColor = lightData.values[index++];
+        vec3 delta = lightData.values[index++].xyz - eyePos;
+        float distance2 = dot(delta, delta);
+        color += computeLighting(diffuseColor.rgb, delta * inversesqrt(distance2), N, V) * lightColor.rgb * (lightColor.a / distance2);
+    }
+
+    for (int i = 0; i < MAX_SPOT_LIGHTS; ++i)
+    {
+        if (i >= lightCounts[3]) break;
+        vec4 lightColor = lightData.values[index++];
+        vec4 position_cosInner = lightData.values[index++];
+        vec4 direction_cosOuter = lightData.values[index++];
+        vec4 shadowSettings = lightData.values[index++];
+        index += int(shadowSettings.r) * 8;
+
+        vec3 delta = position_cosInner.xyz - eyePos;
+        float distance2 = dot(delta, delta);
+        vec3 L = delta * inversesqrt(distance2);
+        float cone = smoothstep(direction_cosOuter.w, position_cosInner.w, dot(direction_cosOuter.xyz, -L));
+        color += computeLighting(diffuseColor.rgb, L, N, V) * lightColor.rgb * (lightColor.a * cone / distance2);
+    }
+
+    outColor = vec4(color, diffuseColor.a);
+}
+)";
+
+    //Light counts LightData cannot reach, it holds 2048 vec4s, so the generic loops only stop on the counts it holds
+    const LightMix genericLimits{1024, 1024, 1024, 1024};
+
+    //Counts the lights in a subgraph by type
+    class CountLights : public vsg::Inherit<vsg::ConstVisitor, CountLights>
+    {
+    public:
+        LightMix mix;
+
+        void apply(const vsg::Node& node) override { node.traverse(*this); }
+        void apply(const vsg::AmbientLight&) override { ++mix.ambient; }
+        void apply(const vsg::DirectionalLight&) override { ++mix.directional; }
+        void apply(const vsg::PointLight&) override { ++mix.point; }
+        void apply(const vsg::SpotLight&) override { ++mix.spot; }
+    };
+
+    //Finds every StateGroup that binds a graphics pipeline, lit pipelines are the ones with vsg's view descriptor set
+    class FindLitPipelines : public vsg::Inherit<vsg::Visitor, FindLitPipelines>
+    {
+    public:
+        struct Found
+        {
+            vsg::ref_ptr<vsg::StateGroup> stateGroup;
+            size_t index;
+        };
+
+        std::vector<Found> found;
+
+        void apply(vsg::Node& node) override { node.traverse(*this); }
+
+        void apply(vsg::StateGroup& stateGroup) override
+        {
+            for (size_t i = 0; i < stateGroup.stateCommands.size(); ++i)
+            {
+                auto bindPipeline = stateGroup.stateCommands[i].cast<vsg::BindGraphicsPipeline>();
+                if (bindPipeline && bindPipeline->pipeline->layout->setLayouts.size() > 1) found.push_back(Found{vsg::ref_ptr<vsg::StateGroup>(&stateGroup), i});
+            }
+            stateGroup.traverse(*this);
+        }
+    };
+
+    //Hands a compiled mix back to the main thread, run by viewer->update()
+    class MixCompiled : public vsg::Inherit<vsg::Operation, MixCompiled>
+    {
+    public:
+        MixCompiled(vsg::ref_ptr<SpecializedLighting> _lighting, const LightMix& _mix, std::vector<vsg::ref_ptr<vsg::BindGraphicsPipeline>> _pipelines, double _milliseconds) :
+            lighting(_lighting), mix(_mix), pipelines(_pipelines), milliseconds(_milliseconds) {}
+
+        vsg::ref_ptr<SpecializedLighting> lighting;
+        LightMix mix;
+        std::vector<vsg::ref_ptr<vsg::BindGraphicsPipeline>> pipelines;
+        double milliseconds;
+
+        void run() override { lighting->compiled(mix, pipelines, milliseconds); }
+    };
+}
+
+std::string LightMix::str() const
+{
+    std::stringstream ss;
+    ss << ambient << " ambient, " << directional << " directional, " << point << " point, " << spot << " spot";
+    return ss.str();
+}
+
+SpecializedLighting::SpecializedLighting(vsg::Viewer* _viewer, vsg::ref_ptr<vsg::Node> scene, vsg::ref_ptr<vsg::Switch> _lightSwitch) :
+    viewer(_viewer), lightSwitch(_lightSwitch)
+{
+    //One shader module shared by every mix so the GLSL is only compiled to SPIR-V once
+    shaderModule = vsg::ShaderModule::create(specialized_phong_frag);
+
+    FindLitPipelines findLitPipelines;
+    scene->accept(findLitPipelines);
+
+    for (auto& found : findLitPipelines.found)
+    {
+        auto bindPipeline = found.stateGroup->stateCommands[found.index].cast<vsg::BindGraphicsPipeline>();
+        auto itr = std::find(original.begin(), original.end(), bindPipeline);
+        if (itr == original.end()) itr = original.insert(original.end(), bindPipeline);
+        slots.push_back(Slot{found.stateGroup, found.index, static_cast<size_t>(itr - original.begin())});
+    }
+
+    //The generic pipelines replace the Builder's before viewer->compile(), so they compile with the rest of the scene
+    generic = createPipelines(genericLimits);
+    for (auto& slot : slots)
+    {
+        slot.stateGroup->stateCommands[slot.index] = generic[slot.pipeline];
+    }
+
+    std::cout << "Specialized lighting: " << generic.size() << " lit pipelines in " << slots.size() << " state groups" << std::endl;
+
+    activeMode = "generic";
+}
+
+LightMix SpecializedLighting::currentMix() const
+{
+    CountLights countLights;
+    for (auto& child : lightSwitch->children)
+    {
+        if (child.mask != vsg::MASK_OFF) child.node->accept(countLights);
+    }
+    return countLights.mix;
+}
+
+void SpecializedLighting::toggleLight(size_t index)
+{
+    if (index >= lightSwitch->children.size()) return;
+
+    auto& child = lightSwitch->children[index];
+    child.mask = (child.mask == vsg::MASK_OFF) ? vsg::MASK_ALL : vsg::MASK_OFF;
+    select();
+}
+
+void SpecializedLighting::toggleSpecialized()
+{
+    specialized = !specialized;
+    select();
+}
+
+void SpecializedLighting::select()
+{
+    auto mix = currentMix();
+    auto itr = specialized ? cache.find(mix) : cache.end();
+
+    //Fall back to the generic pipelines until the specialized ones have compiled
+    bool useSpecialized = itr != cache.end();
+    for (auto& slot : slots)
+    {
+        slot.stateGroup->stateCommands[slot.index] = useSpecialized ? itr->second[slot.pipeline] : generic[slot.pipeline];
+    }
+
+    activeMode = useSpecialized ? "specialized (" + mix.str() + ")" : "generic";
+    std::cout << "Lighting: " << mix.str() << ", " << activeMode << " pipelines" << std::endl;
+
+    if (specialized && !useSpecialized) compile(mix);
+}
+
+void SpecializedLighting::compile(const LightMix& mix)
+{
+    //One mix at a time, compiled() starts the next one if the lights changed in the meantime
+    if (compiling) return;
+    compiling = true;
+
+    if (worker.joinable()) worker.join();
+
+    auto pipelines = createPipelines(mix);
+    auto commands = vsg::Commands::create();
+    for (auto& bindPipeline : pipelines) commands->addChild(bindPipeline);
+
+    //CompileManager can be used from any thread, the result is handed back through an update operation
+    vsg::ref_ptr<SpecializedLighting> self(this);
+    worker = std::thread([self, mix, pipelines, commands]() {
+        APP_ZONE("compile lighting", APP_COLOR_LOAD);
+
+        auto start = vsg::clock::now();
+        auto result = self->viewer->compileManager->compile(commands);
+        double milliseconds = std::chrono::duration<double, std::chrono::milliseconds::period>(vsg::clock::now() - start).count();
+
+        if (result) self->viewer->addUpdateOperation(MixCompiled::create(self, mix, pipelines, milliseconds));
+        else self->viewer->addUpdateOperation(MixCompiled::create(self, mix, std::vector<vsg::ref_ptr<vsg::BindGraphicsPipeline>>{}, milliseconds));
+    });
+}
+
+std::vector<vsg::ref_ptr<vsg::BindGraphicsPipeline>> SpecializedLighting::createPipelines(const LightMix& limits) const
+{
+    std::vector<vsg::ref_ptr<vsg::BindGraphicsPipeline>> pipelines;
+    for (auto& bindPipeline : original)
+    {
+        auto pipeline = bindPipeline->pipeline;
+
+        auto fragmentStage = vsg::ShaderStage::create(VK_SHADER_STAGE_FRAGMENT_BIT, "main", shaderModule);
+        fragmentStage->specializationConstants = vsg::ShaderStage::SpecializationConstants{
+            {0, vsg::intValue::create(static_cast<int32_t>(limits.ambient))},
+            {1, vsg::intValue::create(static_cast<int32_t>(limits.directional))},
+            {2, vsg::intValue::create(static_cast<int32_t>(limits.point))},
+            {3, vsg::intValue::create(static_cast<int32_t>(limits.spot))}};
+
+        //Only the fragment stage changes, the vertex stage, layout and pipeline states stay the Builder's
+        vsg::ShaderStages stages;
+        for (auto& stage : pipeline->stages)
+        {
+            stages.push_back(stage->stage == VK_SHADER_STAGE_FRAGMENT_BIT ? fragmentStage : stage);
+        }
+
+        pipelines.push_back(vsg::BindGraphicsPipeline::create(vsg::GraphicsPipeline::create(pipeline->layout, stages, pipeline->pipelineStates, pipeline->subpass)));
+    }
+    return pipelines;
+}
+
+void SpecializedLighting::compiled(const LightMix& mix, std::vector<vsg::ref_ptr<vsg::BindGraphicsPipeline>> pipelines, double milliseconds)
+{
+    compiling = false;
+
+    if (pipelines.empty())
+    {
+        std::cout << "Lighting: failed to compile pipelines for " << mix.str() << ", staying on the generic pipelines" << std::endl;
+        specialized = false;
+        return;
+    }
+
+    std::cout << "Lighting: compiled pipelines for " << mix.str() << " in " << milliseconds << " ms" << std::endl;
+    cache[mix] = pipelines;
+    compileTimes.push_back(milliseconds);
+
+    select();
+}
+
+void SpecializedLighting::endFrame(vsg::ref_ptr<GpuFrameTimer> gpuTimer)
+{
+    if (!gpuTimer) return;
+
+    uint64_t frame = gpuTimer->frameIndex;
+    frameModes[frame % GpuFrameTimer::numSlots] = activeMode;
+
+    //Same lag as FrameStats, the oldest slot in the ring has had time to complete
+    uint64_t lag = GpuFrameTimer::numSlots - 1;
+    if (frame < lag) return;
+
+    auto& mode = frameModes[(frame - lag) % GpuFrameTimer::numSlots];
+    double milliseconds;
+    if (!mode.empty() && gpuTimer->read(frame - lag, milliseconds))
+    {
+        auto& cost = costs[mode];
+        cost.sum += milliseconds;
+        ++cost.frames;
+    }
+}
+
+void SpecializedLighting::finish()
+{
+    if (worker.joinable()) worker.join();
+}
+
+void SpecializedLighting::report(std::ostream& out) const
+{
+    if (!compileTimes.empty())
+    {
+        double total = 0.0;
+        for (auto& milliseconds : compileTimes) total += milliseconds;
+        out << "Specialized lighting: " << compileTimes.size() << " light mixes compiled, " << total / static_cast<double>(compileTimes.size())
+            << " ms on average off the render thread" << std::endl;
+    }
+
+    if (costs.empty()) return;
+
+    out << "GPU frame time by lighting pipelines:" << std::endl;
+    for (auto& [mode, cost] : costs)
+    {
+        out << "    " << mode << ": " << cost.sum / static_cast<double>(cost.frames) << " ms over " << cost.frames << " frames" << std::endl;
+    }
+}
+
+void SpecializedLightingHandler::apply(vsg::KeyPressEvent& keyPress)
+{
+    if (keyPress.keyBase >= vsg::KEY_1 && keyPress.keyBase <= vsg::KEY_5)
+    {
+        lighting->toggleLight(static_cast<size_t>(keyPress.keyBase - vsg::KEY_1));
+        keyPress.handled = true;
+    }
+    else if (keyPress.keyBase == vsg::KEY_g)
+    {
+        lighting->toggleSpecialized();
+        keyPress.handled = true;
+    }
+}
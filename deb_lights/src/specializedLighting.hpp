@@ -0,0 +1,112 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frameStats.hpp"
+
+//Number of lights of each type in the scene, the key pipelines are specialized and cached on
+struct LightMix
+{
+    uint32_t ambient = 0;
+    uint32_t directional = 0;
+    uint32_t point = 0;
+    uint32_t spot = 0;
+
+    bool operator<(const LightMix& rhs) const
+    {
+        if (ambient != rhs.ambient) return ambient < rhs.ambient;
+        if (directional != rhs.directional) return directional < rhs.directional;
+        if (point != rhs.point) return point < rhs.point;
+        return spot < rhs.spot;
+    }
+
+    std::string str() const;
+};
+
+//Phong pipelines specialized for the exact mix of lights under a vsg::Switch
+//The light counts are specialization constants so the fragment shader only contains loops for the light types present.
+//Each mix is compiled once on a background thread through the viewer's CompileManager and cached, the generic
+//pipelines are used until it is ready. They are the same shader with limits no scene reaches, so comparing the two
+//measures the specialization alone
+class SpecializedLighting : public vsg::Inherit<vsg::Object, SpecializedLighting>
+{
+public:
+    //Collects the lit pipelines of scene, the lights are the children of lightSwitch
+    SpecializedLighting(vsg::Viewer* _viewer, vsg::ref_ptr<vsg::Node> scene, vsg::ref_ptr<vsg::Switch> _lightSwitch);
+
+    //Bind the pipelines for the current mix, compiling them in the background the first time it is seen
+    //Call once after viewer->compile()
+    void select();
+
+    //Switch a light on or off and move to the pipelines for the new mix
+    void toggleLight(size_t index);
+
+    //Swap between the specialized and the generic pipelines to compare their cost
+    void toggleSpecialized();
+
+    //Call after frameStats.endFrame(), attributes the GPU time of earlier frames to the pipelines they were drawn with
+    void endFrame(vsg::ref_ptr<GpuFrameTimer> gpuTimer);
+
+    //Wait for any pipelines still compiling, call before the viewer is destroyed
+    void finish();
+
+    void report(std::ostream& out) const;
+
+    //Called on the main thread from an update operation once a mix has compiled
+    void compiled(const LightMix& mix, std::vector<vsg::ref_ptr<vsg::BindGraphicsPipeline>> pipelines, double milliseconds);
+
+private:
+    struct Slot
+    {
+        vsg::ref_ptr<vsg::StateGroup> stateGroup;
+        size_t index;    //position of the BindGraphicsPipeline in stateCommands
+        size_t pipeline; //index into original, generic and the cached mixes
+    };
+
+    struct Cost
+    {
+        double sum = 0.0;
+        uint64_t frames = 0;
+    };
+
+    LightMix currentMix() const;
+    void compile(const LightMix& mix);
+
+    //The Builder's lit pipelines with the fragment stage swapped for the lighting shader specialized on limits
+    std::vector<vsg::ref_ptr<vsg::BindGraphicsPipeline>> createPipelines(const LightMix& limits) const;
+
+    vsg::Viewer* viewer;
+    vsg::ref_ptr<vsg::Switch> lightSwitch;
+    vsg::ref_ptr<vsg::ShaderModule> shaderModule;
+    std::vector<Slot> slots;
+    std::vector<vsg::ref_ptr<vsg::BindGraphicsPipeline>> original;
+    std::vector<vsg::ref_ptr<vsg::BindGraphicsPipeline>> generic;
+
+    bool specialized = true;
+    std::map<LightMix, std::vector<vsg::ref_ptr<vsg::BindGraphicsPipeline>>> cache;
+    bool compiling = false;
+    std::thread worker;
+    std::vector<double> compileTimes;
+
+    //Which pipelines are bound now and which were bound for the frames still in the GPU timer's ring
+    std::string activeMode;
+    std::string frameModes[GpuFrameTimer::numSlots];
+    std::map<std::string, Cost> costs;
+};
+
+//Keys 1-5 switch the ambient, directional, point, spot and head lights, g swaps between generic and specialized pipelines
+class SpecializedLightingHandler : public vsg::Inherit<vsg::Visitor, SpecializedLightingHandler>
+{
+public:
+    SpecializedLightingHandler(vsg::ref_ptr<SpecializedLighting> _lighting) : lighting(_lighting) {}
+
+    void apply(vsg::KeyPressEvent& keyPress) override;
+
+private:
+    vsg::ref_ptr<SpecializedLighting> lighting;
+};
@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "metricsBlock.hpp"
+
+//Prints the metrics published by an app started with --metrics <name>
+//usage: metrics <name> [--interval seconds] [--once]
+int main(int argc, char** argv)
+{
+    std::string name;
+    double interval = 1.0;
+    bool once = false;
+    bool badArgument = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--once") == 0) once = true;
+        else if (std::strcmp(argv[i], "--interval") == 0)
+        {
+            //A positive number of seconds
+            if (i + 1 == argc)
+            {
+                badArgument = true;
+                break;
+            }
+            const char* value = argv[++i];
+            char* end = nullptr;
+            interval = std::strtod(value, &end);
+            if (end == value || *end != '\0' || !std::isfinite(interval) || interval <= 0.0) badArgument = true;
+        }
+        else name = argv[i];
+    }
+
+    if (name.empty() || badArgument)
+    {
+        std::cout << "usage: " << argv[0] << " <name> [--interval seconds] [--once]" << std::endl;
+        return 1;
+    }
+
+    auto segmentName = metricsSegmentName(name);
+    int fd = shm_open(segmentName.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        std::cout << "No metrics published as " << segmentName << ", start an app with --metrics " << name << std::endl;
+        return 1;
+    }
+
+    void* ptr = mmap(nullptr, sizeof(MetricsSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        std::cout << "Unable to map " << segmentName << std::endl;
+        return 1;
+    }
+
+    auto& segment = *static_cast<const MetricsSegment*>(ptr);
+    if (segment.magic != METRICS_MAGIC || segment.version != METRICS_VERSION)
+    {
+        std::cout << segmentName << " is not a version " << METRICS_VERSION << " metrics segment" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(10) << "uptime" << std::setw(10) << "frames" << std::setw(10) << "fps" << std::setw(10) << "avg ms"
+              << std::setw(10) << "max ms" << std::setw(10) << "entities" << std::setw(10) << "draws" << std::setw(12) << "gpu MiB" << std::setw(12) << "alloc MiB"
+              << std::setw(12) << "steps/s" << std::endl;
+
+    double lastUptime = -1.0;
+    while (true)
+    {
+        MetricsData data;
+        if (!readMetrics(segment, data))
+        {
+            std::cout << "Unable to read a consistent sample" << std::endl;
+        }
+        else if (data.uptime == lastUptime)
+        {
+            //The app only publishes after a frame, so this is an idle on demand app or one that has stalled
+            std::cout << "no update from " << data.application << " (pid " << data.pid << ")" << std::endl;
+        }
+        else
+        {
+            lastUptime = data.uptime;
+            std::cout << std::setw(10) << data.uptime << std::setw(10) << data.frameCount << std::setw(10) << data.framesPerSecond
+                      << std::setw(10) << data.frameTimeAverage << std::setw(10) << data.frameTimeMax << std::setw(10) << data.entityCount
+                      << std::setw(10) << data.drawCount << std::setw(12) << static_cast<double>(data.gpuMemoryUsed) / (1024.0 * 1024.0)
+                      << std::setw(12) << static_cast<double>(data.gpuMemoryAllocated) / (1024.0 * 1024.0)
+                      << std::setw(12) << data.simulationStepsPerSecond << std::endl;
+        }
+
+        if (once) break;
+        std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+    }
+
+    munmap(ptr, sizeof(MetricsSegment));
+    return 0;
+}
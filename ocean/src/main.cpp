@@ -1,5 +1,4 @@
 #include <vsg/all.h>
-#include <vsgXchange/all.h>
 
 
 #include <iostream>
@@ -9,6 +8,17 @@
 #include <sstream>
 #include <tuple>
 
+#include "onDemandRendering.hpp"
+#include "shipScene.hpp"
+#include "frameStats.hpp"
+#include "appProfiler.hpp"
+#include "metricsPublisher.hpp"
+#include "renderStats.hpp"
+#include "sceneBenchmark.hpp"
+#include "flattenStatic.hpp"
+#include "assetRegistry.hpp"
+#include "releaseHostData.hpp"
+
 template <typename T>
 std::string demangle(T&&) {
     auto name = typeid(T).name();
@@ -32,65 +42,6 @@ ostream& operator<<(ostream& os, const vsg::GeometryInfo& gi)
     return os << ss.str();
 }
 
-vsg::ref_ptr<vsg::Node> createTextureQuad(vsg::ref_ptr<vsg::Data> sourceData, vsg::ref_ptr<vsg::Options> options)
-{
-    auto builder = vsg::Builder::create();
-    builder->options = options;
-
-    vsg::StateInfo state;
-    state.image = sourceData;
-    state.lighting = false;
-
-    vsg::GeometryInfo geom;
-    geom.dy.set(0.0f, 0.0f, 1.0f);
-    geom.dz.set(0.0f, -1.0f, 0.0f);
-
-    return builder->createQuad(geom, state);
-}
-
-vsg::ref_ptr<vsg::Node> loadObject(string filepath)
-{
-    vsg::Path vsgFilePath = filepath;
-    vsg::ref_ptr<vsg::Object> object;
-    auto options = vsg::Options::create();
-    
-    // add vsgXchange's support for reading and writing 3rd party file formats
-    options->add(vsgXchange::all::create());
-
-    if(vsgFilePath.find(".vsg") != std::string::npos)
-    {
-        object = vsg::read(vsgFilePath, options);
-        std::cout << "vsg" << std::endl;
-    }
-    else
-    {
-        object = vsg::read_cast<vsg::Node>(vsgFilePath, options);
-        std::cout << "novsg" << std::endl;
-    }
-
-    if (vsg::ref_ptr<vsg::Node> node = object.cast<vsg::Node>())
-    {
-        return node;
-    }
-    else if (auto data = object.cast<vsg::Data>())
-    {
-        if (vsg::ref_ptr<vsg::Node> textureGeometry = createTextureQuad(data, options))
-        {
-            return node;
-        }
-    }
-    else if (object)
-    {
-        std::cout << "Unable to view object of type " << object->className() << std::endl;
-    }
-    else
-    {
-        std::cout << "Unable to load file " << vsgFilePath << std::endl;
-    }
-    vsg::ref_ptr<vsg::Node> node;
-    return node;
-}
-
 std::tuple<vsg::ref_ptr<vsg::Node>, vsg::ref_ptr<vsg::MatrixTransform>, vsg::ref_ptr<vsg::MatrixTransform>> createShipScene(vsg::ref_ptr<vsg::Options> options)
 {
     auto builder = vsg::Builder::create();
@@ -140,11 +91,6 @@ int main(int argc, char** argv)
     options->paths = vsg::getEnvPaths("VSG_FILE_PATH");
     options->sharedObjects = vsg::SharedObjects::create();
 
-#ifdef vsgXchange_all
-    // add vsgXchange's support for reading and writing 3rd party file formats
-    options->add(vsgXchange::all::create());
-#endif
-
     // set up defaults and read command line arguments to override them
     vsg::CommandLine arguments(&argc, argv);
 
@@ -191,6 +137,29 @@ int main(int argc, char** argv)
     // }
 
     bool multiThreading = arguments.read("--mt");
+    bool onDemand = arguments.read("--on-demand");
+    // --flatten bakes the static transforms into the vertex data and merges draws that share state
+    bool flatten = arguments.read("--flatten");
+    // --atlas packs each model's small diffuse textures into one atlas so its materials can share a descriptor set
+    assetRegistry().read(arguments);
+    // the app's own reads use whichever readers the registry ended up with, created on demand or --all-readers
+    for (auto& readerWriter : assetRegistry().options->readerWriters) options->add(readerWriter);
+    // --release-host-data boat,plane,scene or all drops the host copies of static data once it is on the GPU
+    HostDataRelease hostDataRelease;
+    hostDataRelease.read(arguments);
+    FrameStatsOptions frameStatsOptions;
+    frameStatsOptions.read(arguments);
+    // --benchmark N draws N frames on a fixed simulated timeline and writes a JSON report
+    SceneBenchmark benchmark;
+    benchmark.read(arguments);
+    ProfilerOptions profilerOptions;
+    profilerOptions.read(arguments);
+
+    // create the profiler up front so loading shows up in it
+    auto instrumentation = profilerOptions.createInstrumentation();
+    MetricsPublisher metrics(readMetricsName(arguments), "ocean");
+    RenderStatsMonitor renderStats(arguments.read("--render-stats"));
+    benchmark.configure(renderStats);
     bool separateDevices = arguments.read({"--no-shared-window", "-n"});
     // bool useStagingBuffer = arguments.read({"--staging-buffer", "-s"});
 
@@ -207,6 +176,24 @@ int main(int argc, char** argv)
     auto shipPosition = std::get<1>(tup);
     auto planePosition = std::get<2>(tup);
 
+    if (assetRegistry().atlasTextures || renderStats.enabled) assetRegistry().report(std::cout);
+
+    if (flatten)
+    {
+        // the ship and plane transforms move every frame, everything else in the scene stays put
+        auto flattener = FlattenStaticTransforms::create();
+        flattener->keep(shipPosition);
+        flattener->keep(planePosition);
+        scene->accept(*flattener);
+        flattener->report(std::cout);
+    }
+
+    if (renderStats.enabled)
+    {
+        reportModelComplexity("boat", shipPosition, std::cout);
+        reportModelComplexity("plane", planePosition, std::cout);
+    }
+
     auto group = vsg::Group::create();
     group->addChild(scene);
 
@@ -296,11 +283,18 @@ int main(int argc, char** argv)
     // Add close handler to respond to the close window button and to pressing escape
     viewer->addEventHandler(vsg::CloseHandler::create(viewer));
 
+    // Only render when something changes if --on-demand is set
+    auto onDemandRendering = OnDemandRendering::create(onDemand && !benchmark.enabled());
+    viewer->addEventHandler(onDemandRendering);
+
     // Add trackball for controllable window
     auto main_trackball = vsg::Trackball::create(camera);
     main_trackball->addWindow(window);
     viewer->addEventHandler(main_trackball);
 
+    // camera script played by --benchmark, or recorded into when not benchmarking
+    benchmark.assign(viewer, camera, options);
+
     auto renderGraph = vsg::RenderGraph::create(window, view);
     auto pRenderGraph = vsg::RenderGraph::create(pWindow, pView);
 
@@ -312,49 +306,90 @@ int main(int argc, char** argv)
 
     viewer->assignRecordAndSubmitTaskAndPresentation({commandGraph, pCommandGraph});
 
+    if (instrumentation) viewer->assignInstrumentation(instrumentation);
+
     if (multiThreading)
     {
         viewer->setupThreading();
     }
 
+    // time every frame, plus the GPU work of the main window using timestamp queries
+    FrameStats frameStats(benchmark.historySize());
+    frameStats.budget = frameStatsOptions.budget;
+    if (frameStatsOptions.gpuTime)
+    {
+        frameStats.gpuTimer = GpuFrameTimer::create();
+        frameStats.gpuTimer->assign(commandGraph);
+    }
+
+    renderStats.assign(commandGraph, window, options);
+    renderStats.assign(pCommandGraph, pWindow, options);
+    metrics.scene = scene;
     viewer->compile();
+    hostDataRelease.release({{"boat", shipPosition}, {"plane", planePosition}, {"scene", scene}}, std::cout);
 
     auto startTime = vsg::clock::now();
     double numFramesCompleted = 0.0;
 
     
     // rendering main loop
-    while (viewer->advanceToNextFrame())
+    while (benchmark.running() && onDemandRendering->advanceToNextFrame(viewer, benchmark.simulationTime()))
     {
-        auto t = std::chrono::duration<double, std::chrono::seconds::period>(vsg::clock::now() - startTime).count();
-
-        shipPosition->matrix = vsg::rotate(vsg::radians(270.0f), 1.0f, 0.0f, 0.0f)
-        * vsg::scale(vsg::vec3(.2f, .2f, .2f))
-        * vsg::rotate((float)(-M_PI*t/10), 0.0f, 1.0f, 0.0f)
-        * vsg::translate((float)(-sin(t/10)*2000), 33.0f, (float)(cos(t/10)*2000));
-        
-        planePosition->matrix = vsg::rotate(vsg::radians(0.0f), 1.0f, 0.0f, 0.0f)
-        // * vsg::scale(vsg::vec3(.2f, .2f, .2f))
-        * vsg::translate((float)(-sin(t/10)*5000), (float)(cos(t/10)*5000), 2000.0f);
- 
-        sBounds = vsg::visit<vsg::ComputeBounds>(shipPosition).bounds;
-        sCentre = (sBounds.min + sBounds.max) * 0.5;
-
-        pBounds = vsg::visit<vsg::ComputeBounds>(planePosition).bounds;
-        pCentre = (pBounds.min + pBounds.max) * 0.5;
-
-        lookAt->center = pCentre;
-        lookAt->up = vsg::dvec3(0.0, 0.0, 1.0);
-
-        pLookAt->eye =  pCentre;
-        pLookAt->center =  sCentre;
-        pLookAt->up = vsg::dvec3(0.0, 0.0, 1.0);
+        frameStats.beginFrame();
+
+        auto t = benchmark.enabled() ? benchmark.simulationTime() : std::chrono::duration<double, std::chrono::seconds::period>(vsg::clock::now() - startTime).count();
+
+        {
+            APP_ZONE("entity update", APP_COLOR_UPDATE);
+            shipPosition->matrix = vsg::rotate(vsg::radians(270.0f), 1.0f, 0.0f, 0.0f)
+            * vsg::scale(vsg::vec3(.2f, .2f, .2f))
+            * vsg::rotate((float)(-M_PI*t/10), 0.0f, 1.0f, 0.0f)
+            * vsg::translate((float)(-sin(t/10)*2000), 33.0f, (float)(cos(t/10)*2000));
+
+            planePosition->matrix = vsg::rotate(vsg::radians(0.0f), 1.0f, 0.0f, 0.0f)
+            // * vsg::scale(vsg::vec3(.2f, .2f, .2f))
+            * vsg::translate((float)(-sin(t/10)*5000), (float)(cos(t/10)*5000), 2000.0f);
+        }
+
+        // the ship and plane are always moving so keep the on demand loop running
+        onDemandRendering->requestFrame();
+
+        {
+            APP_ZONE("bounds", APP_COLOR_BOUNDS);
+            sBounds = vsg::visit<vsg::ComputeBounds>(shipPosition).bounds;
+            sCentre = (sBounds.min + sBounds.max) * 0.5;
+
+            pBounds = vsg::visit<vsg::ComputeBounds>(planePosition).bounds;
+            pCentre = (pBounds.min + pBounds.max) * 0.5;
+        }
+
+        {
+            APP_ZONE("camera", APP_COLOR_CAMERA);
+            if (!benchmark.scripted())
+            {
+                lookAt->center = pCentre;
+                lookAt->up = vsg::dvec3(0.0, 0.0, 1.0);
+            }
+
+            pLookAt->eye =  pCentre;
+            pLookAt->center =  sCentre;
+            pLookAt->up = vsg::dvec3(0.0, 0.0, 1.0);
+        }
 
         // pass any events into EventHandlers assigned to the Viewer
         viewer->handleEvents();
         viewer->update();
+        frameStats.mark(FrameStats::UPDATE);
+        // the stats walk is left out of the timings, it is not part of drawing the frame
+        renderStats.collect();
+        frameStats.exclude();
         viewer->recordAndSubmit();
+        frameStats.mark(FrameStats::RECORD);
         viewer->present();
+        frameStats.mark(FrameStats::PRESENT);
+        frameStats.endFrame();
+        metrics.endFrame();
+        benchmark.endFrame();
 
         numFramesCompleted += 1.0;
     }
@@ -364,6 +399,15 @@ int main(int argc, char** argv)
     {
         std::cout << "Average frame rate = " << (numFramesCompleted / duration) << std::endl;
     }
+    onDemandRendering->report(std::cout);
+    frameStats.report(std::cout);
+    renderStats.report(std::cout);
+    benchmark.writeReport("ocean", frameStats, renderStats, std::cout);
+    if (!frameStatsOptions.csvFilename.empty() && !frameStats.writeCSV(frameStatsOptions.csvFilename))
+    {
+        std::cout << "Unable to write " << frameStatsOptions.csvFilename << std::endl;
+    }
+    reportProfiler(instrumentation, profilerOptions.traceFilename, std::cout);
 
     return 0;
 }
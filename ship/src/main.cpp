@@ -11,21 +11,13 @@
 #include <iostream>
 #include <thread>
 
-vsg::ref_ptr<vsg::Node> createTextureQuad(vsg::ref_ptr<vsg::Data> sourceData, vsg::ref_ptr<vsg::Options> options)
-{
-    auto builder = vsg::Builder::create();
-    builder->options = options;
-
-    vsg::StateInfo state;
-    state.image = sourceData;
-    state.lighting = false;
-
-    vsg::GeometryInfo geom;
-    geom.dy.set(0.0f, 0.0f, 1.0f);
-    geom.dz.set(0.0f, -1.0f, 0.0f);
-
-    return builder->createQuad(geom, state);
-}
+#include "onDemandRendering.hpp"
+#include "frameStats.hpp"
+#include "appProfiler.hpp"
+#include "metricsPublisher.hpp"
+#include "renderStats.hpp"
+#include "shipScene.hpp"
+#include "sceneBenchmark.hpp"
 
 void enableGenerateDebugInfo(vsg::ref_ptr<vsg::Options> options)
 {
@@ -100,6 +92,12 @@ int main(int argc, char** argv)
         if (arguments.read({"--no-frame", "--nf"})) windowTraits->decoration = false;
         if (arguments.read("--or")) windowTraits->overrideRedirect = true;
         auto maxTime = arguments.value(std::numeric_limits<double>::max(), "--max-time");
+        bool onDemand = arguments.read("--on-demand");
+        FrameStatsOptions frameStatsOptions;
+        frameStatsOptions.read(arguments);
+        // --benchmark N draws N frames on a fixed simulated timeline and writes a JSON report
+        SceneBenchmark benchmark;
+        benchmark.read(arguments);
 
         if (arguments.read("--d32")) windowTraits->depthFormat = VK_FORMAT_D32_SFLOAT;
         if (arguments.read("--sRGB")) windowTraits->swapchainPreferences.surfaceFormat = {VK_FORMAT_B8G8R8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
@@ -124,6 +122,10 @@ int main(int argc, char** argv)
 
         if (int log_level = 0; arguments.read("--log-level", log_level)) vsg::Logger::instance()->level = vsg::Logger::Level(log_level);
 
+        // a Chrome trace (--trace file.json) is written from the profiler so implies --profiler
+        std::string traceFilename;
+        arguments.read("--trace", traceFilename);
+
         vsg::ref_ptr<vsg::Instrumentation> instrumentation;
         if (arguments.read({"--gpu-annotation", "--ga"}) && vsg::isExtensionSupported(VK_EXT_DEBUG_UTILS_EXTENSION_NAME))
         {
@@ -139,7 +141,7 @@ int main(int argc, char** argv)
 
             instrumentation = gpu_instrumentation;
         }
-        else if (arguments.read({"--profiler", "--pr"}))
+        else if (arguments.read({"--profiler", "--pr"}) || !traceFilename.empty())
         {
             // set Profiler options
             auto settings = vsg::Profiler::Settings::create();
@@ -152,6 +154,14 @@ int main(int argc, char** argv)
             instrumentation = vsg::Profiler::create(settings);
         }
 
+        // app level zones report to the same instrumentation as the viewer
+        appInstrumentation() = instrumentation;
+
+        // live metrics for watching long runs from outside the process
+        MetricsPublisher metrics(readMetricsName(arguments), "ship");
+        RenderStatsMonitor renderStats(arguments.read("--render-stats"));
+        benchmark.configure(renderStats);
+
         // should animations be automatically played
         auto autoPlay = !arguments.read({"--no-auto-play", "--nop"});
 
@@ -173,6 +183,8 @@ int main(int argc, char** argv)
         // read any files
         for (int i = 0; i < filepaths.size(); ++i)
         {
+            APP_ZONE("load model", APP_COLOR_LOAD);
+
             // vsg::Path filename = arguments[i];
             vsg::Path filename = filepaths[i];
             path = vsg::filePath(filename);
@@ -191,6 +203,7 @@ int main(int argc, char** argv)
 
             if (auto node = object.cast<vsg::Node>())
             {
+                if (renderStats.enabled) reportModelComplexity(filename, node, std::cout);
                 group->addChild(node);
             }
             else if (auto data = object.cast<vsg::Data>())
@@ -266,6 +279,8 @@ int main(int argc, char** argv)
         // add close handler to respond to the close window button and pressing escape
         viewer->addEventHandler(vsg::CloseHandler::create(viewer));
 
+        // a benchmark script takes the place of -p, the animation follows the viewer's simulation time either way
+        if (!benchmark.scriptFilename.empty()) pathFilename = benchmark.scriptFilename;
         auto cameraAnimation = vsg::CameraAnimation::create(camera, pathFilename, options);
         viewer->addEventHandler(cameraAnimation);
         if (autoPlay && cameraAnimation->animation)
@@ -276,6 +291,10 @@ int main(int argc, char** argv)
 
         viewer->addEventHandler(vsg::Trackball::create(camera, ellipsoidModel));
 
+        // only render when something changes if --on-demand is set
+        auto onDemandRendering = OnDemandRendering::create(onDemand && !benchmark.enabled());
+        viewer->addEventHandler(onDemandRendering);
+
         // if required preload specific number of PagedLOD levels.
         if (loadLevels > 0)
         {
@@ -294,6 +313,17 @@ int main(int argc, char** argv)
 
         if (instrumentation) viewer->assignInstrumentation(instrumentation);
 
+        // time every frame, plus the GPU work of the main window using timestamp queries
+        FrameStats frameStats(benchmark.historySize());
+        frameStats.budget = frameStatsOptions.budget;
+        if (frameStatsOptions.gpuTime)
+        {
+            frameStats.gpuTimer = GpuFrameTimer::create();
+            frameStats.gpuTimer->assign(commandGraph);
+        }
+
+        renderStats.assign(commandGraph, window, options);
+        metrics.scene = vsg_scene;
         viewer->compile();
 
         if (maxPagedLOD > 0)
@@ -318,16 +348,33 @@ int main(int argc, char** argv)
         viewer->start_point() = vsg::clock::now();
 
         // rendering main loop
-        while (viewer->advanceToNextFrame() && (numFrames < 0 || (numFrames--) > 0) && (viewer->getFrameStamp()->simulationTime < maxTime))
+        while (benchmark.running() && onDemandRendering->advanceToNextFrame(viewer, benchmark.simulationTime()) && (numFrames < 0 || (numFrames--) > 0) && (viewer->getFrameStamp()->simulationTime < maxTime))
         {
+            frameStats.beginFrame();
+
             // pass any events into EventHandlers assigned to the Viewer
             viewer->handleEvents();
 
+            // keep rendering while a camera path or any scene animations are playing
+            if ((cameraAnimation->animation && cameraAnimation->animation->active()) || !viewer->animationManager->animations.empty())
+            {
+                onDemandRendering->requestFrame();
+            }
+
             viewer->update();
+            frameStats.mark(FrameStats::UPDATE);
+            // the stats walk is left out of the timings, it is not part of drawing the frame
+            renderStats.collect();
+            frameStats.exclude();
 
             viewer->recordAndSubmit();
+            frameStats.mark(FrameStats::RECORD);
 
             viewer->present();
+            frameStats.mark(FrameStats::PRESENT);
+            frameStats.endFrame();
+            metrics.endFrame();
+            benchmark.endFrame();
         }
 
         if (reportAverageFrameRate)
@@ -336,12 +383,16 @@ int main(int argc, char** argv)
             double fps = static_cast<double>(fs->frameCount) / std::chrono::duration<double, std::chrono::seconds::period>(vsg::clock::now() - viewer->start_point()).count();
             std::cout << "Average frame rate = " << fps << " fps" << std::endl;
         }
-
-        if (auto profiler = instrumentation.cast<vsg::Profiler>())
+        onDemandRendering->report(std::cout);
+        frameStats.report(std::cout);
+        renderStats.report(std::cout);
+        benchmark.writeReport("ship", frameStats, renderStats, std::cout);
+        if (!frameStatsOptions.csvFilename.empty() && !frameStats.writeCSV(frameStatsOptions.csvFilename))
         {
-            instrumentation->finish();
-            profiler->log->report(std::cout);
+            std::cout << "Unable to write " << frameStatsOptions.csvFilename << std::endl;
         }
+
+        reportProfiler(instrumentation, traceFilename, std::cout);
     }
     catch (const vsg::Exception& ve)
     {
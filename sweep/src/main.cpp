@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "sweep.hpp"
+#include "workerPool.hpp"
+
+//Runs every simulation of a pMath parameter sweep headless on all cores and writes the results as columns
+//usage: pendulumSweep <spec> [-o file] [--threads n]
+int main(int argc, char** argv)
+{
+    std::string specFilename;
+    std::string outputFilename = "sweep.bin";
+    unsigned int numThreads = 0;
+    bool badArgument = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) outputFilename = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0)
+        {
+            //A whole number up to 4096, 0 for one thread per core
+            if (i + 1 == argc)
+            {
+                badArgument = true;
+                break;
+            }
+            const char* value = argv[++i];
+            char* end = nullptr;
+            unsigned long threads = std::strtoul(value, &end, 10);
+            if (end == value || *end != '\0' || value[0] == '-' || threads > 4096) badArgument = true;
+            else numThreads = static_cast<unsigned int>(threads);
+        }
+        else specFilename = argv[i];
+    }
+
+    if (specFilename.empty() || badArgument)
+    {
+        std::cout << "usage: " << argv[0] << " <spec> [-o file] [--threads n]" << std::endl;
+        return 1;
+    }
+
+    SweepSpec spec;
+    if (!spec.read(specFilename, std::cout)) return 1;
+
+    SweepResults results(spec);
+    WorkerPool pool(numThreads);
+
+    std::cout << "Sweeping " << spec.size() << " runs of " << spec.duration << " s in " << spec.stepsPerRun() << " steps on " << pool.size()
+              << " threads, " << static_cast<double>(results.bytes()) / (1024.0 * 1024.0) << " MiB of results" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    pool.run(static_cast<size_t>(spec.size()), [&](size_t i) { results.run(i); });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double runsPerSecond = static_cast<double>(spec.size()) / seconds;
+    std::cout << "Simulated " << spec.size() << " runs in " << seconds << " s, " << runsPerSecond << " runs/s, " << runsPerSecond / pool.size()
+              << " runs/s per core, " << runsPerSecond * static_cast<double>(spec.stepsPerRun()) / pool.size() << " steps/s per core" << std::endl;
+
+    if (!results.write(outputFilename))
+    {
+        std::cout << "Unable to write " << outputFilename << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << outputFilename << std::endl;
+    return 0;
+}
@@ -0,0 +1,268 @@
+#include "sweep.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "pendulumKernel.hpp"
+
+namespace
+{
+    const double pi = 3.14159265358979323846;
+
+    //Order of the parameters and of their columns in the output
+    const char* parameterNames[] = {"theta1", "theta2", "gravity", "len1", "len2", "mass1", "mass2"};
+
+    //Recorded in the file header, runs are integrated with pendulum::rk4 as the flip fractal is
+    const char* integratorName = "coupledRK4";
+
+    //Total mechanical energy, the same expression as pMath::energy
+    double energy(const PendulumConstants& c, double t1, double w1, double t2, double w2)
+    {
+        double M = c.mass1 + c.mass2;
+        double kinetic = 0.5 * M * c.len1 * c.len1 * w1 * w1 + 0.5 * c.mass2 * c.len2 * c.len2 * w2 * w2 + c.mass2 * c.len1 * c.len2 * w1 * w2 * std::cos(t1 - t2);
+        double potential = -M * c.gravity * c.len1 * std::cos(t1) - c.mass2 * c.gravity * c.len2 * std::cos(t2);
+        return kinetic + potential;
+    }
+}
+
+SweepSpec::SweepSpec()
+{
+    PendulumConstants defaults;
+    double values[] = {3.1415, 3.1415, defaults.gravity, defaults.len1, defaults.len2, defaults.mass1, defaults.mass2};
+    for (size_t i = 0; i < 7; ++i)
+    {
+        SweepRange range;
+        range.name = parameterNames[i];
+        range.first = range.last = values[i];
+        parameters.push_back(range);
+    }
+}
+
+bool SweepSpec::read(const std::string& filename, std::ostream& errors)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        errors << "Unable to open " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber)
+    {
+        auto comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        std::istringstream fields(line);
+        std::string name;
+        if (!(fields >> name)) continue;
+
+        std::vector<double> values;
+        double value;
+        while (fields >> value) values.push_back(value);
+        if (!fields.eof() || values.empty())
+        {
+            errors << filename << ":" << lineNumber << ": expected numbers after " << name << std::endl;
+            return false;
+        }
+
+        if (name == "duration" || name == "step" || name == "sample")
+        {
+            if (values.size() != 1 || values[0] < 0.0 || (name != "sample" && values[0] <= 0.0))
+            {
+                errors << filename << ":" << lineNumber << ": " << name << " takes one positive number of seconds" << std::endl;
+                return false;
+            }
+            if (name == "duration") duration = values[0];
+            else if (name == "step") step = values[0];
+            else sample = values[0];
+            continue;
+        }
+
+        auto range = std::find_if(parameters.begin(), parameters.end(), [&](const SweepRange& r) { return r.name == name; });
+        if (range == parameters.end())
+        {
+            errors << filename << ":" << lineNumber << ": unknown parameter " << name << std::endl;
+            return false;
+        }
+
+        if (values.size() == 1)
+        {
+            range->first = range->last = values[0];
+            range->count = 1;
+        }
+        else if (values.size() == 3 && values[2] >= 1.0 && values[2] == std::floor(values[2]))
+        {
+            range->first = values[0];
+            range->last = values[1];
+            range->count = static_cast<uint32_t>(values[2]);
+        }
+        else
+        {
+            errors << filename << ":" << lineNumber << ": " << name << " takes a value or first last count" << std::endl;
+            return false;
+        }
+    }
+
+    if (sample > duration)
+    {
+        errors << filename << ": sample is longer than the duration" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+uint64_t SweepSpec::size() const
+{
+    uint64_t n = 1;
+    for (auto& range : parameters) n *= range.count;
+    return n;
+}
+
+uint64_t SweepSpec::stepsPerRun() const
+{
+    return static_cast<uint64_t>(std::llround(duration / step));
+}
+
+uint32_t SweepSpec::samplesPerRun() const
+{
+    if (sample <= 0.0) return 0;
+    return static_cast<uint32_t>(stepsPerRun() / std::max<uint64_t>(std::llround(sample / step), 1)) + 1;
+}
+
+void SweepSpec::at(uint64_t index, double& theta1, double& theta2, PendulumConstants& constants) const
+{
+    double values[7];
+    for (size_t i = parameters.size(); i-- > 0;)
+    {
+        values[i] = parameters[i].value(static_cast<uint32_t>(index % parameters[i].count));
+        index /= parameters[i].count;
+    }
+
+    theta1 = values[0];
+    theta2 = values[1];
+    constants.gravity = values[2];
+    constants.len1 = values[3];
+    constants.len2 = values[4];
+    constants.mass1 = values[5];
+    constants.mass2 = values[6];
+}
+
+SweepResults::SweepResults(const SweepSpec& _spec) :
+    spec(_spec),
+    numSamples(_spec.samplesPerRun())
+{
+    size_t rows = static_cast<size_t>(spec.size());
+    parameters.assign(spec.parameters.size(), std::vector<double>(rows));
+    flipTime.resize(rows);
+    energyDrift.resize(rows);
+    for (auto series : {&theta1, &omega1, &theta2, &omega2}) series->resize(rows * numSamples);
+
+    for (size_t i = 0; i < parameters.size(); ++i) columns.push_back(Column{spec.parameters[i].name, ColumnType::Float64, 1, &parameters[i], nullptr});
+    columns.push_back(Column{"flipTime", ColumnType::Float32, 1, nullptr, &flipTime});
+    columns.push_back(Column{"energyDrift", ColumnType::Float32, 1, nullptr, &energyDrift});
+    if (numSamples > 0)
+    {
+        columns.push_back(Column{"theta1Series", ColumnType::Float32, numSamples, nullptr, &theta1});
+        columns.push_back(Column{"omega1Series", ColumnType::Float32, numSamples, nullptr, &omega1});
+        columns.push_back(Column{"theta2Series", ColumnType::Float32, numSamples, nullptr, &theta2});
+        columns.push_back(Column{"omega2Series", ColumnType::Float32, numSamples, nullptr, &omega2});
+    }
+}
+
+void SweepResults::run(uint64_t index)
+{
+    double startTheta1, startTheta2;
+    PendulumConstants constants;
+    spec.at(index, startTheta1, startTheta2, constants);
+
+    size_t row = static_cast<size_t>(index);
+    parameters[0][row] = startTheta1;
+    parameters[1][row] = startTheta2;
+    parameters[2][row] = constants.gravity;
+    parameters[3][row] = constants.len1;
+    parameters[4][row] = constants.len2;
+    parameters[5][row] = constants.mass1;
+    parameters[6][row] = constants.mass2;
+
+    //The coupled RK4 of the fractal and ensemble, every stage sees all four updated variables so the energy holds
+    pendulum::Coefficients<simd::Scalar> k(constants);
+    auto h = simd::Scalar::set(spec.step);
+    auto t1 = simd::Scalar::set(startTheta1), w1 = simd::Scalar::set(0.0), t2 = simd::Scalar::set(startTheta2), w2 = simd::Scalar::set(0.0);
+    double initialEnergy = energy(constants, t1.v, w1.v, t2.v, w2.v);
+
+    uint64_t steps = spec.stepsPerRun();
+    uint64_t sampleSteps = spec.sample > 0.0 ? std::max<uint64_t>(std::llround(spec.sample / spec.step), 1) : 0;
+    size_t sampleBase = row * numSamples;
+    uint32_t sample = 0;
+    auto store = [&]() {
+        theta1[sampleBase + sample] = static_cast<float>(t1.v);
+        omega1[sampleBase + sample] = static_cast<float>(w1.v);
+        theta2[sampleBase + sample] = static_cast<float>(t2.v);
+        omega2[sampleBase + sample] = static_cast<float>(w2.v);
+        ++sample;
+    };
+
+    if (numSamples > 0) store();
+
+    float flipped = -1.0f;
+    for (uint64_t s = 1; s <= steps; ++s)
+    {
+        pendulum::rk4(k, h, 1, t1, w1, t2, w2);
+        if (flipped < 0.0f && (std::abs(t1.v) > pi || std::abs(t2.v) > pi)) flipped = static_cast<float>(s * spec.step);
+        if (sampleSteps > 0 && s % sampleSteps == 0 && sample < numSamples) store();
+    }
+
+    flipTime[row] = flipped;
+    energyDrift[row] = static_cast<float>(energy(constants, t1.v, w1.v, t2.v, w2.v) - initialEnergy);
+}
+
+uint64_t SweepResults::bytes() const
+{
+    uint64_t total = 0;
+    for (auto& column : columns) total += column.f64 ? column.f64->size() * sizeof(double) : column.f32->size() * sizeof(float);
+    return total;
+}
+
+bool SweepResults::write(const std::string& filename) const
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    SweepFileHeader header;
+    header.numColumns = static_cast<uint32_t>(columns.size());
+    header.numRows = spec.size();
+    header.duration = spec.duration;
+    header.step = spec.step;
+    header.sample = spec.sample;
+    std::strncpy(header.integrator, integratorName, sizeof(header.integrator) - 1);
+
+    uint64_t offset = sizeof(SweepFileHeader) + columns.size() * sizeof(SweepColumn);
+    std::vector<SweepColumn> directory(columns.size());
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        std::strncpy(directory[i].name, columns[i].name.c_str(), sizeof(directory[i].name) - 1);
+        directory[i].type = static_cast<uint32_t>(columns[i].type);
+        directory[i].valuesPerRow = columns[i].valuesPerRow;
+        directory[i].offset = offset;
+
+        uint64_t size = columns[i].f64 ? columns[i].f64->size() * sizeof(double) : columns[i].f32->size() * sizeof(float);
+        offset = (offset + size + 7) & ~uint64_t(7);
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(directory.data()), static_cast<std::streamsize>(directory.size() * sizeof(SweepColumn)));
+
+    const char padding[8] = {};
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        auto data = columns[i].f64 ? reinterpret_cast<const char*>(columns[i].f64->data()) : reinterpret_cast<const char*>(columns[i].f32->data());
+        uint64_t size = columns[i].f64 ? columns[i].f64->size() * sizeof(double) : columns[i].f32->size() * sizeof(float);
+        file.write(data, static_cast<std::streamsize>(size));
+        file.write(padding, static_cast<std::streamsize>(((size + 7) & ~uint64_t(7)) - size));
+    }
+    return static_cast<bool>(file);
+}
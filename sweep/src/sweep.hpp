@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "pData.hpp"
+
+//Values one parameter takes in a sweep, count evenly spaced from first to last inclusive
+struct SweepRange
+{
+    std::string name;
+    double first = 0.0;
+    double last = 0.0;
+    uint32_t count = 1;
+
+    double value(uint32_t i) const { return count > 1 ? first + (last - first) * i / (count - 1) : first; }
+};
+
+//Every combination of the parameter ranges is one simulation, released from rest at (theta1, theta2)
+//The specification is a text file of lines "name first [last count]", # starts a comment:
+//  theta1, theta2                      starting angles in radians (default 3.1415, 3.1415)
+//  gravity, len1, len2, mass1, mass2   constants of the pendulum (default those of pMath)
+//  duration seconds                    simulated time of each run (default 10)
+//  step seconds                        coupled RK4 step (default 0.001)
+//  sample seconds                      interval of the saved time series, 0 saves none (default 0.05)
+struct SweepSpec
+{
+    std::vector<SweepRange> parameters;
+    double duration = 10.0;
+    double step = 0.001;
+    double sample = 0.05;
+
+    SweepSpec();
+
+    //Reads a specification over the defaults, describes the first problem found to errors and returns false on failure
+    bool read(const std::string& filename, std::ostream& errors);
+
+    uint64_t size() const;
+    uint64_t stepsPerRun() const;
+
+    //Saved samples per run, the starting state and then one every sample seconds
+    uint32_t samplesPerRun() const;
+
+    //Parameters of simulation index, the last parameter varies fastest
+    void at(uint64_t index, double& theta1, double& theta2, PendulumConstants& constants) const;
+};
+
+//File layout: this header, numColumns SweepColumns, then each column's values for every run contiguously at its offset
+//Parameter columns are doubles, result columns floats, a column of the time series holds valuesPerRow samples per run
+struct SweepFileHeader
+{
+    char magic[8] = {'P', 'E', 'N', 'S', 'W', 'E', 'E', 'P'};
+    uint32_t version = 2;
+    uint32_t numColumns = 0;
+    uint64_t numRows = 0;
+    double duration = 0.0;
+    double step = 0.0;
+    double sample = 0.0;
+    //Name of the integrator the runs used, version 1 files came from pMath's per variable RK4
+    char integrator[16] = {};
+};
+
+enum class ColumnType : uint32_t
+{
+    Float64 = 1,
+    Float32 = 2
+};
+
+struct SweepColumn
+{
+    char name[24] = {};
+    uint32_t type = 0;
+    uint32_t valuesPerRow = 1;
+    //Bytes from the start of the file, 8 byte aligned
+    uint64_t offset = 0;
+};
+
+//Columns of a sweep held in memory while it runs, each run writes only its own rows so threads never share a value
+class SweepResults
+{
+public:
+    SweepResults(const SweepSpec& spec);
+
+    //Simulate run index and store its parameters and results
+    void run(uint64_t index);
+
+    bool write(const std::string& filename) const;
+
+    uint64_t bytes() const;
+
+private:
+    struct Column
+    {
+        std::string name;
+        ColumnType type;
+        uint32_t valuesPerRow;
+        std::vector<double>* f64 = nullptr;
+        std::vector<float>* f32 = nullptr;
+    };
+
+    const SweepSpec& spec;
+    uint32_t numSamples;
+
+    std::vector<std::vector<double>> parameters;
+    //Seconds to the first time either link passes over the top, -1 if it does not within the duration
+    std::vector<float> flipTime;
+    //Energy change over the run in joules, a check on the step size
+    std::vector<float> energyDrift;
+    //Time series columns (theta1Series ...), numSamples per run
+    std::vector<float> theta1, omega1, theta2, omega2;
+
+    std::vector<Column> columns;
+};
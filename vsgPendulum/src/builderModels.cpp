@@ -59,6 +59,70 @@ void PModel::updatePendulum(PData pData)
         * vsg::rotate(pData.t2, 1.0f, 0.0f, 0.0f);
 }
 
+vsg::vec3 PModel::endPosition(PData pData) const
+{
+    //The second link hangs from the end of the first, offset along x like its model
+    return vsg::vec3(7.5f, 200.0f*sin(pData.t) + 200.0f*sin(pData.t2), -200.0f*cos(pData.t) - 200.0f*cos(pData.t2));
+}
+
+CModel::CModel(vsg::ref_ptr<vsg::Builder> _builder, uint32_t numLinks, float totalLength, LinkFactory factory) :
+    builder(_builder),
+    linkLength(totalLength / std::max(numLinks, 1u))
+{
+    if (!factory) factory = [this](uint32_t index, float length) { return createLink(index, length); };
+
+    chain = vsg::MatrixTransform::create();
+    vsg::ref_ptr<vsg::MatrixTransform> parent = chain;
+    for (uint32_t i = 0; i < std::max(numLinks, 1u); ++i)
+    {
+        auto joint = vsg::MatrixTransform::create();
+        //Every joint after the first sits at the end of its parent link
+        if (i > 0) joint->matrix = vsg::translate(0.0f, 0.0f, -linkLength);
+        joint->addChild(factory(i, linkLength));
+        parent->addChild(joint);
+        joints.push_back(joint);
+        parent = joint;
+    }
+
+    std::cout << "CModel Generated, " << joints.size() << " links" << std::endl;
+}
+
+vsg::ref_ptr<vsg::Node> CModel::createLink(uint32_t index, float length)
+{
+    //Same proportions as a PModel link, but kept thick enough to see when there are hundreds of them
+    float width = std::max(std::min(length * 0.25f, 50.0f), 4.0f);
+    float depth = width * 0.3f;
+
+    auto link = vsg::MatrixTransform::create();
+    vsg::GeometryInfo geomInfo;
+    vsg::StateInfo stateInfo;
+
+    geomInfo.dx = {width, 0.0f, 0.0f};
+    geomInfo.dy = {0.0f, width, 0.0f};
+    geomInfo.dz = {0.0f, 0.0f, depth};
+    link->addChild(builder->createCylinder(geomInfo, stateInfo));
+
+    geomInfo.dx = {length, 0.0f, 0.0f};
+    geomInfo.transform = vsg::translate(length * 0.5f, 0.0f, 0.0f);
+    link->addChild(builder->createBox(geomInfo, stateInfo));
+
+    //Alternate sides like the two PModel links so neighbours do not overlap at the joints
+    float side = (index % 2 == 0) ? -depth * 0.5f : depth * 0.5f;
+    link->matrix = vsg::translate(side, 0.0f, 0.0f)
+        * vsg::rotate(vsg::radians(90.0f), 0.0f, 1.0f, 0.0f);
+    return link;
+}
+
+void CModel::updateChain(const std::vector<float>& angles)
+{
+    size_t count = std::min(angles.size(), joints.size());
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i > 0) joints[i]->matrix = vsg::translate(0.0f, 0.0f, -linkLength) * vsg::rotate(angles[i], 1.0f, 0.0f, 0.0f);
+        else joints[i]->matrix = vsg::rotate(angles[i], 1.0f, 0.0f, 0.0f);
+    }
+}
+
 AModel::AModel(vsg::ref_ptr<vsg::Builder> _builder) : builder(_builder)
 {
     float scale = 200.0f;
@@ -1,7 +1,10 @@
 #pragma once
 #include <vsg/all.h>
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <functional>
+#include <vector>
 
 #include "pData.hpp"
 
@@ -13,6 +16,12 @@ public:
     PModel(vsg::ref_ptr<vsg::Builder> _builder);
     void updatePendulum(PData pData);
 
+    //Where the end of the second link is for a state, in the pendulum's coordinates
+    vsg::vec3 endPosition(PData pData) const;
+
+    //Transforms updatePendulum() writes, the rest of the model can be flattened
+    std::vector<vsg::ref_ptr<vsg::Node>> dynamicTransforms() const { return {link1, link2}; }
+
 private:
     vsg::ref_ptr<vsg::Builder> builder;
     vsg::ref_ptr<vsg::MatrixTransform> link1;
@@ -22,6 +31,31 @@ private:
     vsg::ref_ptr<vsg::MatrixTransform> createLink();
 };
 
+//Chain of links hanging from the origin, each joint a MatrixTransform nested inside the one before it
+//so a link inherits its parent's placement and updateChain() only has to write the relative joint angles
+class CModel
+{
+public:
+    //Creates the node drawn for one link, index counts from the anchor, the link hangs length units down -z from its joint
+    using LinkFactory = std::function<vsg::ref_ptr<vsg::Node>(uint32_t index, float length)>;
+
+    vsg::ref_ptr<vsg::MatrixTransform> chain;
+
+    //Without a factory every link is a scaled down PModel link, identical ones shared through the builder
+    CModel(vsg::ref_ptr<vsg::Builder> _builder, uint32_t numLinks, float totalLength = 400.0f, LinkFactory factory = {});
+    void updateChain(const std::vector<float>& angles);
+
+    //Transforms updateChain() writes, the links below them can be flattened
+    std::vector<vsg::ref_ptr<vsg::Node>> dynamicTransforms() const { return {joints.begin(), joints.end()}; }
+
+private:
+    vsg::ref_ptr<vsg::Builder> builder;
+    std::vector<vsg::ref_ptr<vsg::MatrixTransform>> joints;
+    float linkLength;
+
+    vsg::ref_ptr<vsg::Node> createLink(uint32_t index, float length);
+};
+
 class AModel
 {
 public:
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+//Planar chain of numLinks pendulum links joined by revolute joints about the x axis
+//Each link is a massless rod with a point mass at its end, so two links of 1m and 1kg are the pMath double pendulum
+//Joint angles are relative to the parent link, the first is measured from hanging straight down
+//Accelerations come from Featherstone's articulated body algorithm in planar spatial algebra, O(n) per evaluation
+class ChainMath {
+public:
+    //The chain is totalLength long and weighs totalMass, split evenly between the links
+    ChainMath(uint32_t numLinks, double initialAngle, double totalLength = 2.0, double totalMass = 2.0);
+
+    uint32_t size() const { return static_cast<uint32_t>(links.size()); }
+
+    //Length of each link in metres
+    double linkLength() const { return links.empty() ? 0.0 : links[0].length; }
+
+    //Relative joint angles and their rates
+    const std::vector<double>& angles() const { return q; }
+    const std::vector<double>& rates() const { return qd; }
+
+    //Largest step that keeps RK4 stable and the energy drift small, shorter links swing faster so it shrinks with numLinks
+    static double stableStep(uint32_t numLinks);
+
+    //Step used by advance(), stableStep() unless overridden
+    double maxStep;
+
+    //One RK4 step of h seconds of the whole chain
+    void step(double h);
+
+    //Advance by seconds in the fewest equal steps no longer than maxStep, returns how many were taken
+    int advance(double seconds);
+
+    //Joint accelerations for the given angles and rates, the articulated body algorithm
+    void accelerations(const std::vector<double>& angles, const std::vector<double>& rates, std::vector<double>& result);
+
+    //Total mechanical energy of the current state
+    double energy() const;
+
+    //Steps taken, their cost and the energy drift since construction
+    void report(std::ostream& out) const;
+
+    //Time chains of each size in sizes for about seconds each at their stableStep() and print steps/s against links
+    static void benchmark(const std::vector<uint32_t>& sizes, double seconds, std::ostream& out);
+
+    const double gravity = 9.8;
+
+private:
+    using Vec3 = std::array<double, 3>;
+    using Mat3 = std::array<double, 9>;
+
+    struct Link
+    {
+        double length;
+        double mass;
+        double parentOffset; //distance down the parent link to this joint, 0 for the first
+    };
+
+    //Per link scratch space of the three passes, reused every evaluation
+    struct Work
+    {
+        double c, s;   //cos and sin of the joint angle
+        Vec3 v;        //spatial velocity
+        Vec3 bias;     //velocity product acceleration
+        Mat3 inertia;  //articulated inertia
+        Vec3 force;    //articulated bias force
+        Vec3 U;
+        double D;
+        double u;
+        Vec3 a;        //spatial acceleration
+    };
+
+    std::vector<Link> links;
+    std::vector<Work> work;
+    std::vector<double> q, qd;
+
+    //Counters for report()
+    uint64_t steps = 0;
+    double stepSeconds = 0.0;
+    double simulatedSeconds = 0.0;
+    double initialEnergy;
+
+    //RK4 stage storage
+    std::vector<double> qs, qds, k1q, k1qd, k2q, k2qd, k3q, k3qd, k4q, k4qd;
+};
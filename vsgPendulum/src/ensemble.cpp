@@ -0,0 +1,132 @@
+#include "ensemble.hpp"
+
+#include "pendulumKernel.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    //Step pendulums [begin, end) with V wide vectors then colour their pixels, returns where the full vectors stopped
+    template <class V>
+    size_t stepRange(const PendulumConstants& constants, double h, int substeps, double* theta1, double* omega1, double* theta2, double* omega2,
+                     vsg::ubvec4* pixels, size_t begin, size_t end)
+    {
+        pendulum::Coefficients<V> k(constants);
+        V vh = V::set(h);
+        V half = V::set(0.5);
+        V scale = V::set(255.0);
+
+        size_t i = begin;
+        for (; i + V::width <= end; i += V::width)
+        {
+            V t1 = V::load(theta1 + i), w1 = V::load(omega1 + i), t2 = V::load(theta2 + i), w2 = V::load(omega2 + i);
+            pendulum::rk4(k, vh, substeps, t1, w1, t2, w2);
+            t1.store(theta1 + i);
+            w1.store(omega1 + i);
+            t2.store(theta2 + i);
+            w2.store(omega2 + i);
+
+            //Hue from the two angles, pendulums that have flipped stand out from their neighbours
+            V s1, c1, s2, c2;
+            simd::sincos(t1, s1, c1);
+            simd::sincos(t2, s2, c2);
+            double r[V::width], g[V::width], b[V::width];
+            (scale * fma(half, s1, half)).store(r);
+            (scale * fma(half, s2, half)).store(g);
+            (scale * fma(half, c1 * c2, half)).store(b);
+            for (int l = 0; l < V::width; ++l)
+            {
+                pixels[i + l].set(static_cast<uint8_t>(r[l]), static_cast<uint8_t>(g[l]), static_cast<uint8_t>(b[l]), 255);
+            }
+        }
+        return i;
+    }
+
+    template <class V>
+    void stepBlock(const PendulumConstants& constants, double h, int substeps, double* theta1, double* omega1, double* theta2, double* omega2,
+                   vsg::ubvec4* pixels, size_t begin, size_t end)
+    {
+        size_t tail = stepRange<V>(constants, h, substeps, theta1, omega1, theta2, omega2, pixels, begin, end);
+        if (tail < end) stepRange<simd::Scalar>(constants, h, substeps, theta1, omega1, theta2, omega2, pixels, tail, end);
+    }
+}
+
+Ensemble::Ensemble(uint32_t _side, double centre1, double centre2, double spread, unsigned int numThreads) :
+    side(std::max(_side, 1u)),
+    workers(numThreads)
+{
+    size_t count = static_cast<size_t>(side) * side;
+    theta1.resize(count);
+    omega1.assign(count, 0.0);
+    theta2.resize(count);
+    omega2.assign(count, 0.0);
+
+    for (uint32_t y = 0; y < side; ++y)
+    {
+        for (uint32_t x = 0; x < side; ++x)
+        {
+            size_t i = static_cast<size_t>(y) * side + x;
+            theta1[i] = centre1 + spread * (2.0 * (x + 0.5) / side - 1.0);
+            theta2[i] = centre2 + spread * (2.0 * (y + 0.5) / side - 1.0);
+        }
+    }
+
+    image = vsg::ubvec4Array2D::create(side, side, vsg::Data::Properties{VK_FORMAT_R8G8B8A8_UNORM});
+    image->properties.dataVariance = vsg::DYNAMIC_DATA;
+    step(0.0, 0);
+}
+
+const char* Ensemble::kernelName() const
+{
+    return scalar ? simd::Scalar::name : simd::Widest::name;
+}
+
+vsg::ref_ptr<vsg::Node> Ensemble::createModel(vsg::ref_ptr<vsg::Builder> builder, const vsg::vec3& position, float imageSize)
+{
+    vsg::GeometryInfo geomInfo;
+    geomInfo.position = position;
+    geomInfo.dx.set(0.0f, imageSize, 0.0f);
+    geomInfo.dy.set(0.0f, 0.0f, imageSize);
+
+    vsg::StateInfo stateInfo;
+    stateInfo.image = image;
+    stateInfo.lighting = false;
+    stateInfo.two_sided = true;
+
+    return builder->createQuad(geomInfo, stateInfo);
+}
+
+void Ensemble::step(double h, int substeps)
+{
+    auto start = vsg::clock::now();
+
+    //Bands of rows small enough for the pool to balance, large enough to amortise handing them out
+    const size_t rowsPerTask = std::max<size_t>(1, 16384 / side);
+    size_t numTasks = (side + rowsPerTask - 1) / rowsPerTask;
+    auto pixels = image->data();
+
+    workers.run(numTasks, [&](size_t task) {
+        size_t begin = task * rowsPerTask * side;
+        size_t end = std::min(size(), begin + rowsPerTask * side);
+        if (scalar) stepBlock<simd::Scalar>(constants, h, substeps, theta1.data(), omega1.data(), theta2.data(), omega2.data(), pixels, begin, end);
+        else stepBlock<simd::Widest>(constants, h, substeps, theta1.data(), omega1.data(), theta2.data(), omega2.data(), pixels, begin, end);
+    });
+
+    image->dirty();
+
+    if (substeps > 0)
+    {
+        totalStepTime += std::chrono::duration<double>(vsg::clock::now() - start).count();
+        pendulumSteps += static_cast<uint64_t>(size()) * static_cast<uint64_t>(substeps);
+        ++steps;
+    }
+}
+
+void Ensemble::report(std::ostream& out) const
+{
+    if (steps == 0) return;
+
+    out << "Ensemble: " << size() << " pendulums, " << kernelName() << " kernel on " << workers.size() << " threads, "
+        << static_cast<double>(pendulumSteps) / totalStepTime * 1e-6 << " million pendulum steps/s, "
+        << totalStepTime / static_cast<double>(steps) * 1e3 << " ms per frame" << std::endl;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <iostream>
+#include <vector>
+
+#include "pendulumKernel.hpp"
+#include "workerPool.hpp"
+
+//A side x side grid of double pendulums whose starting angles span centre +- spread,
+//stored as structure of arrays and stepped with a fused RK4 over all four state variables
+//The grid is shown as an image, each pixel coloured by its pendulum's current angles, so regions that
+//diverge from their neighbours show how sensitive the motion is to the initial conditions
+class Ensemble : public vsg::Inherit<vsg::Object, Ensemble>
+{
+public:
+    Ensemble(uint32_t _side, double centre1, double centre2, double spread, unsigned int numThreads);
+
+    const uint32_t side;
+    size_t size() const { return theta1.size(); }
+
+    //Use the plain double kernel instead of the widest SIMD one, to compare them
+    bool scalar = false;
+
+    //Name of the kernel step() will use
+    const char* kernelName() const;
+
+    PendulumConstants constants;
+
+    //side x side RGBA image of the ensemble, DYNAMIC_DATA so it is copied to the GPU when step() dirties it
+    vsg::ref_ptr<vsg::ubvec4Array2D> image;
+
+    //Quad showing the image, size wide, centred on position in the y/z plane facing +x
+    vsg::ref_ptr<vsg::Node> createModel(vsg::ref_ptr<vsg::Builder> builder, const vsg::vec3& position, float imageSize);
+
+    //Advance every pendulum by substeps RK4 steps of h and refresh the image, split across the worker pool
+    void step(double h, int substeps);
+
+    void report(std::ostream& out) const;
+
+private:
+    std::vector<double> theta1;
+    std::vector<double> omega1;
+    std::vector<double> theta2;
+    std::vector<double> omega2;
+
+    WorkerPool workers;
+
+    uint64_t steps = 0;
+    uint64_t pendulumSteps = 0;
+    double totalStepTime = 0.0;
+};
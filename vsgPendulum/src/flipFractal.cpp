@@ -0,0 +1,336 @@
+#include "flipFractal.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    const double pi = 3.14159265358979323846;
+
+    //Checkpoint layout: this header, one done byte per tile, then tileSize x tileSize floats for each done tile in order
+    struct CheckpointHeader
+    {
+        char magic[8] = {'F', 'L', 'I', 'P', 'T', 'I', 'M', 'E'};
+        uint32_t version = 1;
+        uint32_t side = 0;
+        uint32_t tileSize = 0;
+        uint32_t padding = 0;
+        double maxTime = 0.0;
+        double step = 0.0;
+        PendulumConstants constants;
+    };
+
+    //Integrate cells [begin, end) of one row until each flips or maxSteps pass, with V wide vectors
+    //Returns where the full vectors stopped, laneSteps counts the lane steps taken
+    template <class V>
+    size_t flipRange(const PendulumConstants& constants, double h, uint32_t maxSteps, double threshold, const double* theta1, double theta2,
+                     float* out, size_t begin, size_t end, uint64_t& laneSteps)
+    {
+        pendulum::Coefficients<V> k(constants);
+        const double a = (constants.mass1 + constants.mass2) * constants.len1;
+        const double b = constants.mass2 * constants.len2;
+        const double cos2 = b * std::cos(theta2);
+        V vh = V::set(h);
+        V vpi = V::set(pi);
+        V zero = V::set(0.0);
+
+        size_t i = begin;
+        for (; i + V::width <= end; i += V::width)
+        {
+            //Released from rest, a link can only reach the top if the potential energy allows it, most of the grid is ruled out here
+            int live = 0;
+            for (int l = 0; l < V::width; ++l)
+            {
+                out[i + l] = -1.0f;
+                if (a * std::cos(theta1[i + l]) + cos2 <= threshold) live |= 1 << l;
+            }
+            if (live == 0) continue;
+
+            V t1 = V::load(theta1 + i), w1 = zero, t2 = V::set(theta2), w2 = zero;
+            uint32_t s = 0;
+            while (live != 0 && s < maxSteps)
+            {
+                pendulum::rk4(k, vh, 1, t1, w1, t2, w2);
+                ++s;
+                int flipped = (greaterMask(abs(t1), vpi) | greaterMask(abs(t2), vpi)) & live;
+                if (flipped != 0)
+                {
+                    for (int l = 0; l < V::width; ++l)
+                    {
+                        if (flipped & (1 << l)) out[i + l] = static_cast<float>(s * h);
+                    }
+                    live &= ~flipped;
+                }
+            }
+            laneSteps += static_cast<uint64_t>(s) * V::width;
+        }
+        return i;
+    }
+
+    vsg::ubvec4 colour(float time, double maxTime)
+    {
+        if (time < 0.0f) return vsg::ubvec4(0, 0, 0, 255);
+
+        //Cosine palette over log time, so the quick flips near the centre and the slow ones at the edges both get colours
+        double x = std::log1p(time) / std::log1p(maxTime);
+        auto channel = [&](double phase) { return static_cast<uint8_t>(255.0 * (0.5 + 0.5 * std::cos(2.0 * pi * (x + phase)))); };
+        return vsg::ubvec4(channel(0.0), channel(0.33), channel(0.67), 255);
+    }
+}
+
+FlipFractal::FlipFractal(uint32_t _side, uint32_t _tileSize, double _maxTime, double _step, unsigned int numThreads) :
+    side(std::max(_side, 1u)),
+    tileSize(std::max(std::min(_tileSize, side), 1u)),
+    maxTime(_maxTime),
+    step(_step),
+    pool(numThreads)
+{
+    tilesAcross = (side + tileSize - 1) / tileSize;
+
+    angles.resize(side);
+    for (uint32_t i = 0; i < side; ++i) angles[i] = pi * (2.0 * (i + 0.5) / side - 1.0);
+
+    flipTimes.assign(static_cast<size_t>(side) * side, -1.0f);
+    tileDone.reset(new std::atomic<uint8_t>[numTiles()]);
+    for (size_t t = 0; t < numTiles(); ++t) tileDone[t] = 0;
+
+    image = vsg::ubvec4Array2D::create(side, side, vsg::Data::Properties{VK_FORMAT_R8G8B8A8_UNORM});
+    image->properties.dataVariance = vsg::DYNAMIC_DATA;
+    std::fill(image->begin(), image->end(), vsg::ubvec4(64, 64, 64, 255));
+}
+
+FlipFractal::~FlipFractal()
+{
+    pool.cancel();
+}
+
+vsg::ref_ptr<vsg::Node> FlipFractal::createModel(vsg::ref_ptr<vsg::Builder> builder, const vsg::vec3& position, float imageSize)
+{
+    vsg::GeometryInfo geomInfo;
+    geomInfo.position = position;
+    geomInfo.dx.set(0.0f, imageSize, 0.0f);
+    geomInfo.dy.set(0.0f, 0.0f, imageSize);
+
+    vsg::StateInfo stateInfo;
+    stateInfo.image = image;
+    stateInfo.lighting = false;
+    stateInfo.two_sided = true;
+
+    return builder->createQuad(geomInfo, stateInfo);
+}
+
+void FlipFractal::start(const std::string& _checkpointFile, double _checkpointInterval)
+{
+    checkpointFile = _checkpointFile;
+    checkpointInterval = _checkpointInterval;
+
+    if (!checkpointFile.empty() && loadCheckpoint())
+    {
+        std::scoped_lock<std::mutex> lock(finishedMutex);
+        for (size_t t = 0; t < numTiles(); ++t)
+        {
+            if (tileDone[t]) finishedTiles.push_back(t);
+        }
+        tilesResumed = finishedTiles.size();
+    }
+
+    std::vector<size_t> tasks;
+    for (size_t t = 0; t < numTiles(); ++t)
+    {
+        if (!tileDone[t]) tasks.push_back(t);
+    }
+
+    startTime = lastCheckpoint = clock::now();
+    pool.start(tasks, [this](size_t tile) { computeTile(tile); });
+}
+
+void FlipFractal::computeTile(size_t tile)
+{
+    auto tileStart = clock::now();
+
+    size_t x0 = (tile % tilesAcross) * tileSize;
+    size_t y0 = (tile / tilesAcross) * tileSize;
+    size_t x1 = std::min<size_t>(side, x0 + tileSize);
+    size_t y1 = std::min<size_t>(side, y0 + tileSize);
+
+    auto maxSteps = static_cast<uint32_t>(std::ceil(maxTime / step));
+    double threshold = std::abs((constants.mass1 + constants.mass2) * constants.len1 - constants.mass2 * constants.len2);
+    uint64_t steps = 0;
+
+    for (size_t y = y0; y < y1; ++y)
+    {
+        float* row = flipTimes.data() + y * side;
+        size_t tail = flipRange<simd::Widest>(constants, step, maxSteps, threshold, angles.data(), angles[y], row, x0, x1, steps);
+        if (tail < x1) flipRange<simd::Scalar>(constants, step, maxSteps, threshold, angles.data(), angles[y], row, tail, x1, steps);
+    }
+
+    tileDone[tile].store(1, std::memory_order_release);
+    {
+        std::scoped_lock<std::mutex> lock(finishedMutex);
+        finishedTiles.push_back(tile);
+    }
+
+    computeNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - tileStart).count();
+    tilesComputed += 1;
+    cellsComputed += (x1 - x0) * (y1 - y0);
+    laneSteps += steps;
+
+    //Whichever worker finishes a tile after the interval writes the checkpoint, the others carry on
+    if (!checkpointFile.empty() && !checkpointing.exchange(true))
+    {
+        auto now = clock::now();
+        if (std::chrono::duration<double>(now - lastCheckpoint).count() >= checkpointInterval)
+        {
+            saveCheckpoint();
+            lastCheckpoint = now;
+        }
+        checkpointing = false;
+    }
+
+    if (tileFinished) tileFinished();
+}
+
+void FlipFractal::colourTile(size_t tile)
+{
+    size_t x0 = (tile % tilesAcross) * tileSize;
+    size_t y0 = (tile / tilesAcross) * tileSize;
+    size_t x1 = std::min<size_t>(side, x0 + tileSize);
+    size_t y1 = std::min<size_t>(side, y0 + tileSize);
+
+    for (size_t y = y0; y < y1; ++y)
+    {
+        for (size_t x = x0; x < x1; ++x)
+        {
+            image->at(static_cast<uint32_t>(x), static_cast<uint32_t>(y)) = colour(flipTimes[y * side + x], maxTime);
+        }
+    }
+}
+
+bool FlipFractal::update()
+{
+    std::vector<size_t> tiles;
+    {
+        std::scoped_lock<std::mutex> lock(finishedMutex);
+        tiles.swap(finishedTiles);
+    }
+    if (tiles.empty()) return false;
+
+    for (auto tile : tiles) colourTile(tile);
+    image->dirty();
+    return true;
+}
+
+void FlipFractal::stop()
+{
+    pool.cancel();
+    elapsed = std::chrono::duration<double>(clock::now() - startTime).count();
+    if (!checkpointFile.empty() && tilesComputed > 0) saveCheckpoint();
+}
+
+bool FlipFractal::loadCheckpoint()
+{
+    std::ifstream file(checkpointFile, std::ios::binary);
+    if (!file) return false;
+
+    CheckpointHeader expected, header;
+    expected.side = side;
+    expected.tileSize = tileSize;
+    expected.maxTime = maxTime;
+    expected.step = step;
+    expected.constants = constants;
+
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(&header, &expected, sizeof(header)) != 0)
+    {
+        std::cout << "Flip fractal: " << checkpointFile << " is from a different sweep, starting over" << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> done(numTiles());
+    file.read(reinterpret_cast<char*>(done.data()), static_cast<std::streamsize>(done.size()));
+
+    std::vector<float> block(static_cast<size_t>(tileSize) * tileSize);
+    for (size_t t = 0; t < numTiles() && file; ++t)
+    {
+        if (!done[t]) continue;
+        if (!file.read(reinterpret_cast<char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(float)))) break;
+
+        size_t x0 = (t % tilesAcross) * tileSize;
+        size_t y0 = (t / tilesAcross) * tileSize;
+        for (size_t y = y0; y < std::min<size_t>(side, y0 + tileSize); ++y)
+        {
+            for (size_t x = x0; x < std::min<size_t>(side, x0 + tileSize); ++x)
+            {
+                flipTimes[y * side + x] = block[(y - y0) * tileSize + (x - x0)];
+            }
+        }
+        tileDone[t] = 1;
+    }
+    return true;
+}
+
+bool FlipFractal::saveCheckpoint()
+{
+    //Snapshot which tiles are done first, only their cells are read so the workers can keep writing the others
+    std::vector<uint8_t> done(numTiles());
+    for (size_t t = 0; t < numTiles(); ++t) done[t] = tileDone[t].load(std::memory_order_acquire);
+
+    //Write alongside and rename over the old one, so stopping mid write never loses the previous checkpoint
+    std::string temporary = checkpointFile + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+
+        CheckpointHeader header;
+        header.side = side;
+        header.tileSize = tileSize;
+        header.maxTime = maxTime;
+        header.step = step;
+        header.constants = constants;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(done.data()), static_cast<std::streamsize>(done.size()));
+
+        std::vector<float> block(static_cast<size_t>(tileSize) * tileSize);
+        for (size_t t = 0; t < numTiles(); ++t)
+        {
+            if (!done[t]) continue;
+
+            std::fill(block.begin(), block.end(), -1.0f);
+            size_t x0 = (t % tilesAcross) * tileSize;
+            size_t y0 = (t / tilesAcross) * tileSize;
+            for (size_t y = y0; y < std::min<size_t>(side, y0 + tileSize); ++y)
+            {
+                for (size_t x = x0; x < std::min<size_t>(side, x0 + tileSize); ++x)
+                {
+                    block[(y - y0) * tileSize + (x - x0)] = flipTimes[y * side + x];
+                }
+            }
+            file.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(float)));
+        }
+        if (!file) return false;
+    }
+
+    if (std::rename(temporary.c_str(), checkpointFile.c_str()) != 0) return false;
+    ++checkpointsWritten;
+    return true;
+}
+
+void FlipFractal::report(std::ostream& out) const
+{
+    size_t done = tilesResumed + tilesComputed;
+    out << "Flip fractal: " << side << "x" << side << " cells, " << done << "/" << numTiles() << " tiles of " << tileSize << "x" << tileSize;
+    if (tilesResumed > 0) out << " (" << tilesResumed << " resumed)";
+    out << ", " << simd::Widest::name << " kernel on " << pool.size() << " threads, " << pool.steals() << " tiles stolen" << std::endl;
+
+    double computeSeconds = static_cast<double>(computeNanoseconds) * 1e-9;
+    if (tilesComputed > 0 && elapsed > 0.0 && computeSeconds > 0.0)
+    {
+        out << "    " << static_cast<double>(cellsComputed) / elapsed << " cells/s, "
+            << static_cast<double>(laneSteps) / computeSeconds * 1e-6 << " million pendulum steps/s per thread, "
+            << elapsed << " s";
+        if (!checkpointFile.empty()) out << ", " << checkpointsWritten << " checkpoints to " << checkpointFile;
+        out << std::endl;
+    }
+}
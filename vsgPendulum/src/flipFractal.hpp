@@ -0,0 +1,93 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "pendulumKernel.hpp"
+#include "workStealing.hpp"
+
+//Time for a double pendulum released from rest to first swing either link over the top, for every cell of a
+//side x side grid of starting angles (theta1 across, theta2 up) in [-pi, pi]
+//The grid is split into tiles computed in the background by a work stealing pool, since cells that cannot flip
+//cost nothing and those that never flip run to the timeout. update() colours tiles into the image as they finish
+//so the fractal fills in progressively, and finished tiles can be checkpointed to a file to resume large sweeps
+class FlipFractal : public vsg::Inherit<vsg::Object, FlipFractal>
+{
+public:
+    FlipFractal(uint32_t _side, uint32_t _tileSize, double _maxTime, double _step, unsigned int numThreads);
+    ~FlipFractal();
+
+    const uint32_t side;
+    const uint32_t tileSize;
+    const double maxTime;
+    const double step;
+
+    PendulumConstants constants;
+
+    size_t numTiles() const { return static_cast<size_t>(tilesAcross) * tilesAcross; }
+
+    //side x side RGBA image, unfinished tiles grey, cells that never flip black
+    vsg::ref_ptr<vsg::ubvec4Array2D> image;
+
+    //Quad showing the image, size wide, centred on position in the y/z plane facing +x
+    vsg::ref_ptr<vsg::Node> createModel(vsg::ref_ptr<vsg::Builder> builder, const vsg::vec3& position, float imageSize);
+
+    //Called on a worker thread whenever a tile finishes, e.g. to request a frame
+    std::function<void()> tileFinished;
+
+    //Load the tiles already in checkpointFile when it holds the same sweep, then compute the rest in the background
+    //With a file name the finished tiles are saved to it every checkpointInterval seconds and by stop()
+    void start(const std::string& _checkpointFile = {}, double _checkpointInterval = 30.0);
+
+    //Main thread, colour the tiles finished since the last call into the image, returns true when any were
+    bool update();
+
+    //Cancel the tiles not started yet, wait for the running ones and write the final checkpoint
+    void stop();
+
+    void report(std::ostream& out) const;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    void computeTile(size_t tile);
+    void colourTile(size_t tile);
+    bool loadCheckpoint();
+    bool saveCheckpoint();
+
+    uint32_t tilesAcross;
+
+    //Starting angle of each row and column
+    std::vector<double> angles;
+
+    //Seconds to the first flip of each cell, -1 when it did not flip within maxTime
+    std::vector<float> flipTimes;
+
+    //Set with release once a tile's flipTimes are written
+    std::unique_ptr<std::atomic<uint8_t>[]> tileDone;
+
+    std::mutex finishedMutex;
+    std::vector<size_t> finishedTiles;
+
+    WorkStealingPool pool;
+
+    std::string checkpointFile;
+    double checkpointInterval = 30.0;
+    std::atomic<bool> checkpointing{false};
+    clock::time_point lastCheckpoint;
+    uint64_t checkpointsWritten = 0;
+
+    clock::time_point startTime;
+    std::atomic<int64_t> computeNanoseconds{0};
+    std::atomic<uint64_t> tilesComputed{0};
+    std::atomic<uint64_t> cellsComputed{0};
+    std::atomic<uint64_t> laneSteps{0};
+    size_t tilesResumed = 0;
+    double elapsed = 0.0;
+};
@@ -0,0 +1,117 @@
+#include "interpolator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+    const double pi = 3.14159265358979323846;
+
+    double steadySeconds()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //Shortest signed difference between two angles, so a link passing over the top is not swung the long way round
+    double angleDifference(double from, double to)
+    {
+        return std::remainder(to - from, 2.0 * pi);
+    }
+
+    //Cubic Hermite through angle a0 with rate w0 at s = 0 and a0 + difference with rate w1 at s = 1, h seconds apart
+    float hermite(double a0, double w0, double difference, double w1, double h, double s)
+    {
+        double s2 = s * s, s3 = s2 * s;
+        return static_cast<float>(a0 + (s3 - 2.0 * s2 + s) * h * w0 + (3.0 * s2 - 2.0 * s3) * difference + (s3 - s2) * h * w1);
+    }
+}
+
+void StateInterpolator::push(const TimedState& timed)
+{
+    if (count > 0 && timed.time <= history[newest].time) return;
+
+    if (count > 0)
+    {
+        double step = timed.time - history[newest].time;
+        interval = interval > 0.0 ? interval + 0.05 * (step - interval) : step;
+
+        //Follow the offset slowly, but jump to it after a pause or a stall rather than drifting across
+        double offsetChange = timed.clockOffset - clockOffset;
+        if (std::abs(offsetChange) > 0.1) clockOffset = timed.clockOffset;
+        else clockOffset += 0.05 * offsetChange;
+    }
+    else
+    {
+        clockOffset = timed.clockOffset;
+    }
+
+    newest = (newest + 1) % capacity;
+    history[newest] = timed;
+    count = std::min(count + 1, capacity);
+}
+
+PData StateInterpolator::evaluate(double t)
+{
+    const TimedState& last = sample(0);
+    if (t >= last.time || count == 1)
+    {
+        //Past the newest state, carry it on with the rates and the acceleration between the last two states
+        double dt = std::min(std::max(t - last.time, 0.0), maxExtrapolation);
+        if (t - last.time > maxExtrapolation) ++held;
+        else ++extrapolated;
+
+        PData state = last.state;
+        if (count > 1 && dt > 0.0)
+        {
+            const TimedState& previous = sample(1);
+            double h = last.time - previous.time;
+            double a1 = (last.state.p - previous.state.p) / h;
+            double a2 = (last.state.p2 - previous.state.p2) / h;
+            state.t = static_cast<float>(last.state.t + last.state.p * dt + 0.5 * a1 * dt * dt);
+            state.t2 = static_cast<float>(last.state.t2 + last.state.p2 * dt + 0.5 * a2 * dt * dt);
+            state.p = static_cast<float>(last.state.p + a1 * dt);
+            state.p2 = static_cast<float>(last.state.p2 + a2 * dt);
+        }
+        return state;
+    }
+
+    //Find the two states either side of t, the newest pairs are checked first as that is where frames land
+    for (size_t age = 1; age < count; ++age)
+    {
+        const TimedState& a = sample(age);
+        if (a.time > t) continue;
+
+        const TimedState& b = sample(age - 1);
+        double h = b.time - a.time;
+        double s = (t - a.time) / h;
+
+        PData state;
+        state.t = hermite(a.state.t, a.state.p, angleDifference(a.state.t, b.state.t), b.state.p, h, s);
+        state.t2 = hermite(a.state.t2, a.state.p2, angleDifference(a.state.t2, b.state.t2), b.state.p2, h, s);
+        state.p = static_cast<float>(a.state.p + s * (b.state.p - a.state.p));
+        state.p2 = static_cast<float>(a.state.p2 + s * (b.state.p2 - a.state.p2));
+        ++interpolated;
+        return state;
+    }
+
+    //Further back than the history reaches
+    ++held;
+    return sample(count - 1).state;
+}
+
+PData StateInterpolator::evaluateNow()
+{
+    double lag = delay >= 0.0 ? delay : interval;
+    totalDelay += lag;
+    return evaluate(steadySeconds() - clockOffset - lag);
+}
+
+void StateInterpolator::report(std::ostream& out) const
+{
+    uint64_t frames = interpolated + extrapolated + held;
+    if (frames == 0) return;
+
+    out << "Interpolation: " << interpolated << " frames interpolated, " << extrapolated << " extrapolated, " << held << " held, "
+        << totalDelay / static_cast<double>(frames) * 1e3 << " ms average delay, " << interval * 1e3 << " ms between states" << std::endl;
+}
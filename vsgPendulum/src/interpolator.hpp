@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+
+#include "pMath.hpp"
+
+//Render thread side of the state handoff, keeps the last few published states and evaluates the pendulum at the
+//present time instead of showing whichever state was latest when the frame started
+//The display runs one publish interval behind the newest state so frames land between two states, each angle is
+//a cubic Hermite through both states' angles and angular velocities, so the simulation can publish at a low fixed rate
+class StateInterpolator {
+public:
+    //Seconds the display runs behind the newest state, negative uses the measured interval between published states
+    double delay = -1.0;
+
+    //Furthest the state is extrapolated past the newest one before the pendulum is held still
+    double maxExtrapolation = 0.05;
+
+    //Add a newly published state, older or repeated ones are ignored
+    void push(const TimedState& timed);
+
+    bool empty() const { return count == 0; }
+
+    //State at simulation time t
+    PData evaluate(double t);
+
+    //State at the present steady clock time less the delay
+    PData evaluateNow();
+
+    //How frames were evaluated and the average delay
+    void report(std::ostream& out) const;
+
+private:
+    static constexpr size_t capacity = 8;
+
+    const TimedState& sample(size_t age) const { return history[(newest + capacity - age) % capacity]; }
+
+    std::array<TimedState, capacity> history;
+    size_t newest = 0;
+    size_t count = 0;
+
+    //Smoothed clock offset and publish interval, the raw ones carry the simulation thread's scheduling jitter
+    double clockOffset = 0.0;
+    double interval = 0.0;
+
+    uint64_t interpolated = 0;
+    uint64_t extrapolated = 0;
+    uint64_t held = 0;
+    double totalDelay = 0.0;
+};
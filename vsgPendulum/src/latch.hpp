@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+//Generic SafeSharedPtr
+//Every store allocates and both sides take the lock, kept for comparison with --mutex-latch
+template <typename T>
+class SafeSharedPtr {
+    std::mutex  mtx;
+    std::shared_ptr<T>  ptr;
+public:
+    SafeSharedPtr() : ptr(nullptr) {}
+
+    void store(std::shared_ptr<T> arg)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        ptr = arg;
+    }
+
+    std::shared_ptr<T> load()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        return ptr;
+    }
+};
+
+//Wait-free single producer, single consumer triple buffer holding T by value
+//The producer writes into its back buffer and swaps it with the middle one, the consumer swaps its front buffer
+//with the middle one when it is marked fresh, so neither side ever waits for the other or allocates
+template <typename T>
+class TripleBuffer {
+    static constexpr uint8_t indexMask = 3;
+    static constexpr uint8_t freshBit = 4;
+
+    //Each buffer on its own cache line so the two threads do not share one
+    struct alignas(64) Slot { T value; };
+
+    Slot buffers[3];
+    alignas(64) std::atomic<uint8_t> middle;
+    alignas(64) uint8_t back;  //only used by the producer
+    alignas(64) uint8_t front; //only used by the consumer
+public:
+    TripleBuffer() : buffers{}, middle(1), back(0), front(2) {}
+
+    //Producer side, copy value in and make it the latest state
+    void store(const T& value)
+    {
+        buffers[back].value = value;
+        back = middle.exchange(back | freshBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    //Consumer side, copy out the latest state, returns false when nothing new has been stored since the last load
+    bool load(T& value)
+    {
+        if (!(middle.load(std::memory_order_relaxed) & freshBit)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+        value = buffers[front].value;
+        return true;
+    }
+};
+
+//Cost of handing states from the simulation thread to the render thread
+//published() is called on the simulation thread, loaded() on the render thread
+class HandoffStats {
+public:
+    using clock = std::chrono::steady_clock;
+
+    HandoffStats() : start(clock::now()) {}
+
+    void published(clock::time_point begin)
+    {
+        auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - begin).count();
+        publishes.fetch_add(1, std::memory_order_relaxed);
+        publishNanoseconds.fetch_add(static_cast<uint64_t>(nanoseconds), std::memory_order_relaxed);
+    }
+
+    void loaded(clock::time_point begin)
+    {
+        double nanoseconds = std::chrono::duration<double, std::nano>(clock::now() - begin).count();
+        ++loads;
+        loadNanoseconds += nanoseconds;
+        loadMax = std::max(loadMax, nanoseconds);
+    }
+
+    void report(const std::string& name, std::ostream& out) const
+    {
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        uint64_t steps = publishes.load(std::memory_order_relaxed);
+
+        out << "State handoff (" << name << "): " << static_cast<double>(steps) / seconds << " steps/s";
+        if (steps > 0) out << ", publish " << static_cast<double>(publishNanoseconds.load(std::memory_order_relaxed)) / static_cast<double>(steps) << " ns";
+        if (loads > 0) out << ", render thread stall " << loadNanoseconds / static_cast<double>(loads) << " ns average, " << loadMax << " ns max";
+        out << std::endl;
+    }
+
+private:
+    clock::time_point start;
+    std::atomic<uint64_t> publishes{0};
+    std::atomic<uint64_t> publishNanoseconds{0};
+
+    uint64_t loads = 0;
+    double loadNanoseconds = 0.0;
+    double loadMax = 0.0;
+};
@@ -14,67 +14,26 @@
 #include <chrono>
 #include <functional>
 #include <vector>
+#include <atomic>
 #include <unistd.h>
 
 #include "builderModels.hpp"
 #include "pMath.hpp"
-
-//Generic thread wrapper
-class Simulator {
-public:
-    using Callback = std::function<void ()>;
-private:
-    Callback callback;
-    bool die;
-    std::thread tid;
-    std::string name;
-public:
-	//Construct std function from provided callable
-    Simulator(Callback _callback) : callback(_callback), die(false)
-    {
-		//Create thread
-        tid = std::thread([this]() { this->worker(); });
-    }
-
-    ~Simulator()
-    {
-        {
-            die = true;
-        }
-        tid.join();
-    }
-
-	//Generic run loop that pMath exists in
-    void worker()
-    {
-        using namespace std;
-        for (;;) {
-            callback();
-            if (die) return;
-        }
-    }
-};
-
-//Generic SafeSharedPtr
-template <typename T>
-class SafeSharedPtr {
-    std::mutex  mtx;
-    std::shared_ptr<T>  ptr;
-public:
-    SafeSharedPtr() : ptr(nullptr) {}
-
-    void store(std::shared_ptr<T> arg)
-    {
-        std::unique_lock<std::mutex> lock(mtx);
-        ptr = arg;
-    }
-
-    std::shared_ptr<T> load()
-    {
-        std::unique_lock<std::mutex> lock(mtx);
-        return ptr;
-    }
-};
+#include "latch.hpp"
+#include "interpolator.hpp"
+#include "simulator.hpp"
+#include "ensemble.hpp"
+#include "chainMath.hpp"
+#include "flipFractal.hpp"
+#include "trail.hpp"
+#include "onDemandRendering.hpp"
+#include "frameStats.hpp"
+#include "appProfiler.hpp"
+#include "metricsPublisher.hpp"
+#include "renderStats.hpp"
+#include "flattenStatic.hpp"
+#include "stateRecording.hpp"
+#include "sceneBenchmark.hpp"
 
 template <typename T>
 std::string demangle(T&&) {
@@ -102,7 +61,7 @@ public:
 
     void apply(vsg::KeyPressEvent& keyPress) override
     {
-        if (keyPress.keyBase == vsg::KEY_Space);
+        if (keyPress.keyBase == vsg::KEY_Space)
         {
             b = !b;
         }
@@ -134,6 +93,71 @@ int main(int argc, char** argv)
     if (arguments.errors()) return arguments.writeErrorMessages(std::cerr);
 
     bool multiThreading = arguments.read("--mt");
+    bool onDemand = arguments.read("--on-demand");
+    // --flatten bakes the static transforms into the vertex data and merges draws that share state
+    bool flatten = arguments.read("--flatten");
+    // hand states over through the old mutex + shared_ptr latch instead of the triple buffer, to compare the two
+    bool mutexLatch = arguments.read("--mutex-latch");
+    // show the latest published state as it is instead of interpolating to each frame's time
+    bool interpolate = !arguments.read("--no-interpolation");
+    SimulatorSettings simulatorSettings;
+    simulatorSettings.read(arguments);
+    // --integrator dopri takes adaptive Dormand-Prince steps and the renderer interpolates the state at each frame's time
+    auto integrator = arguments.value<std::string>("rk4", "--integrator");
+    if (integrator != "rk4" && integrator != "dopri")
+    {
+        std::cout << "Unknown integrator " << integrator << ", --integrator takes rk4 or dopri" << std::endl;
+        return 1;
+    }
+    bool dormandPrince = integrator == "dopri";
+    auto tolerance = arguments.value(1e-8, "--tolerance");
+    auto maxStep = arguments.value(0.1, "--max-step");
+    // --ensemble N steps a grid of N pendulums started around the main one and shows them as an image behind it
+    auto ensembleCount = arguments.value<uint32_t>(0, "--ensemble");
+    auto ensembleSpread = arguments.value(vsg::PI, "--ensemble-spread");
+    auto ensembleStep = arguments.value(0.005, "--ensemble-step");
+    auto ensembleSubsteps = arguments.value(2, "--ensemble-substeps");
+    bool ensembleScalar = arguments.read("--ensemble-scalar");
+    auto ensembleThreads = arguments.value<unsigned int>(0, "--threads");
+    // --fractal N sweeps an N x N grid of starting angles for the time to the first flip, shown as the tiles finish
+    auto fractalSide = arguments.value<uint32_t>(0, "--fractal");
+    auto fractalTile = arguments.value<uint32_t>(64, "--fractal-tile");
+    auto fractalTime = arguments.value(10.0, "--fractal-time");
+    auto fractalStep = arguments.value(0.005, "--fractal-step");
+    auto fractalCheckpoint = arguments.value<std::string>("", "--fractal-checkpoint");
+    auto fractalInterval = arguments.value(30.0, "--fractal-interval");
+    // --trail N draws the last N positions of the second bob as a fading line
+    auto trailPoints = arguments.value<uint32_t>(0, "--trail");
+    // --chain N replaces the double pendulum with an N link chain, --chain-step overrides its integration step
+    auto chainLinks = arguments.value<uint32_t>(0, "--chain");
+    auto chainStep = arguments.value(0.0, "--chain-step");
+    // --chain-benchmark prints steps/s against chain length and exits without opening a window
+    if (arguments.read("--chain-benchmark"))
+    {
+        ChainMath::benchmark({2, 4, 8, 16, 32, 64, 128, 256, 512, 1024}, 0.5, std::cout);
+        return 0;
+    }
+    // --record file saves the state shown each frame, --play file shows a recording instead of simulating
+    RecordingOptions recordingOptions;
+    recordingOptions.read(arguments);
+    FrameStatsOptions frameStatsOptions;
+    frameStatsOptions.read(arguments);
+    // --benchmark N draws N frames of a --play recording on a fixed simulated timeline and writes a JSON report
+    SceneBenchmark benchmark;
+    benchmark.read(arguments);
+    ProfilerOptions profilerOptions;
+    profilerOptions.read(arguments);
+
+    // create the profiler up front so loading shows up in it
+    auto instrumentation = profilerOptions.createInstrumentation();
+    MetricsPublisher metrics(readMetricsName(arguments), "vsgPendulum");
+    RenderStatsMonitor renderStats(arguments.read("--render-stats"));
+    benchmark.configure(renderStats);
+    if (benchmark.enabled() && recordingOptions.playFilename.empty())
+    {
+        std::cout << "--benchmark needs --play file, the live simulation runs on the wall clock so no two runs would draw the same frames" << std::endl;
+        return 1;
+    }
     bool separateDevices = arguments.read({"--no-shared-window", "-n"});
     // bool useStagingBuffer = arguments.read({"--staging-buffer", "-s"});
 
@@ -154,10 +178,45 @@ int main(int argc, char** argv)
     auto axes = aModel.axes;
     group->addChild(axes);
 
-    // Pendulum
+    // Pendulum, or a chain of links in its place
     PModel pModel(builder);
-    auto pendulum = pModel.pendulum;
-    group->addChild(pendulum);
+    std::unique_ptr<CModel> cModel;
+    if (chainLinks > 0)
+    {
+        cModel = std::make_unique<CModel>(builder, chainLinks);
+        group->addChild(cModel->chain);
+    }
+    else
+    {
+        auto pendulum = pModel.pendulum;
+        group->addChild(pendulum);
+    }
+
+    // Ensemble of pendulums
+    vsg::ref_ptr<Ensemble> ensemble;
+    if (ensembleCount > 0)
+    {
+        auto side = static_cast<uint32_t>(std::lround(std::sqrt(static_cast<double>(ensembleCount))));
+        ensemble = Ensemble::create(side, 3.1415, 3.1415, ensembleSpread, ensembleThreads);
+        ensemble->scalar = ensembleScalar;
+        group->addChild(ensemble->createModel(builder, vsg::vec3(-50.0f, 0.0f, 0.0f), 800.0f));
+    }
+
+    // Flip time fractal, beside the ensemble when both are shown
+    vsg::ref_ptr<FlipFractal> fractal;
+    if (fractalSide > 0)
+    {
+        fractal = FlipFractal::create(fractalSide, fractalTile, fractalTime, fractalStep, ensembleThreads);
+        group->addChild(fractal->createModel(builder, vsg::vec3(-50.0f, ensemble ? 850.0f : 0.0f, 0.0f), 800.0f));
+    }
+
+    // Trail of the second bob, after everything opaque as it is blended over the scene
+    vsg::ref_ptr<Trail> trail;
+    if (trailPoints > 0 && !cModel)
+    {
+        trail = Trail::create(trailPoints);
+        group->addChild(trail->createModel());
+    }
 
     // Lights
     auto directionalLight = vsg::DirectionalLight::create();
@@ -167,11 +226,28 @@ int main(int argc, char** argv)
     directionalLight->direction.set(-1.0f, 0.0f, -1.0f);
     group->addChild(directionalLight);
 
+    if (flatten)
+    {
+        // only the joints the simulation drives move, the links hanging from them and the axes are static
+        auto flattener = FlattenStaticTransforms::create();
+        for (auto& transform : pModel.dynamicTransforms()) flattener->keep(transform);
+        if (cModel)
+        {
+            for (auto& transform : cModel->dynamicTransforms()) flattener->keep(transform);
+        }
+        group->accept(*flattener);
+        flattener->report(std::cout);
+    }
+
     auto scene = vsg::Node::create();
     scene = group;
 
     // compute the bounds of the scene graph to help position camera
-    auto bounds = vsg::visit<vsg::ComputeBounds>(scene).bounds;
+    vsg::dbox bounds;
+    {
+        APP_ZONE("bounds", APP_COLOR_BOUNDS);
+        bounds = vsg::visit<vsg::ComputeBounds>(scene).bounds;
+    }
     vsg::dvec3 centre = (bounds.min + bounds.max) * 0.5;
     double radius = vsg::length(bounds.max - bounds.min) * 0.6;
 
@@ -214,9 +290,16 @@ int main(int argc, char** argv)
     main_trackball->addWindow(window);
     viewer->addEventHandler(main_trackball);
 
-    // assign Input handler
-    auto planeCamera = InputHandler::create();
-    viewer->addEventHandler(planeCamera);
+    // assign Input handler, space pauses the simulation
+    auto pauseHandler = InputHandler::create();
+    viewer->addEventHandler(pauseHandler);
+
+    // only render when the simulation publishes a new state or input arrives if --on-demand is set
+    auto onDemandRendering = OnDemandRendering::create(onDemand && !benchmark.enabled());
+    viewer->addEventHandler(onDemandRendering);
+
+    // --benchmark-script plays a camera animation over the benchmark timeline, r records one
+    benchmark.assign(viewer, camera, options);
 
     auto renderGraph = vsg::RenderGraph::create(window, view);
 
@@ -225,45 +308,284 @@ int main(int argc, char** argv)
 
     viewer->assignRecordAndSubmitTaskAndPresentation({commandGraph});
 
+    if (instrumentation) viewer->assignInstrumentation(instrumentation);
+
     if (multiThreading)
     {
         viewer->setupThreading();
     }
 
+    // time every frame, plus the GPU work of the main window using timestamp queries
+    FrameStats frameStats(benchmark.historySize());
+    frameStats.budget = frameStatsOptions.budget;
+    if (frameStatsOptions.gpuTime)
+    {
+        frameStats.gpuTimer = GpuFrameTimer::create();
+        frameStats.gpuTimer->assign(commandGraph);
+    }
+
+    renderStats.assign(commandGraph, window, options);
+    metrics.scene = scene;
     viewer->compile();
 
     auto startTime = vsg::clock::now();
     double numFramesCompleted = 0.0;
 
-    //Initialize pendulum position structure pointer
-    SafeSharedPtr<PData> latch;
+    if (fractal)
+    {
+        fractal->tileFinished = [&]() { onDemandRendering->requestFrame(); };
+        fractal->start(fractalCheckpoint, fractalInterval);
+    }
+
+    //Initialize pendulum state handoff, a lock free triple buffer unless --mutex-latch is set
+    SafeSharedPtr<TimedState> latch;
+    TripleBuffer<TimedState> tripleBuffer;
+    TripleBuffer<DenseStep> denseBuffer;
+    HandoffStats handoffStats;
 	//Initialize mathematical model 
 	pMath ourPm(3.1415, 3.1415); //Input thetas
+    ourPm.tolerance = tolerance;
+    ourPm.maxStep = maxStep;
+    //N link chain, stepped over the wall clock time since the last call and handed over as float joint angles
+    //The buffers only allocate on their first store, after that every copy fits the capacity already there
+    std::unique_ptr<ChainMath> chainMath;
+    if (chainLinks > 0)
+    {
+        chainMath = std::make_unique<ChainMath>(chainLinks, 3.1415);
+        if (chainStep > 0.0) chainMath->maxStep = chainStep;
+    }
+    TripleBuffer<std::vector<float>> chainBuffer;
+    std::vector<float> chainState(chainLinks);
+    auto chainThen = vsg::clock::now();
+    StateRecorder recorder(recordingOptions.recordFilename, RecordingKind::Pendulum, sizeof(PData));
+    StatePlayer player(recordingOptions.playFilename, RecordingKind::Pendulum, sizeof(PData));
+    recordingOptions.configure(player);
+    //Written by the render thread, read by the simulation thread
+    std::atomic<bool> paused(false);
 	//Call generic thread creator and initialize with our callable
-    Simulator s([&]() { auto ptr = ourPm.simulate(); latch.store(ptr); });
+    Simulator s([&]() {
+        if (player.enabled())
+        {
+            //Replaying, the recording supplies every state
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return;
+        }
+        if (paused)
+        {
+            //Stop the clock so the first step after resuming does not integrate over the pause
+            ourPm.holdTime();
+            chainThen = vsg::clock::now();
+            if (dormandPrince) denseBuffer.store(ourPm.lastStep());
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return;
+        }
+        if (chainMath)
+        {
+            APP_ZONE_L2("simulate", APP_COLOR_SIMULATION);
+            //Fixed --step, otherwise the wall clock, limited so a chain too long to run in real time slows down rather than falling ever further behind
+            auto now = vsg::clock::now();
+            double elapsed = simulatorSettings.step > 0.0 ? simulatorSettings.step * simulatorSettings.substeps
+                                                          : std::min(std::chrono::duration<double>(now - chainThen).count(), 0.05);
+            chainThen = now;
+            chainMath->advance(elapsed);
+            auto& angles = chainMath->angles();
+            for (size_t i = 0; i < angles.size(); ++i) chainState[i] = static_cast<float>(angles[i]);
+            auto publishStart = HandoffStats::clock::now();
+            chainBuffer.store(chainState);
+            handoffStats.published(publishStart);
+            metrics.countSimulationStep();
+            onDemandRendering->requestFrame();
+            return;
+        }
+        if (dormandPrince)
+        {
+            //Only step once the clock reaches the end of the last step, the renderer interpolates within it
+            if (ourPm.simulationTime() > ourPm.clockTime())
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+                return;
+            }
+            APP_ZONE_L2("simulate", APP_COLOR_SIMULATION);
+            auto& step = ourPm.adaptiveStep();
+            auto publishStart = HandoffStats::clock::now();
+            denseBuffer.store(step);
+            handoffStats.published(publishStart);
+            metrics.countSimulationStep();
+            onDemandRendering->requestFrame();
+            return;
+        }
+        //Level 2 as the simulation steps far more often than frames are rendered, enable with --cpu 2
+        APP_ZONE_L2("simulate", APP_COLOR_SIMULATION);
+        if (simulatorSettings.step > 0.0) ourPm.step(simulatorSettings.step, simulatorSettings.substeps);
+        else ourPm.simulate(simulatorSettings.substeps);
+        auto timed = ourPm.timedState();
+        auto publishStart = HandoffStats::clock::now();
+        if (mutexLatch) latch.store(std::make_shared<TimedState>(timed));
+        else tripleBuffer.store(timed);
+        handoffStats.published(publishStart);
+        metrics.countSimulationStep();
+        onDemandRendering->requestFrame();
+    }, simulatorSettings);
+
+    DenseStep denseStep;
+    StateInterpolator interpolator;
+    std::vector<float> chainAngles;
+    // playback time only advances while the pendulum is not paused
+    double playbackElapsed = 0.0;
+    double lastFrameTime = 0.0;
 
     // rendering main loop
-    while (viewer->advanceToNextFrame())
+    while (benchmark.running() && onDemandRendering->advanceToNextFrame(viewer, benchmark.simulationTime()))
     {
-        auto t = std::chrono::duration<double, std::chrono::seconds::period>(vsg::clock::now() - startTime).count();
+        frameStats.beginFrame();
+
+        // on the benchmark timeline the recording is played back at the same times every run
+        auto t = benchmark.enabled() ? benchmark.simulationTime() : std::chrono::duration<double, std::chrono::seconds::period>(vsg::clock::now() - startTime).count();
+
+        {
+            APP_ZONE("entity update", APP_COLOR_UPDATE);
+            auto loadStart = HandoffStats::clock::now();
+            PData state;
+            bool fresh = false;
+            if (player.enabled())
+            {
+                if (!*pauseHandler)
+                {
+                    playbackElapsed += t - lastFrameTime;
+                    onDemandRendering->requestFrame();
+                }
+                state = player.value<PData>(player.find(player.playbackTime(playbackElapsed)));
+                fresh = true;
+            }
+            else if (cModel)
+            {
+                if (chainBuffer.load(chainAngles)) cModel->updateChain(chainAngles);
+            }
+            else if (dormandPrince)
+            {
+                //Evaluate the dense output at this frame's time rather than showing the last step's end state
+                denseBuffer.load(denseStep);
+                if (denseStep.h > 0.0)
+                {
+                    state = denseStep.evaluateNow();
+                    fresh = true;
+                }
+                // the pendulum moves between steps, so keep rendering while it runs
+                if (!*pauseHandler) onDemandRendering->requestFrame();
+            }
+            else
+            {
+                TimedState timed;
+                bool published = false;
+                if (mutexLatch)
+                {
+                    auto ptr = latch.load();
+                    if (ptr)
+                    {
+                        timed = *ptr;
+                        published = true;
+                    }
+                }
+                else
+                {
+                    published = tripleBuffer.load(timed);
+                }
+
+                if (!interpolate)
+                {
+                    state = timed.state;
+                    fresh = published;
+                }
+                else
+                {
+                    //Evaluate the pendulum at this frame's time from the last few states, so it moves smoothly between publishes
+                    if (published) interpolator.push(timed);
+                    if (!interpolator.empty() && !*pauseHandler)
+                    {
+                        state = interpolator.evaluateNow();
+                        fresh = true;
+                        onDemandRendering->requestFrame();
+                    }
+                }
+            }
+            handoffStats.loaded(loadStart);
+            if (fresh)
+            {
+                pModel.updatePendulum(state);
+                if (trail) trail->add(pModel.endPosition(state));
+                recorder.append(t, &state);
+            }
+            lastFrameTime = t;
+        }
+
+        if (fractal)
+        {
+            APP_ZONE("fractal", APP_COLOR_UPDATE);
+            fractal->update();
+        }
+
+        if (trail)
+        {
+            APP_ZONE("trail", APP_COLOR_UPDATE);
+            trail->update();
+        }
 
-        auto ptr = latch.load();
-        pModel.updatePendulum(*ptr);
+        if (ensemble && !*pauseHandler)
+        {
+            APP_ZONE("ensemble", APP_COLOR_SIMULATION);
+            ensemble->step(ensembleStep, ensembleSubsteps);
+            onDemandRendering->requestFrame();
+        }
         
         // pass any events into EventHandlers assigned to the Viewer
         viewer->handleEvents();
+        paused = *pauseHandler;
         viewer->update();
+        frameStats.mark(FrameStats::UPDATE);
+        // the stats walk is left out of the timings, it is not part of drawing the frame
+        renderStats.collect();
+        frameStats.exclude();
         viewer->recordAndSubmit();
+        frameStats.mark(FrameStats::RECORD);
         viewer->present();
+        frameStats.mark(FrameStats::PRESENT);
+        frameStats.endFrame();
+        metrics.endFrame();
+        benchmark.endFrame();
 
         numFramesCompleted += 1.0;
     }
 
     auto duration = std::chrono::duration<double, std::chrono::seconds::period>(vsg::clock::now() - startTime).count();
+
+    // stop the simulation before reporting so its numbers are final
+    s.stop();
+    if (fractal) fractal->stop();
+
     if (numFramesCompleted > 0.0)
     {
         std::cout << "Average frame rate = " << (numFramesCompleted / duration) << std::endl;
     }
+    onDemandRendering->report(std::cout);
+    frameStats.report(std::cout);
+    renderStats.report(std::cout);
+    benchmark.writeReport("vsgPendulum", frameStats, renderStats, std::cout);
+    s.report(std::cout);
+    ourPm.report(dormandPrince ? "dopri" : "rk4", std::cout);
+    if (ensemble) ensemble->report(std::cout);
+    if (chainMath) chainMath->report(std::cout);
+    if (fractal) fractal->report(std::cout);
+    if (trail) trail->report(std::cout);
+    recorder.flush();
+    recorder.report(std::cout);
+    player.report(std::cout);
+    handoffStats.report(mutexLatch ? "mutex latch" : "triple buffer", std::cout);
+    if (interpolate && !dormandPrince) interpolator.report(std::cout);
+    if (!frameStatsOptions.csvFilename.empty() && !frameStats.writeCSV(frameStatsOptions.csvFilename))
+    {
+        std::cout << "Unable to write " << frameStatsOptions.csvFilename << std::endl;
+    }
+    reportProfiler(instrumentation, profilerOptions.traceFilename, std::cout);
 
     return 0;
 }
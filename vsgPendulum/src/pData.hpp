@@ -6,4 +6,14 @@ struct PData {
 
 	float t2;
 	float p2;
-};
\ No newline at end of file
+};
+
+//Physical constants of a double pendulum, shared by pMath and the vectorised kernels
+struct PendulumConstants
+{
+    double gravity = 9.8;
+    double len1 = 1;
+    double len2 = 1;
+    double mass1 = 1;
+    double mass2 = 1;
+};
@@ -1,6 +1,61 @@
 #include "pMath.hpp"
 
-pMath::pMath(double in1, double in2)
+#include <algorithm>
+
+namespace
+{
+    //Dormand-Prince 5(4) tableau
+    const double c2 = 1.0 / 5.0, c3 = 3.0 / 10.0, c4 = 4.0 / 5.0, c5 = 8.0 / 9.0;
+    const double a21 = 1.0 / 5.0;
+    const double a31 = 3.0 / 40.0, a32 = 9.0 / 40.0;
+    const double a41 = 44.0 / 45.0, a42 = -56.0 / 15.0, a43 = 32.0 / 9.0;
+    const double a51 = 19372.0 / 6561.0, a52 = -25360.0 / 2187.0, a53 = 64448.0 / 6561.0, a54 = -212.0 / 729.0;
+    const double a61 = 9017.0 / 3168.0, a62 = -355.0 / 33.0, a63 = 46732.0 / 5247.0, a64 = 49.0 / 176.0, a65 = -5103.0 / 18656.0;
+    const double a71 = 35.0 / 384.0, a73 = 500.0 / 1113.0, a74 = 125.0 / 192.0, a75 = -2187.0 / 6784.0, a76 = 11.0 / 84.0;
+
+    //Difference between the 5th and embedded 4th order weights
+    const double e1 = 71.0 / 57600.0, e3 = -71.0 / 16695.0, e4 = 71.0 / 1920.0, e5 = -17253.0 / 339200.0, e6 = 22.0 / 525.0, e7 = -1.0 / 40.0;
+
+    //Dense output weights (Hairer, Norsett and Wanner)
+    const double d1 = -12715105075.0 / 11282082432.0, d3 = 87487479700.0 / 32700410799.0, d4 = -10690763975.0 / 1880347072.0,
+                 d5 = 701980252875.0 / 199316789632.0, d6 = -1453857185.0 / 822651844.0, d7 = 69997945.0 / 29380423.0;
+
+    double steadySeconds()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+PData DenseStep::evaluate(double t) const
+{
+    double s = h > 0.0 ? (t - t0) / h : 0.0;
+    double s1 = 1.0 - s;
+
+    double y[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        y[i] = coefficients[0][i] + s * (coefficients[1][i] + s1 * (coefficients[2][i] + s * (coefficients[3][i] + s1 * coefficients[4][i])));
+    }
+
+    PData result;
+    result.t = static_cast<float>(y[0]);
+    result.p = static_cast<float>(y[1]);
+    result.t2 = static_cast<float>(y[2]);
+    result.p2 = static_cast<float>(y[3]);
+    return result;
+}
+
+PData DenseStep::evaluateNow() const
+{
+    return evaluate(steadySeconds() - clockOffset);
+}
+
+pMath::pMath(double in1, double in2, const PendulumConstants& constants) :
+    gravity(constants.gravity),
+    len1(constants.len1),
+    len2(constants.len2),
+    mass1(constants.mass1),
+    mass2(constants.mass2)
 {
     start_time = std::chrono::steady_clock::now();
     now = 0;
@@ -8,17 +63,38 @@ pMath::pMath(double in1, double in2)
     phi = 0;
     theta2 = in2;
     phi2 = 0;
+    initialEnergy = energy();
 }
 
-std::shared_ptr<PData> pMath::simulate()
+const PData& pMath::simulate(int substeps)
 {
     using namespace std;
 
-    auto ptr = make_shared<PData>();
+    //The clock leaves out pauses, so the first call after one only integrates the time since it ended
     then = now;
-    now = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
-    auto h = then - now;
+    now = clockTime();
+    auto h = now - then;
+
+    return step(h / substeps, substeps);
+}
 
+const PData& pMath::step(double h, int substeps)
+{
+    resumeTime();
+    for (int i = 0; i < substeps; ++i) integrate(h);
+
+    //Store states into export structure
+    state.t = theta;
+    state.p = phi;
+    state.t2 = theta2;
+    state.p2 = phi2;
+
+    //Return export structure
+    return state;
+}
+
+void pMath::integrate(double h)
+{
     //Pendulum 1
     thetapp = RK4(h, theta, [&](PData dfRK4) -> double {return pen1_1(dfRK4);});
     phipp = RK4(h, phi, [&](PData dfRK4) -> double {return pen1_2(dfRK4);});
@@ -33,14 +109,156 @@ std::shared_ptr<PData> pMath::simulate()
     theta2 = thetapp2;
     phi2 = phipp2;
 
-    //Store states into export structure
-    ptr->t = theta;
-    ptr->p = phi;
-    ptr->t2 = theta2;
-    ptr->p2 = phi2;
+    time += h;
+    ++steps;
+    evaluations += 4;
+}
 
-    //Return export structure
-    return ptr;
+TimedState pMath::timedState() const
+{
+    TimedState timed;
+    timed.time = time;
+    timed.clockOffset = steadySeconds() - time;
+    timed.state = state;
+    return timed;
+}
+
+void pMath::holdTime()
+{
+    //Only the first paused tick starts the pause, the rest just keep the dense output pinned to it
+    if (!holding)
+    {
+        pauseStart = std::chrono::steady_clock::now();
+        holding = true;
+    }
+
+    dense.clockOffset = steadySeconds() - clockTime();
+}
+
+void pMath::resumeTime()
+{
+    if (!holding) return;
+
+    pausedTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - pauseStart).count();
+    holding = false;
+}
+
+double pMath::clockTime() const
+{
+    //While paused the clock stays where the pause started
+    auto current = holding ? pauseStart : std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(current - start_time).count() - pausedTime;
+}
+
+const DenseStep& pMath::adaptiveStep()
+{
+    resumeTime();
+
+    double y[4] = {theta, phi, theta2, phi2};
+    if (!haveDerivative)
+    {
+        derivatives(y, k[0]);
+        ++evaluations;
+        haveDerivative = true;
+    }
+
+    double yt[4], y1[4];
+    for (;;)
+    {
+        double h = std::min(nextStep, maxStep);
+
+        for (int i = 0; i < 4; ++i) yt[i] = y[i] + h * a21 * k[0][i];
+        derivatives(yt, k[1]);
+        for (int i = 0; i < 4; ++i) yt[i] = y[i] + h * (a31 * k[0][i] + a32 * k[1][i]);
+        derivatives(yt, k[2]);
+        for (int i = 0; i < 4; ++i) yt[i] = y[i] + h * (a41 * k[0][i] + a42 * k[1][i] + a43 * k[2][i]);
+        derivatives(yt, k[3]);
+        for (int i = 0; i < 4; ++i) yt[i] = y[i] + h * (a51 * k[0][i] + a52 * k[1][i] + a53 * k[2][i] + a54 * k[3][i]);
+        derivatives(yt, k[4]);
+        for (int i = 0; i < 4; ++i) yt[i] = y[i] + h * (a61 * k[0][i] + a62 * k[1][i] + a63 * k[2][i] + a64 * k[3][i] + a65 * k[4][i]);
+        derivatives(yt, k[5]);
+        for (int i = 0; i < 4; ++i) y1[i] = y[i] + h * (a71 * k[0][i] + a73 * k[2][i] + a74 * k[3][i] + a75 * k[4][i] + a76 * k[5][i]);
+        derivatives(y1, k[6]);
+        evaluations += 6;
+
+        //RMS of the local error estimate scaled by the tolerance
+        double error = 0.0;
+        for (int i = 0; i < 4; ++i)
+        {
+            double estimate = h * (e1 * k[0][i] + e3 * k[2][i] + e4 * k[3][i] + e5 * k[4][i] + e6 * k[5][i] + e7 * k[6][i]);
+            double scale = tolerance * (1.0 + std::max(std::abs(y[i]), std::abs(y1[i])));
+            error += (estimate / scale) * (estimate / scale);
+        }
+        error = std::sqrt(error / 4.0);
+
+        //Standard controller, grow by at most 5x and shrink by at most 5x per attempt
+        double factor = error > 0.0 ? 0.9 * std::pow(error, -0.2) : 5.0;
+        nextStep = h * std::clamp(factor, 0.2, 5.0);
+
+        if (error > 1.0)
+        {
+            ++rejectedSteps;
+            continue;
+        }
+
+        dense.t0 = time;
+        dense.h = h;
+        for (int i = 0; i < 4; ++i)
+        {
+            double difference = y1[i] - y[i];
+            double slope = h * k[0][i] - difference;
+            dense.coefficients[0][i] = y[i];
+            dense.coefficients[1][i] = difference;
+            dense.coefficients[2][i] = slope;
+            dense.coefficients[3][i] = difference - h * k[6][i] - slope;
+            dense.coefficients[4][i] = h * (d1 * k[0][i] + d3 * k[2][i] + d4 * k[3][i] + d5 * k[4][i] + d6 * k[5][i] + d7 * k[6][i]);
+        }
+
+        //First same as last, the derivative at the end of this step starts the next one
+        for (int i = 0; i < 4; ++i) k[0][i] = k[6][i];
+
+        theta = y1[0];
+        phi = y1[1];
+        theta2 = y1[2];
+        phi2 = y1[3];
+        time += h;
+        ++steps;
+
+        dense.clockOffset = steadySeconds() - clockTime();
+        return dense;
+    }
+}
+
+void pMath::derivatives(const double y[4], double dy[4]) const
+{
+    double dtheta = y[0] - y[2];
+    double sd = std::sin(dtheta), cd = std::cos(dtheta);
+    double M = mass1 + mass2;
+    double den = mass1 + mass2 * sd * sd;
+
+    dy[0] = y[1];
+    dy[1] = (-sd * (mass2 * len1 * y[1] * y[1] * cd + mass2 * len2 * y[3] * y[3]) - gravity * (M * std::sin(y[0]) - mass2 * std::sin(y[2]) * cd)) / (len1 * den);
+    dy[2] = y[3];
+    dy[3] = (sd * (M * len1 * y[1] * y[1] + mass2 * len2 * y[3] * y[3] * cd) + gravity * (M * std::sin(y[0]) * cd - M * std::sin(y[2]))) / (len2 * den);
+}
+
+double pMath::energy() const
+{
+    double M = mass1 + mass2;
+    double kinetic = 0.5 * M * len1 * len1 * phi * phi + 0.5 * mass2 * len2 * len2 * phi2 * phi2 + mass2 * len1 * len2 * phi * phi2 * std::cos(theta - theta2);
+    double potential = -M * gravity * len1 * std::cos(theta) - mass2 * gravity * len2 * std::cos(theta2);
+    return kinetic + potential;
+}
+
+void pMath::report(const char* name, std::ostream& out) const
+{
+    if (steps == 0) return;
+
+    double drift = energy() - initialEnergy;
+    out << "pMath (" << name << "): " << steps << " steps";
+    if (rejectedSteps > 0) out << " (" << rejectedSteps << " rejected)";
+    out << ", " << evaluations << " derivative evaluations, mean step " << time / static_cast<double>(steps) << " s over " << time
+        << " s, energy drift " << drift << " J (" << (initialEnergy != 0.0 ? drift / std::abs(initialEnergy) : drift) << " relative)" << std::endl;
 }
 
 double pMath::RK4(double h, double r_n, std::function<double(PData)> func)
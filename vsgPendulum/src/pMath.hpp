@@ -2,23 +2,84 @@
 
 #include <cmath>
 #include <chrono>
+#include <cstdint>
 #include <functional>
-#include <memory>
+#include <iostream>
 
 #include "pData.hpp"
 
+//One accepted Dormand-Prince step and its dense output
+//The state at any time in [t0, t0 + h] can be evaluated from it to 4th order without another derivative evaluation
+struct DenseStep
+{
+    double t0 = 0.0;
+    double h = 0.0;
+    //Steady clock seconds minus simulation time when the step was taken, so the renderer can map frame times onto it
+    double clockOffset = 0.0;
+    double coefficients[5][4];
+
+    //State at simulation time t, slightly outside the step the polynomial is extrapolated
+    PData evaluate(double t) const;
+
+    //State at the current wall clock time
+    PData evaluateNow() const;
+};
+
+//A published state stamped with the simulation time it belongs to
+//clockOffset is steady clock seconds minus that time when it was reached, so the renderer can map the present onto it
+struct TimedState
+{
+    double time = 0.0;
+    double clockOffset = 0.0;
+    PData state{};
+};
+
 //Struct storing the relative (to the anchor point) positions of both pendulums as t (theta)
 //p (phi) is the time derivative of t
 //This is used for exporting our states from the thread
 //This is also used to pass modified states into RK4 function calls
 class pMath {
 public:
-    //Feed initial conditions to math model
-    pMath(double in1, double in2);
+    //Feed initial conditions to math model, the constants default to the 1 m, 1 kg pendulum the app shows
+    pMath(double in1, double in2, const PendulumConstants& constants = PendulumConstants());
 
     //Repesents one time unit pendulum calculation
-    //Passed to generic thread creator
-    std::shared_ptr<PData> simulate();
+    //Passed to generic thread creator, integrates over the wall clock time since the last call in substeps steps
+    //The returned state is valid until the next call
+    const PData& simulate(int substeps = 1);
+
+    //Advance by substeps integration steps of h seconds, independent of the wall clock
+    const PData& step(double h, int substeps = 1);
+
+    //The state of the last simulate() or step() call with its simulation time
+    TimedState timedState() const;
+
+    //Stop the clock without integrating, called on every tick the simulation is paused
+    //The next simulate(), step() or adaptiveStep() restarts it where it stopped
+    void holdTime();
+
+    //Relative error allowed per adaptive step
+    double tolerance = 1e-8;
+
+    //Largest adaptive step in seconds, keeps the dense output from running far ahead of the renderer
+    double maxStep = 0.1;
+
+    //One adaptive Dormand-Prince (RK45) step, as large as the error tolerance allows
+    //The returned step is valid until the next call
+    const DenseStep& adaptiveStep();
+
+    //The last adaptive step, its clock offset kept up to date by holdTime()
+    const DenseStep& lastStep() const { return dense; }
+
+    //Simulated time and wall clock time since construction, less any time spent paused
+    double simulationTime() const { return time; }
+    double clockTime() const;
+
+    //Total mechanical energy of the current state
+    double energy() const;
+
+    //Steps, derivative evaluations and energy drift since construction
+    void report(const char* name, std::ostream& out) const;
 private:
     //Stores the state of the system
     double theta;
@@ -37,17 +98,44 @@ private:
 
     PData tempState;
 
+    //One RK4 step of every state variable
+    void integrate(double h);
+
+    //Derivatives of (theta, phi, theta2, phi2) in double precision for the adaptive stepper
+    void derivatives(const double y[4], double dy[4]) const;
+
     //Time variables used to time the last calcution
     std::chrono::steady_clock::time_point start_time;
     double then;
     double now;
+
+    //Seconds spent in pauses that have ended, and when the current one started
+    double pausedTime = 0.0;
+    bool holding = false;
+    std::chrono::steady_clock::time_point pauseStart;
+
+    //Ends a pause begun by holdTime(), adding its length to pausedTime once
+    void resumeTime();
+
+    //Adaptive stepper state, k[0] holds the derivative at the current state (first same as last)
+    double time = 0.0;
+    double nextStep = 1e-3;
+    bool haveDerivative = false;
+    double k[7][4];
+    DenseStep dense;
+
+    //Counters for report()
+    uint64_t steps = 0;
+    uint64_t rejectedSteps = 0;
+    uint64_t evaluations = 0;
+    double initialEnergy;
     
     //Constants of the simulation
-    const double gravity = 9.8;
-    const double len1 = 1;
-    const double len2 = 1;
-    const double mass1 = 1;
-    const double mass2 = 1;
+    const double gravity;
+    const double len1;
+    const double len2;
+    const double mass1;
+    const double mass2;
 
     //Runge Kutta 4 function
     double RK4(double h, double r_n, std::function<double(PData)> func);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "pData.hpp"
+#include "simd.hpp"
+
+//The pMath double pendulum equations written once for any of the simd types, used by the ensemble and the flip fractal
+namespace pendulum
+{
+    template <class V>
+    struct Coefficients
+    {
+        V gravity, len1, len2, mass1, mass2, massSum;
+
+        Coefficients(const PendulumConstants& c) :
+            gravity(V::set(c.gravity)), len1(V::set(c.len1)), len2(V::set(c.len2)), mass1(V::set(c.mass1)), mass2(V::set(c.mass2)), massSum(V::set(c.mass1 + c.mass2)) {}
+    };
+
+    //Angular accelerations of both links, the same equations as pMath::pen1_2 and pMath::pen2_2
+    template <class V>
+    inline void accelerations(const Coefficients<V>& k, V t1, V w1, V t2, V w2, V& a1, V& a2)
+    {
+        V sd, cd, s1, c1, s2, c2;
+        simd::sincos(t1 - t2, sd, cd);
+        simd::sincos(t1, s1, c1);
+        simd::sincos(t2, s2, c2);
+
+        V w1sq = w1 * w1;
+        V w2sq = w2 * w2;
+        V den = fma(k.mass2 * sd, sd, k.mass1);
+
+        a1 = (V::set(0.0) - sd * (k.mass2 * k.len1 * w1sq * cd + k.mass2 * k.len2 * w2sq) - k.gravity * (k.massSum * s1 - k.mass2 * s2 * cd)) / (k.len1 * den);
+        a2 = (sd * (k.massSum * k.len1 * w1sq + k.mass2 * k.len2 * w2sq * cd) + k.gravity * (k.massSum * s1 * cd - k.massSum * s2)) / (k.len2 * den);
+    }
+
+    //Classic RK4 on the coupled state (theta1, omega1, theta2, omega2), every stage sees all four updated variables
+    template <class V>
+    inline void rk4(const Coefficients<V>& k, V h, int substeps, V& t1, V& w1, V& t2, V& w2)
+    {
+        V halfH = h * V::set(0.5);
+        V sixthH = h * V::set(1.0 / 6.0);
+        V two = V::set(2.0);
+
+        for (int s = 0; s < substeps; ++s)
+        {
+            V k1a1, k1a2;
+            accelerations(k, t1, w1, t2, w2, k1a1, k1a2);
+
+            V w1b = fma(halfH, k1a1, w1), w2b = fma(halfH, k1a2, w2);
+            V k2a1, k2a2;
+            accelerations(k, fma(halfH, w1, t1), w1b, fma(halfH, w2, t2), w2b, k2a1, k2a2);
+
+            V w1c = fma(halfH, k2a1, w1), w2c = fma(halfH, k2a2, w2);
+            V k3a1, k3a2;
+            accelerations(k, fma(halfH, w1b, t1), w1c, fma(halfH, w2b, t2), w2c, k3a1, k3a2);
+
+            V w1d = fma(h, k3a1, w1), w2d = fma(h, k3a2, w2);
+            V k4a1, k4a2;
+            accelerations(k, fma(h, w1c, t1), w1d, fma(h, w2c, t2), w2d, k4a1, k4a2);
+
+            t1 = fma(sixthH, w1 + two * (w1b + w1c) + w1d, t1);
+            t2 = fma(sixthH, w2 + two * (w2b + w2c) + w2d, t2);
+            w1 = fma(sixthH, k1a1 + two * (k2a1 + k3a1) + k4a1, w1);
+            w2 = fma(sixthH, k1a2 + two * (k2a2 + k3a2) + k4a2, w2);
+        }
+    }
+}
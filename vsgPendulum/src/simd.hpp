@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#    include <immintrin.h>
+#endif
+
+//Minimal double precision vector types so a kernel can be written once as a template and instantiated
+//for plain doubles, AVX2 (4 lanes) and AVX-512 (8 lanes)
+//Only what the pendulum kernels need: arithmetic, fused multiply add, floor, abs, a lane compare and sincos
+namespace simd
+{
+    struct Scalar
+    {
+        static constexpr int width = 1;
+        static constexpr const char* name = "scalar";
+
+        double v;
+
+        static Scalar set(double x) { return {x}; }
+        static Scalar load(const double* p) { return {*p}; }
+        void store(double* p) const { *p = v; }
+
+        friend Scalar operator+(Scalar a, Scalar b) { return {a.v + b.v}; }
+        friend Scalar operator-(Scalar a, Scalar b) { return {a.v - b.v}; }
+        friend Scalar operator*(Scalar a, Scalar b) { return {a.v * b.v}; }
+        friend Scalar operator/(Scalar a, Scalar b) { return {a.v / b.v}; }
+        friend Scalar fma(Scalar a, Scalar b, Scalar c) { return {a.v * b.v + c.v}; }
+        friend Scalar floor(Scalar a) { return {std::floor(a.v)}; }
+        friend Scalar abs(Scalar a) { return {std::abs(a.v)}; }
+        //Bit l set where lane l of a is greater than lane l of b
+        friend int greaterMask(Scalar a, Scalar b) { return a.v > b.v ? 1 : 0; }
+    };
+
+#if defined(__AVX2__) && defined(__FMA__)
+    struct Avx2
+    {
+        static constexpr int width = 4;
+        static constexpr const char* name = "AVX2";
+
+        __m256d v;
+
+        static Avx2 set(double x) { return {_mm256_set1_pd(x)}; }
+        static Avx2 load(const double* p) { return {_mm256_loadu_pd(p)}; }
+        void store(double* p) const { _mm256_storeu_pd(p, v); }
+
+        friend Avx2 operator+(Avx2 a, Avx2 b) { return {_mm256_add_pd(a.v, b.v)}; }
+        friend Avx2 operator-(Avx2 a, Avx2 b) { return {_mm256_sub_pd(a.v, b.v)}; }
+        friend Avx2 operator*(Avx2 a, Avx2 b) { return {_mm256_mul_pd(a.v, b.v)}; }
+        friend Avx2 operator/(Avx2 a, Avx2 b) { return {_mm256_div_pd(a.v, b.v)}; }
+        friend Avx2 fma(Avx2 a, Avx2 b, Avx2 c) { return {_mm256_fmadd_pd(a.v, b.v, c.v)}; }
+        friend Avx2 floor(Avx2 a) { return {_mm256_floor_pd(a.v)}; }
+        friend Avx2 abs(Avx2 a) { return {_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)}; }
+        friend int greaterMask(Avx2 a, Avx2 b) { return _mm256_movemask_pd(_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ)); }
+    };
+#endif
+
+#if defined(__AVX512F__)
+    struct Avx512
+    {
+        static constexpr int width = 8;
+        static constexpr const char* name = "AVX-512";
+
+        __m512d v;
+
+        static Avx512 set(double x) { return {_mm512_set1_pd(x)}; }
+        static Avx512 load(const double* p) { return {_mm512_loadu_pd(p)}; }
+        void store(double* p) const { _mm512_storeu_pd(p, v); }
+
+        friend Avx512 operator+(Avx512 a, Avx512 b) { return {_mm512_add_pd(a.v, b.v)}; }
+        friend Avx512 operator-(Avx512 a, Avx512 b) { return {_mm512_sub_pd(a.v, b.v)}; }
+        friend Avx512 operator*(Avx512 a, Avx512 b) { return {_mm512_mul_pd(a.v, b.v)}; }
+        friend Avx512 operator/(Avx512 a, Avx512 b) { return {_mm512_div_pd(a.v, b.v)}; }
+        friend Avx512 fma(Avx512 a, Avx512 b, Avx512 c) { return {_mm512_fmadd_pd(a.v, b.v, c.v)}; }
+        friend Avx512 floor(Avx512 a) { return {_mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)}; }
+        friend Avx512 abs(Avx512 a) { return {_mm512_abs_pd(a.v)}; }
+        friend int greaterMask(Avx512 a, Avx512 b) { return static_cast<int>(_mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ)); }
+    };
+#endif
+
+    //Widest type the compiler was allowed to use, pass -march=native (PENDULUM_NATIVE_ARCH) to get the SIMD ones
+#if defined(__AVX512F__)
+    using Widest = Avx512;
+#elif defined(__AVX2__) && defined(__FMA__)
+    using Widest = Avx2;
+#else
+    using Widest = Scalar;
+#endif
+
+    //sin and cos together, Cody-Waite reduction to [-pi/4, pi/4] then the Cephes polynomials
+    //Branch free so every lane takes the same path, accurate to a few ulp for |x| < 1e6
+    template <class V>
+    inline void sincos(V x, V& s, V& c)
+    {
+        V q = floor(fma(x, V::set(0.63661977236758134308), V::set(0.5)));
+
+        V r = fma(q, V::set(-1.57079625129699707031), x);
+        r = fma(q, V::set(-7.54978941586159635336e-8), r);
+        r = fma(q, V::set(-5.39030285815811905290e-15), r);
+        V z = r * r;
+
+        V ps = V::set(1.58962301576546568060e-10);
+        ps = fma(ps, z, V::set(-2.50507477628578072866e-8));
+        ps = fma(ps, z, V::set(2.75573136213857245213e-6));
+        ps = fma(ps, z, V::set(-1.98412698295895385996e-4));
+        ps = fma(ps, z, V::set(8.33333333332211858878e-3));
+        ps = fma(ps, z, V::set(-1.66666666666666307295e-1));
+        V sr = fma(r * z, ps, r);
+
+        V pc = V::set(-1.13585365213876817300e-11);
+        pc = fma(pc, z, V::set(2.08757008419747316778e-9));
+        pc = fma(pc, z, V::set(-2.75573141792967388112e-7));
+        pc = fma(pc, z, V::set(2.48015872888517045348e-5));
+        pc = fma(pc, z, V::set(-1.38888888888730564116e-3));
+        pc = fma(pc, z, V::set(4.16666666666665929218e-2));
+        V cr = fma(z * z, pc, fma(z, V::set(-0.5), V::set(1.0)));
+
+        //Quadrant q mod 4 picks which polynomial and sign each result takes, done arithmetically rather than with masks
+        V half = V::set(0.5), quarter = V::set(0.25), one = V::set(1.0), two = V::set(2.0), four = V::set(4.0);
+        V quadrant = q - four * floor(q * quarter);
+        V swap = quadrant - two * floor(quadrant * half);
+        V sinSign = one - two * floor(quadrant * half);
+        V next = quadrant + one;
+        V cosSign = one - two * floor((next - four * floor(next * quarter)) * half);
+
+        s = sinSign * fma(swap, cr - sr, sr);
+        c = cosSign * fma(swap, sr - cr, cr);
+    }
+}
@@ -0,0 +1,114 @@
+#include "simulator.hpp"
+
+#include <algorithm>
+
+#ifdef __linux__
+#    include <pthread.h>
+#    include <sched.h>
+#endif
+
+void SimulatorSettings::read(vsg::CommandLine& arguments)
+{
+    arguments.read("--step", step);
+    arguments.read("--substeps", substeps);
+    arguments.read("--rate", rate);
+    arguments.read("--sim-cpu", cpu);
+    arguments.read("--sim-priority", priority);
+    substeps = std::max(substeps, 1);
+}
+
+Simulator::Simulator(Callback _callback, const SimulatorSettings& _settings) :
+    callback(_callback), settings(_settings), die(false), ticks(0), overruns(0), start(clock::now())
+{
+	//Create thread
+    tid = std::thread([this]() { this->worker(); });
+}
+
+Simulator::~Simulator()
+{
+    stop();
+}
+
+void Simulator::stop()
+{
+    die.store(true, std::memory_order_release);
+    if (tid.joinable()) tid.join();
+}
+
+void Simulator::configureThread()
+{
+#ifdef __linux__
+    if (settings.cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(settings.cpu, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+        {
+            std::cout << "Simulator: unable to pin the simulation thread to cpu " << settings.cpu << std::endl;
+        }
+    }
+
+    if (settings.priority > 0)
+    {
+        sched_param param{};
+        param.sched_priority = std::min(settings.priority, sched_get_priority_max(SCHED_FIFO));
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+        {
+            std::cout << "Simulator: unable to set SCHED_FIFO priority " << settings.priority << ", needs CAP_SYS_NICE" << std::endl;
+        }
+    }
+#else
+    if (settings.cpu >= 0 || settings.priority > 0) std::cout << "Simulator: --sim-cpu and --sim-priority are only supported on Linux" << std::endl;
+#endif
+}
+
+void Simulator::worker()
+{
+    configureThread();
+
+    auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(settings.rate > 0.0 ? 1.0 / settings.rate : 0.0));
+    auto next = clock::now();
+
+    while (!die.load(std::memory_order_acquire))
+    {
+        callback();
+        ticks.fetch_add(1, std::memory_order_relaxed);
+
+        if (period.count() > 0)
+        {
+            next += period;
+            auto now = clock::now();
+            if (now > next)
+            {
+                //Behind schedule, start again from now rather than bursting to catch up
+                overruns.fetch_add(1, std::memory_order_relaxed);
+                next = now;
+            }
+            else
+            {
+                sleepUntil(next);
+            }
+        }
+    }
+}
+
+void Simulator::sleepUntil(clock::time_point time)
+{
+    const auto spin = std::chrono::microseconds(200);
+    auto now = clock::now();
+    if (time - now > spin) std::this_thread::sleep_until(time - spin);
+    while (clock::now() < time && !die.load(std::memory_order_relaxed)) std::this_thread::yield();
+}
+
+void Simulator::report(std::ostream& out) const
+{
+    double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    uint64_t count = ticks.load(std::memory_order_relaxed);
+
+    out << "Simulator: " << static_cast<double>(count) / seconds << " states/s";
+    if (settings.rate > 0.0) out << " (target " << settings.rate << ", " << overruns.load(std::memory_order_relaxed) << " late)";
+    if (settings.step > 0.0) out << ", fixed step " << settings.step << " s";
+    else out << ", wall clock step";
+    out << " x " << settings.substeps << " substeps" << std::endl;
+}
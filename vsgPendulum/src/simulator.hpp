@@ -0,0 +1,56 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+//How the simulation thread steps, read from the command line
+struct SimulatorSettings
+{
+    double step = 0.0;  //fixed integration step in seconds, 0 integrates over the wall clock time since the last step
+    int substeps = 1;   //integration steps per published state
+    double rate = 0.0;  //published states per second, 0 runs flat out
+    int cpu = -1;       //core the simulation thread is pinned to, -1 leaves it to the OS
+    int priority = 0;   //real time (SCHED_FIFO) priority of the simulation thread, 0 leaves it at the default
+
+    //--step h, --substeps n, --rate hz, --sim-cpu n and --sim-priority p
+    void read(vsg::CommandLine& arguments);
+};
+
+//Generic thread wrapper
+//Calls the callback once per published state, at the settings' rate when one is given
+class Simulator {
+public:
+    using Callback = std::function<void ()>;
+    using clock = std::chrono::steady_clock;
+
+	//Construct std function from provided callable
+    Simulator(Callback _callback, const SimulatorSettings& _settings = {});
+    ~Simulator();
+
+    //Ask the thread to finish after the current callback and wait for it
+    void stop();
+
+    //Achieved rate and how often the callback ran past its slot
+    void report(std::ostream& out) const;
+
+private:
+	//Generic run loop that pMath exists in
+    void worker();
+
+    //Sleep most of the way and spin for the rest, sleep_until alone overshoots by up to a scheduler tick
+    void sleepUntil(clock::time_point time);
+
+    void configureThread();
+
+    Callback callback;
+    SimulatorSettings settings;
+    std::atomic<bool> die;
+    std::atomic<uint64_t> ticks;
+    std::atomic<uint64_t> overruns;
+    clock::time_point start;
+    std::thread tid;
+};
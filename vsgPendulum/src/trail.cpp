@@ -0,0 +1,213 @@
+#include "trail.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    //Ring index and age of each point from the block it is drawn in (the instance) and its place in the block
+    const char* trail_vert = R"(
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(push_constant) uniform PushConstants {
+    mat4 projection;
+    mat4 modelView;
+} pc;
+
+//x next index to write, y number of points held, z capacity, w block size
+layout(set = 0, binding = 0) uniform Ring {
+    uvec4 ring;
+};
+
+layout(location = 0) in vec3 vsg_Vertex;
+
+layout(location = 0) out float age;
+layout(location = 1) flat out float segmentAge;
+
+out gl_PerVertex {
+    vec4 gl_Position;
+};
+
+void main()
+{
+    uint index = (uint(gl_InstanceIndex) * ring.w + uint(gl_VertexIndex)) % ring.z;
+    age = float((ring.x + ring.z - 1u - index) % ring.z);
+    segmentAge = age;
+    gl_Position = (pc.projection * pc.modelView) * vec4(vsg_Vertex, 1.0);
+}
+)";
+
+    const char* trail_frag = R"(
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(set = 0, binding = 0) uniform Ring {
+    uvec4 ring;
+};
+
+layout(set = 0, binding = 1) uniform Colour {
+    vec4 color;
+};
+
+layout(location = 0) in float age;
+layout(location = 1) flat in float segmentAge;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    //Ages fall by one along every segment except the one from the newest point back to the oldest where the ring wraps,
+    //segmentAge comes from the segment's first point so that one is the only place age climbs above it
+    if (age > segmentAge + 0.5) discard;
+
+    float fade = 1.0 - age / float(max(ring.y, 1u));
+    outColor = vec4(color.rgb, color.a * fade * fade);
+}
+)";
+}
+
+Trail::Trail(uint32_t _capacity, uint32_t _blockSize) :
+    blockSize(std::max(_blockSize, 2u)),
+    capacity(std::max((_capacity + blockSize - 1) / blockSize, 1u) * blockSize)
+{
+    uint32_t numBlocks = capacity / blockSize;
+    for (uint32_t k = 0; k < numBlocks; ++k)
+    {
+        //One extra point for the first point of the next block
+        auto block = vsg::vec3Array::create(blockSize + 1);
+        block->properties.dataVariance = vsg::DYNAMIC_DATA;
+        blocks.push_back(block);
+    }
+    written.assign(numBlocks, 0);
+
+    ring = vsg::uivec4Value::create(vsg::uivec4(0, 0, capacity, blockSize));
+    ring->properties.dataVariance = vsg::DYNAMIC_DATA;
+}
+
+vsg::ref_ptr<vsg::Node> Trail::createModel()
+{
+    auto vertexShader = vsg::ShaderStage::create(VK_SHADER_STAGE_VERTEX_BIT, "main", trail_vert);
+    auto fragmentShader = vsg::ShaderStage::create(VK_SHADER_STAGE_FRAGMENT_BIT, "main", trail_frag);
+
+    vsg::DescriptorSetLayoutBindings descriptorBindings{
+        {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+        {1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}};
+    auto descriptorSetLayout = vsg::DescriptorSetLayout::create(descriptorBindings);
+
+    //Projection and modelView matrices, pushed by vsg
+    vsg::PushConstantRanges pushConstantRanges{{VK_SHADER_STAGE_VERTEX_BIT, 0, 128}};
+    auto pipelineLayout = vsg::PipelineLayout::create(vsg::DescriptorSetLayouts{descriptorSetLayout}, pushConstantRanges);
+
+    vsg::VertexInputState::Bindings vertexBindings{VkVertexInputBindingDescription{0, sizeof(vsg::vec3), VK_VERTEX_INPUT_RATE_VERTEX}};
+    vsg::VertexInputState::Attributes vertexAttributes{VkVertexInputAttributeDescription{0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0}};
+
+    auto inputAssemblyState = vsg::InputAssemblyState::create();
+    inputAssemblyState->topology = VK_PRIMITIVE_TOPOLOGY_LINE_STRIP;
+
+    auto rasterizationState = vsg::RasterizationState::create();
+    rasterizationState->cullMode = VK_CULL_MODE_NONE;
+
+    //Blend over the scene and leave depth alone, the faded tail would otherwise hide whatever is behind it
+    auto colorBlendState = vsg::ColorBlendState::create();
+    colorBlendState->attachments = vsg::ColorBlendState::ColorBlendAttachments{
+        {VK_TRUE, VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+         VK_BLEND_OP_ADD, VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT}};
+
+    auto depthStencilState = vsg::DepthStencilState::create();
+    depthStencilState->depthWriteEnable = VK_FALSE;
+
+    vsg::GraphicsPipelineStates pipelineStates{
+        vsg::VertexInputState::create(vertexBindings, vertexAttributes),
+        inputAssemblyState,
+        rasterizationState,
+        vsg::MultisampleState::create(),
+        colorBlendState,
+        depthStencilState};
+
+    auto pipeline = vsg::GraphicsPipeline::create(pipelineLayout, vsg::ShaderStages{vertexShader, fragmentShader}, pipelineStates);
+
+    auto ringBuffer = vsg::DescriptorBuffer::create(ring, 0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+    auto colorBuffer = vsg::DescriptorBuffer::create(vsg::vec4Value::create(color), 1, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+    auto descriptorSet = vsg::DescriptorSet::create(descriptorSetLayout, vsg::Descriptors{ringBuffer, colorBuffer});
+
+    auto stateGroup = vsg::StateGroup::create();
+    stateGroup->add(vsg::BindGraphicsPipeline::create(pipeline));
+    stateGroup->add(vsg::BindDescriptorSet::create(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, descriptorSet));
+
+    //The block index goes in as the instance so the shader can find each point's ring index
+    for (uint32_t k = 0; k < blocks.size(); ++k)
+    {
+        auto draw = vsg::VertexDraw::create();
+        draw->assignArrays(vsg::DataList{blocks[k]});
+        draw->vertexCount = 0;
+        draw->instanceCount = 1;
+        draw->firstVertex = 0;
+        draw->firstInstance = k;
+        stateGroup->addChild(draw);
+        draws.push_back(draw);
+    }
+
+    std::cout << "Trail: " << capacity << " points in " << blocks.size() << " blocks of " << blockSize << std::endl;
+
+    return stateGroup;
+}
+
+void Trail::add(const vsg::vec3& point)
+{
+    if (count > 0 && vsg::length(point - last) < minSpacing) return;
+
+    uint32_t numBlocks = static_cast<uint32_t>(blocks.size());
+    uint32_t k = head / blockSize;
+    uint32_t slot = head % blockSize;
+    blocks[k]->at(slot) = point;
+    written[k] = 1;
+
+    //The first point of a block also ends the strip of the block before it
+    if (slot == 0)
+    {
+        uint32_t previous = (k + numBlocks - 1) % numBlocks;
+        blocks[previous]->at(blockSize) = point;
+        written[previous] = 1;
+    }
+
+    head = (head + 1) % capacity;
+    count = std::min(count + 1, capacity);
+    last = point;
+    ++points;
+}
+
+void Trail::update()
+{
+    bool changed = false;
+    for (uint32_t k = 0; k < blocks.size(); ++k)
+    {
+        if (!written[k]) continue;
+
+        blocks[k]->dirty();
+        written[k] = 0;
+        changed = true;
+        ++blockUploads;
+    }
+    ++updates;
+    if (!changed) return;
+
+    //Until the ring fills, only draw the points written so far, each block's last point once the next block starts
+    for (uint32_t k = 0; k < draws.size(); ++k)
+    {
+        uint32_t first = k * blockSize;
+        if (count == capacity) draws[k]->vertexCount = blockSize + 1;
+        else draws[k]->vertexCount = count > first ? std::min(count - first, blockSize + 1) : 0;
+    }
+
+    ring->value() = vsg::uivec4(head, count, capacity, blockSize);
+    ring->dirty();
+}
+
+void Trail::report(std::ostream& out) const
+{
+    if (updates == 0) return;
+
+    out << "Trail: " << points << " points added, " << count << " of " << capacity << " shown, "
+        << static_cast<double>(blockUploads) / static_cast<double>(updates) << " blocks of " << blockSize
+        << " uploaded per frame on average out of " << blocks.size() << std::endl;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vsg/all.h>
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+//Fading line strip behind a moving point, kept in a ring of capacity points that is written in place
+//The ring is split into blocks, each its own DYNAMIC_DATA vec3Array drawn as one instance of a line strip, so a frame
+//only uploads the blocks it wrote to. Each block repeats the first point of the next one so the strip joins up
+//The shader works out every point's age from its ring index, with the head and count in a uniform, and fades it out
+class Trail : public vsg::Inherit<vsg::Object, Trail>
+{
+public:
+    //Capacity is rounded up to a whole number of blocks
+    Trail(uint32_t _capacity, uint32_t _blockSize = 1024);
+
+    const uint32_t blockSize;
+    const uint32_t capacity;
+
+    //Colour of the newest point, older ones fade to transparent
+    vsg::vec4 color{1.0f, 0.55f, 0.1f, 1.0f};
+
+    //Points closer than this to the last one are skipped, so a slow or paused bob does not use up the ring
+    float minSpacing = 0.5f;
+
+    //Line strips with their own pipeline, add after the opaque scene as the trail is blended without writing depth
+    vsg::ref_ptr<vsg::Node> createModel();
+
+    void add(const vsg::vec3& point);
+
+    //Dirty the blocks written since the last call and refresh the draw ranges, call before viewer->recordAndSubmit()
+    void update();
+
+    void report(std::ostream& out) const;
+
+private:
+    std::vector<vsg::ref_ptr<vsg::vec3Array>> blocks;
+    std::vector<vsg::ref_ptr<vsg::VertexDraw>> draws;
+    std::vector<uint8_t> written;
+
+    //Next index to write, number of points held, capacity and block size as the shader reads them
+    vsg::ref_ptr<vsg::uivec4Value> ring;
+
+    uint32_t head = 0;
+    uint32_t count = 0;
+    vsg::vec3 last;
+
+    uint64_t points = 0;
+    uint64_t updates = 0;
+    uint64_t blockUploads = 0;
+};
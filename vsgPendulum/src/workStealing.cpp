@@ -0,0 +1,84 @@
+#include "workStealing.hpp"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(unsigned int _numThreads) :
+    numThreads(_numThreads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : _numThreads)
+{
+    for (unsigned int i = 0; i < numThreads; ++i) queues.push_back(std::make_unique<Queue>());
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    cancel();
+}
+
+void WorkStealingPool::start(const std::vector<size_t>& tasks, Task _task)
+{
+    cancel();
+    cancelled = false;
+    task = std::move(_task);
+    remaining = tasks.size();
+
+    //Contiguous runs, pushed in reverse so each owner pops its run in order and thieves take from its far end
+    size_t perThread = (tasks.size() + numThreads - 1) / numThreads;
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+        size_t begin = std::min(tasks.size(), i * perThread);
+        size_t end = std::min(tasks.size(), begin + perThread);
+        std::scoped_lock<std::mutex> lock(queues[i]->mutex);
+        queues[i]->tasks.assign(tasks.rbegin() + static_cast<std::ptrdiff_t>(tasks.size() - end), tasks.rbegin() + static_cast<std::ptrdiff_t>(tasks.size() - begin));
+    }
+
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+        threads.emplace_back([this, i]() { work(i); });
+    }
+}
+
+void WorkStealingPool::cancel()
+{
+    cancelled = true;
+    for (auto& thread : threads) thread.join();
+    threads.clear();
+    for (auto& queue : queues) queue->tasks.clear();
+}
+
+bool WorkStealingPool::pop(unsigned int self, size_t& t)
+{
+    {
+        std::scoped_lock<std::mutex> lock(queues[self]->mutex);
+        auto& own = queues[self]->tasks;
+        if (!own.empty())
+        {
+            t = own.back();
+            own.pop_back();
+            return true;
+        }
+    }
+
+    for (unsigned int i = 1; i < numThreads; ++i)
+    {
+        auto& victim = *queues[(self + i) % numThreads];
+        std::scoped_lock<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            t = victim.tasks.front();
+            victim.tasks.pop_front();
+            stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::work(unsigned int self)
+{
+    //No tasks are added once started, so a pass that finds every deque empty means the work has run out
+    size_t t;
+    while (!cancelled.load(std::memory_order_relaxed) && pop(self, t))
+    {
+        task(t);
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
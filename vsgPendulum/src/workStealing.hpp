@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Background threads working through a list of tasks whose costs vary a lot
+//Each thread owns a deque seeded with a contiguous run of the tasks and works through it from the back, when it runs dry
+//it steals from the front of another thread's deque, so threads that drew cheap tasks take over the expensive ones' leftovers
+//and each thread mostly works on neighbouring tasks
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void(size_t task)>;
+
+    //numThreads of 0 uses one thread per hardware thread
+    WorkStealingPool(unsigned int numThreads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned int size() const { return numThreads; }
+
+    //Call task(t) for every t in tasks on the pool's threads and return immediately
+    void start(const std::vector<size_t>& tasks, Task _task);
+
+    //Stop handing out tasks, wait for the running ones to return and join the threads, the rest are left undone
+    void cancel();
+
+    //Every task started has returned
+    bool finished() const { return remaining.load(std::memory_order_acquire) == 0; }
+
+    //Tasks taken from another thread's deque
+    uint64_t steals() const { return stolen.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Queue
+    {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void work(unsigned int self);
+    bool pop(unsigned int self, size_t& t);
+
+    unsigned int numThreads;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    Task task;
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<size_t> remaining{0};
+    std::atomic<uint64_t> stolen{0};
+};